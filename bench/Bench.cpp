@@ -0,0 +1,303 @@
+#include "Corpus.h"
+
+#include "rockchip/RKCfg.h"
+#include "rockchip/RKCfgCompact.h"
+#include "rockchip/RKCfgView.h"
+#include "util/String.h"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+using namespace rockchip;
+
+namespace bench {
+
+namespace {
+
+// Corpus sizes: number of cfg items and number of files in the image directory.
+const std::vector<int64_t> item_counts = {1, 16, 64, 255};
+const std::vector<int64_t> file_counts = {10, 1000, 100000};
+
+RKCfgFile load(const Corpus& corpus) {
+    std::error_code ec;
+    auto            file = RKCfgFile::fromFile(corpus.cfg, ec);
+    if (!file) throw std::runtime_error(ec.message());
+    return std::move(*file);
+}
+
+void items_processed(benchmark::State& state, const Corpus& corpus) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.items));
+}
+
+void BM_FromFile(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), 10);
+    for (auto _ : state) {
+        std::error_code ec;
+        auto            file = RKCfgFile::fromFile(corpus.cfg, ec);
+        if (!file) state.SkipWithError(ec.message().c_str());
+        benchmark::DoNotOptimize(file);
+    }
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_FromFile)->ArgsProduct({item_counts});
+
+void BM_FromParameter(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), 10);
+    for (auto _ : state) {
+        std::error_code ec;
+        auto            file = RKCfgFile::fromParameter(corpus.parameter, {}, ec);
+        if (!file) state.SkipWithError(ec.message().c_str());
+        benchmark::DoNotOptimize(file);
+    }
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_FromParameter)->ArgsProduct({item_counts});
+
+// Every iteration lists the directory again, as a single conversion does.
+void BM_FromParameterAutoScan(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), state.range(1));
+
+    RKCfgFile::AutoScanArgument auto_scan_args;
+    auto_scan_args.enabled = true;
+    auto_scan_args.prefix  = "Image/";
+    for (auto _ : state) {
+        std::error_code ec;
+        auto            file = RKCfgFile::fromParameter(corpus.parameter, auto_scan_args, ec);
+        if (!file) state.SkipWithError(ec.message().c_str());
+        benchmark::DoNotOptimize(file);
+    }
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_FromParameterAutoScan)->ArgsProduct({{16, 255}, file_counts})->Unit(benchmark::kMicrosecond);
+
+// Same with the directory listed once up front, as batch conversions sharing a directory do.
+void BM_FromParameterSharedIndex(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), state.range(1));
+
+    std::error_code             ec;
+    RKCfgFile::AutoScanArgument auto_scan_args;
+    auto_scan_args.enabled = true;
+    auto_scan_args.prefix  = "Image/";
+    auto_scan_args.index   = RKImageIndex::scan(corpus.directory, ec);
+    if (!auto_scan_args.index) state.SkipWithError(ec.message().c_str());
+    for (auto _ : state) {
+        auto file = RKCfgFile::fromParameter(corpus.parameter, auto_scan_args, ec);
+        if (!file) state.SkipWithError(ec.message().c_str());
+        benchmark::DoNotOptimize(file);
+    }
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_FromParameterSharedIndex)->ArgsProduct({{16, 255}, file_counts});
+
+void BM_FromJson(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), 10);
+    for (auto _ : state) {
+        std::error_code ec;
+        auto            file = RKCfgFile::fromJson(corpus.json, ec);
+        if (!file) state.SkipWithError(ec.message().c_str());
+        benchmark::DoNotOptimize(file);
+    }
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_FromJson)->ArgsProduct({item_counts});
+
+// Second argument is the RKCfgFile::SaveMode.
+void BM_Save(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), 10);
+    auto  mode   = static_cast<RKCfgFile::SaveMode>(state.range(1));
+    auto  file   = load(corpus);
+    auto  output = (corpus.directory / (mode == RKCfgFile::DefaultMode ? "save.cfg" : "save.json")).string();
+    for (auto _ : state) {
+        std::error_code ec;
+        file.save(output, mode, ec);
+        if (ec) state.SkipWithError(ec.message().c_str());
+    }
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_Save)->ArgsProduct(
+    {item_counts, {RKCfgFile::DefaultMode, RKCfgFile::JsonMode, RKCfgFile::JsonCompactMode}}
+);
+
+void BM_ToJson(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), 10);
+    auto  file   = load(corpus);
+    for (auto _ : state) benchmark::DoNotOptimize(file.toJson());
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_ToJson)->ArgsProduct({item_counts});
+
+// Removes the partitions named by half of the filters, the other half matches nothing.
+void BM_RemoveItem(benchmark::State& state) {
+    auto&      corpus = bench::corpus(state.range(0), 10);
+    auto       file   = load(corpus);
+    SplitMix64 random(default_seed);
+
+    RKCfgFile::ItemFilterCollection filters;
+    for (int64_t i = 0; i < state.range(1); i++) {
+        auto name = i % 2 ? random_name(random) + "-missing" : corpus.names[random.below(corpus.names.size())];
+        filters.emplace_back(std::make_unique<RKCfgFile::NameItemFilter>(name));
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto copy = file;
+        state.ResumeTiming();
+        copy.removeItem(filters);
+        benchmark::DoNotOptimize(copy);
+    }
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_RemoveItem)->ArgsProduct({{16, 255}, {1, 16, 64}});
+
+// Files derived from the cfg of a corpus, as a fleet of boards: one product line (image directory) per 64 files,
+// addresses differing between the boards of a line.
+std::vector<RKCfgFile> make_fleet(const Corpus& corpus, size_t files) {
+    auto                   base = load(corpus);
+    std::vector<RKCfgFile> fleet;
+    fleet.reserve(files);
+    for (size_t i = 0; i < files; i++) {
+        auto file = base;
+        for (size_t idx = 0; idx < file.getItems().size(); idx++) {
+            auto item = file.getItems()[idx];
+            auto name = util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+            auto path = fmt::format("line{}/{}", i / 64, name);
+            util::string::to_char16(path, item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+            item.address += static_cast<uint32_t>(i % 64) * 0x800;
+            file.updateItem(idx, item);
+        }
+        fleet.emplace_back(std::move(file));
+    }
+    return fleet;
+}
+
+std::vector<RKCfgCompactFile> compact_fleet(const std::vector<RKCfgFile>& fleet, std::shared_ptr<RKStringArena> arena) {
+    std::vector<RKCfgCompactFile> result;
+    result.reserve(fleet.size());
+    for (const auto& file : fleet) result.emplace_back(RKCfgCompactFile::fromView(RKCfgView(file), arena));
+    return result;
+}
+
+size_t fleet_items(const std::vector<RKCfgFile>& fleet) { return fleet.size() * fleet.front().getItems().size(); }
+
+void BM_CompactFromView(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), 10);
+    auto  file   = load(corpus);
+    auto  arena  = std::make_shared<RKStringArena>();
+    for (auto _ : state) benchmark::DoNotOptimize(RKCfgCompactFile::fromView(RKCfgView(file), arena));
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_CompactFromView)->ArgsProduct({item_counts});
+
+// Selected items of one partition name across the fleet, as a fleet-wide check does. The bytes_per_item counter is
+// the memory held by the items (the arena included for the compact form).
+void BM_FleetScanItems(benchmark::State& state) {
+    auto& corpus = bench::corpus(state.range(0), 10);
+    auto  fleet  = make_fleet(corpus, state.range(1));
+
+    RKCfgFile::ItemFilterCollection filters;
+    filters.emplace_back(std::make_unique<RKCfgFile::NameItemFilter>(corpus.names[corpus.names.size() / 2]));
+    RKCfgFile::ItemFilterPlan plan(std::move(filters));
+    for (auto _ : state) {
+        size_t matches{};
+        for (const auto& file : fleet) {
+            const auto& items = file.getItems();
+            for (size_t idx = 0; idx < items.size(); idx++)
+                matches += items[idx].is_selected && plan.matches(idx, items[idx]);
+        }
+        benchmark::DoNotOptimize(matches);
+    }
+    size_t bytes{};
+    for (const auto& file : fleet) bytes += sizeof(file) + file.getItems().capacity() * sizeof(RKCfgItem);
+    state.counters["bytes_per_item"] = static_cast<double>(bytes) / fleet_items(fleet);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * fleet_items(fleet)));
+}
+BENCHMARK(BM_FleetScanItems)->ArgsProduct({{16, 64}, {1024, 16384}});
+
+void BM_FleetScanCompact(benchmark::State& state) {
+    auto& corpus  = bench::corpus(state.range(0), 10);
+    auto  fleet   = make_fleet(corpus, state.range(1));
+    auto  arena   = std::make_shared<RKStringArena>();
+    auto  compact = compact_fleet(fleet, arena);
+    auto  name    = arena->find(corpus.names[corpus.names.size() / 2]);
+    if (!name) state.SkipWithError("name not interned");
+    for (auto _ : state) {
+        size_t matches{};
+        for (const auto& file : compact) {
+            auto names    = file.getNameIds();
+            auto selected = file.getSelected();
+            for (size_t idx = 0; idx < names.size(); idx++) matches += selected[idx] && names[idx] == *name;
+        }
+        benchmark::DoNotOptimize(matches);
+    }
+    size_t bytes = arena->memoryUsage();
+    for (const auto& file : compact) bytes += file.memoryUsage();
+    state.counters["bytes_per_item"] = static_cast<double>(bytes) / fleet_items(fleet);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * fleet_items(fleet)));
+}
+BENCHMARK(BM_FleetScanCompact)->ArgsProduct({{16, 64}, {1024, 16384}});
+
+// Expanding back to the wire layout, as saving does.
+void BM_CompactToFile(benchmark::State& state) {
+    auto& corpus  = bench::corpus(state.range(0), 10);
+    auto  file    = load(corpus);
+    auto  compact = RKCfgCompactFile::fromView(RKCfgView(file), std::make_shared<RKStringArena>());
+    for (auto _ : state) benchmark::DoNotOptimize(compact.toFile());
+    items_processed(state, corpus);
+}
+BENCHMARK(BM_CompactToFile)->ArgsProduct({item_counts});
+
+// Argument is the length in code units, half of the characters are outside of ASCII.
+std::u16string make_utf16(size_t length) {
+    constexpr std::u16string_view alphabet = u"abcdefghijklmnopqrstuvwxyzé中文фü";
+
+    SplitMix64     random(default_seed);
+    std::u16string result;
+    for (size_t i = 0; i < length; i++)
+        result += i % 2 ? alphabet[26 + random.below(alphabet.size() - 26)] : alphabet[random.below(26)];
+    return result;
+}
+
+void BM_FromChar16(benchmark::State& state) {
+    auto str = make_utf16(state.range(0));
+    for (auto _ : state) benchmark::DoNotOptimize(util::string::from_char16(str.c_str(), str.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * str.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_FromChar16)->Arg(8)->Arg(RKCfgItem::RK_V286_MAX_NAME_SIZE)->Arg(RKCfgItem::RK_V286_MAX_PATH_SIZE);
+
+void BM_FromChar16Buffer(benchmark::State& state) {
+    auto              str = make_utf16(state.range(0));
+    std::vector<char> buffer(str.size() * 3);
+    for (auto _ : state) benchmark::DoNotOptimize(util::string::from_char16(str.c_str(), str.size(), buffer));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * str.size() * sizeof(char16_t)));
+}
+BENCHMARK(BM_FromChar16Buffer)->Arg(8)->Arg(RKCfgItem::RK_V286_MAX_NAME_SIZE)->Arg(RKCfgItem::RK_V286_MAX_PATH_SIZE);
+
+void BM_ToChar16(benchmark::State& state) {
+    auto                  utf16 = make_utf16(state.range(0));
+    auto                  str   = util::string::from_char16(utf16.c_str(), utf16.size());
+    std::vector<char16_t> buffer(state.range(0) + 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(util::string::to_char16(str, buffer.data(), buffer.size()));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * str.size()));
+}
+BENCHMARK(BM_ToChar16)->Arg(8)->Arg(RKCfgItem::RK_V286_MAX_NAME_SIZE)->Arg(RKCfgItem::RK_V286_MAX_PATH_SIZE);
+
+} // namespace
+
+} // namespace bench
+
+int main(int argc, char** argv) {
+    // Conversions log every selected image, which would be measured as well.
+    spdlog::set_level(spdlog::level::warn);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
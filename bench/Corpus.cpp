@@ -0,0 +1,140 @@
+#include "Corpus.h"
+
+#include "rockchip/RKCfg.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+#include <spdlog/fmt/fmt.h>
+
+using namespace rockchip;
+
+namespace bench {
+
+namespace {
+
+constexpr std::string_view partition_names[] = {
+    "uboot", "trust", "misc",   "boot",     "recovery", "backup", "oem",      "vendor",
+    "system", "rootfs", "cache", "metadata", "dtbo",     "vbmeta", "security", "userdata",
+};
+
+void write_file(const std::filesystem::path& path, std::string_view content) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    if (!file) throw std::runtime_error(fmt::format("Unable to write {}.", path.string()));
+}
+
+// parameter.txt in the usual rockchip layout, the last partition grows to the end of the device.
+std::string make_parameter(const std::vector<std::string>& names, SplitMix64& random) {
+    std::string mtdparts = "mtdparts=rk29xxnand:";
+    uint32_t    address  = 0x00004000;
+    // Loader and parameter are added by the conversion, they are not part of mtdparts.
+    for (size_t i = 2; i < names.size(); i++) {
+        if (i != 2) mtdparts += ',';
+        if (i + 1 == names.size()) {
+            mtdparts += fmt::format("-@{:#010x}({}:grow)", address, names[i]);
+            break;
+        }
+        uint32_t size  = (random.below(0x400) + 1) * 0x800;
+        mtdparts      += fmt::format("{:#010x}@{:#010x}({})", size, address, names[i]);
+        address       += size;
+    }
+    return fmt::format(
+        "FIRMWARE_VER: 8.1\n"
+        "MACHINE_MODEL: RK3326\n"
+        "MACHINE_ID: 007\n"
+        "MANUFACTURER: RKCFGBENCH\n"
+        "MAGIC: 0x5041524B\n"
+        "ATAG: 0x00200800\n"
+        "MACHINE: 3326\n"
+        "CHECK_MASK: 0x80\n"
+        "PWR_HLD: 0,0,A,0,1\n"
+        "TYPE: GPT\n"
+        "CMDLINE: console=ttyFIQ0 androidboot.console=ttyFIQ0 {}\n"
+        "uuid:rootfs=614e0000-0000-4b53-8000-1d28000054a9\n",
+        mtdparts
+    );
+}
+
+void generate(const Corpus& corpus, const std::string& parameter, SplitMix64& random) {
+    std::error_code ec;
+    std::filesystem::remove_all(corpus.directory, ec);
+    std::filesystem::create_directories(corpus.directory);
+
+    write_file(corpus.parameter, parameter);
+    write_file(corpus.directory / "MiniLoaderAll.bin", "");
+    size_t written = 1;
+    for (size_t i = 2; i < corpus.names.size() && written < corpus.files; i++, written++)
+        write_file(corpus.directory / (corpus.names[i] + ".img"), "");
+    // Unrelated files, sorted in between the images so that lookups cannot stop early.
+    for (; written < corpus.files; written++) {
+        auto name = fmt::format("{}{:06x}.bin", random_name(random), written);
+        write_file(corpus.directory / name, "");
+    }
+
+    RKCfgFile::AutoScanArgument auto_scan_args;
+    auto_scan_args.enabled = true;
+    auto_scan_args.prefix  = "Image/";
+    auto file              = RKCfgFile::fromParameter(corpus.parameter, auto_scan_args, ec);
+    if (!file) throw std::runtime_error(fmt::format("Unable to convert {}: {}", corpus.parameter, ec.message()));
+    while (file->getItems().size() > corpus.items) file->removeItem(file->getItems().size() - 1);
+    file->save(corpus.cfg, RKCfgFile::DefaultMode, ec);
+    if (!ec) file->save(corpus.json, RKCfgFile::JsonMode, ec);
+    if (ec) throw std::runtime_error(fmt::format("Unable to save {}: {}", corpus.cfg, ec.message()));
+
+    write_file(corpus.directory / ".complete", "");
+}
+
+} // namespace
+
+std::string random_name(SplitMix64& random) {
+    constexpr std::string_view alphabet = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+    std::string name(partition_names[random.below(std::size(partition_names))]);
+    if (random.below(2)) {
+        name += '_';
+        for (auto count = random.below(4) + 1; count; count--) name += alphabet[random.below(alphabet.size())];
+    }
+    return name;
+}
+
+const Corpus& corpus(size_t items, size_t files, uint64_t seed) {
+    static std::mutex                                                        mutex;
+    static std::map<std::tuple<size_t, size_t, uint64_t>, std::unique_ptr<Corpus>> corpora;
+
+    items = std::clamp<size_t>(items, 1, 255);
+    files = std::clamp<size_t>(files, 10, 100000);
+
+    std::lock_guard lock(mutex);
+    auto&           result = corpora[{items, files, seed}];
+    if (result) return *result;
+
+    auto corpus       = std::make_unique<Corpus>();
+    corpus->items     = items;
+    corpus->files     = files;
+    corpus->directory = std::filesystem::temp_directory_path() / "rkcfgbench"
+                      / fmt::format("{}-{}-{:x}", items, files, seed);
+    corpus->parameter = (corpus->directory / "parameter.txt").string();
+    corpus->cfg       = (corpus->directory / "corpus.cfg").string();
+    corpus->json      = (corpus->directory / "corpus.json").string();
+
+    // Names and parameter.txt are derived from the seed alone, so a previous run's files can be reused as is.
+    SplitMix64 random(seed);
+    corpus->names = {"Loader", "parameter"};
+    for (size_t i = 2; i < std::max<size_t>(items, 3); i++)
+        corpus->names.push_back(fmt::format("{}{}", random_name(random), i));
+    auto parameter = make_parameter(corpus->names, random);
+    corpus->names.resize(items);
+
+    if (!std::filesystem::exists(corpus->directory / ".complete")) generate(*corpus, parameter, random);
+
+    result = std::move(corpus);
+    return *result;
+}
+
+} // namespace bench
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// SplitMix64, so that every machine generates the very same corpus for a given seed.
+class SplitMix64 {
+public:
+    explicit SplitMix64(uint64_t seed) : m_state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (m_state += 0x9e3779b97f4a7c15);
+        z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z          = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform enough in [0, bound) for corpus generation.
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>(next() % bound); }
+
+private:
+    uint64_t m_state;
+};
+
+constexpr uint64_t default_seed = 0x524b434647; // "RKCFG"
+
+// A generated image directory: parameter.txt describing `items` partitions (Loader and parameter included), the
+// cfg and json it converts to, and `files` files of which one per partition is its image.
+struct Corpus {
+    std::filesystem::path    directory;
+    std::string              parameter;
+    std::string              cfg;
+    std::string              json;
+    std::vector<std::string> names; // partition names, in cfg order
+    size_t                   items{};
+    size_t                   files{};
+};
+
+// Generates the corpus below the temporary directory, or reuses the one a previous run left there.
+// items is clamped to 1..255, files to 10..100000. Throws std::runtime_error if it cannot be written.
+const Corpus& corpus(size_t items, size_t files, uint64_t seed = default_seed);
+
+// Random partition-like name of 3..16 characters, e.g. "vendor_ab3".
+std::string random_name(SplitMix64& random);
+
+} // namespace bench
@@ -0,0 +1,158 @@
+// Load generator for `rkcfgtool serve`: sends the same request over several connections and reports the latency
+// distribution. POSIX only.
+
+#include "cli/Protocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+int connect_to(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    auto index = static_cast<size_t>(p / 100 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+int main(int argc, char** argv) try {
+    spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
+
+    // clang-format off
+
+    argparse::ArgumentParser program("rkcfgloadgen", "0.2.0");
+
+    program.add_argument("--socket")
+        .help("Path of the server's Unix socket.")
+        .required();
+
+    program.add_argument("--request")
+        .help("Request to send, a json object. Example: '{\"op\": \"convert\", \"input\": \"a.cfg\", \"output\": \"/tmp/a.json\"}'");
+
+    program.add_argument("--request-file")
+        .help("Read the request from a file instead.");
+
+    program.add_argument("--requests")
+        .help("Number of requests in total.")
+        .default_value(size_t(10000))
+        .scan<'u', size_t>();
+
+    program.add_argument("--concurrency")
+        .help("Number of connections sending requests in parallel.")
+        .default_value(size_t(4))
+        .scan<'u', size_t>();
+
+    // clang-format on
+
+    program.parse_args(argc, argv);
+
+    std::string request;
+    if (auto path = program.present("--request-file")) {
+        std::ifstream     file(*path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        request = buffer.str();
+    } else if (auto text = program.present("--request")) {
+        request = *text;
+    } else {
+        spdlog::error("Either --request or --request-file is required.");
+        return -1;
+    }
+    if (!nlohmann::json::accept(request)) {
+        spdlog::error("The request is not valid json.");
+        return -1;
+    }
+
+    auto socket      = program.get<std::string>("--socket");
+    auto total       = program.get<size_t>("--requests");
+    auto concurrency = std::max<size_t>(program.get<size_t>("--concurrency"), 1);
+
+    std::vector<std::vector<double>> latencies(concurrency);
+    std::atomic<size_t>              failed{};
+    std::atomic<size_t>              broken{};
+    std::vector<std::thread>         threads;
+
+    auto begin = clock_type::now();
+    for (size_t i = 0; i < concurrency; i++) {
+        threads.emplace_back([&, i] {
+            int fd = connect_to(socket);
+            if (fd < 0) {
+                broken++;
+                return;
+            }
+            auto        count = total / concurrency + (i < total % concurrency);
+            auto&       local = latencies[i];
+            std::string response;
+            local.reserve(count);
+            for (size_t n = 0; n < count; n++) {
+                auto sent = clock_type::now();
+                if (!cli::protocol::write_frame(fd, request) || !cli::protocol::read_frame(fd, response)) {
+                    broken++;
+                    break;
+                }
+                local.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - sent).count());
+                auto result = nlohmann::json::parse(response, nullptr, false);
+                if (!result.is_object() || !result.value("ok", false)) failed++;
+            }
+            ::close(fd);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    auto seconds = std::chrono::duration<double>(clock_type::now() - begin).count();
+
+    std::vector<double> all;
+    for (auto& local : latencies) all.insert(all.end(), local.begin(), local.end());
+    std::sort(all.begin(), all.end());
+
+    spdlog::info(
+        "{} requests over {} connections in {:.3f}s ({:.1f} requests/s), {} failed, {} connection errors.",
+        all.size(),
+        concurrency,
+        seconds,
+        seconds > 0 ? all.size() / seconds : 0.0,
+        failed.load(),
+        broken.load()
+    );
+    spdlog::info(
+        "Latency: p50 {:.1f}us, p90 {:.1f}us, p99 {:.1f}us, max {:.1f}us.",
+        percentile(all, 50),
+        percentile(all, 90),
+        percentile(all, 99),
+        all.empty() ? 0.0 : all.back()
+    );
+    return failed || broken ? -1 : 0;
+} catch (const std::runtime_error& e) {
+    spdlog::error(e.what());
+    return -1;
+}
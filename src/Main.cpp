@@ -1,9 +1,21 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
 #include <argparse/argparse.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
-#include "rockchip/RKCfg.h"
+#include "util/Profile.h"
+#include "util/String.h"
 
-using namespace rockchip;
+#include "cli/Batch.h"
+#include "cli/Cache.h"
+#include "cli/Diff.h"
+#include "cli/Index.h"
+#include "cli/Job.h"
+#include "cli/Serve.h"
+#include "cli/Watch.h"
 
 int main(int argc, char** argv) try {
 
@@ -14,6 +26,15 @@ int main(int argc, char** argv) try {
 #endif
     spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
 
+    // Keeps stdout for machine-readable output only.
+    auto log_to_stderr = [] {
+        if (spdlog::get("stderr")) return;
+        auto level = spdlog::get_level();
+        spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+        spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
+        spdlog::set_level(level);
+    };
+
     // --- Program ---
 
     // clang-format off
@@ -21,16 +42,25 @@ int main(int argc, char** argv) try {
     argparse::ArgumentParser program("rkcfgtool", "0.2.0");
 
     program.add_argument("-i", "--input")
-        .help("Import a file.")
-        .required();
+        .help("Import a file. [required unless --batch is used]");
 
     program.add_argument("-o", "--output")
-        .help("Set the output file path (if any).");
+        .help("Set the output file path (if any). With --batch, the output directory for directory or glob manifests.");
+
+    program.add_argument("--batch")
+        .help("Run many jobs in one process. Either an NDJSON manifest (.json/.jsonl/.ndjson), one job per line: {\"input\", \"output\", \"remove_partition\": [...], \"enable_auto_scan\", \"auto_scan_prefix\", \"show\"}, or a directory / glob such as './cfgs/*.cfg'. Other options are used as defaults for every job.");
 
     program.add_argument("-s", "--show")
         .help("Print the partition table information contained in the cfg file.")
         .flag();
 
+    program.add_argument("--format")
+        .help("With --show, print the items as table, ndjson, csv or tsv to stdout (one write per file, logs go to stderr), instead of through the logger.");
+
+    program.add_argument("--compact-json")
+        .help("Write json output without indentation.")
+        .flag();
+
     program.add_argument("--enable-auto-scan")
         .help("When converting  parameter.txt to cfg file, the image file in the current directory will be automatically scanned and applied.")
         .flag();
@@ -47,126 +77,355 @@ int main(int argc, char** argv) try {
         .help("Remove all matching partitions from the input. Syntax: '(address|name|image_path|index):..., example: 'name:userdisk'.")
         .append();
 
+    program.add_argument("--patch")
+        .help("Edit the input cfg file in place, only the changed bytes are written. Syntax: '<filters>=(selected:0|selected:1|address:...|image_path:...|remove)', the filters as for --remove-partition, example: 'name:boot=image_path:Image/boot.img'.")
+        .append();
+
+    program.add_argument("--crash-safe")
+        .help("With --patch, write removals to a temporary file that replaces the input, instead of compacting it in place.")
+        .flag();
+
+    program.add_argument("--verify-images")
+        .help("Hash every image referenced by the resulting cfg file and compare it with '<cfg>.manifest.json'. Fails if an image is missing or has changed. Images whose size and mtime are unchanged are not hashed again.")
+        .flag();
+
+    program.add_argument("--emit-manifest")
+        .help("Hash every image referenced by the resulting cfg file (CRC-32 and SHA-256) and write them to '<cfg>.manifest.json'. Images whose size and mtime are unchanged keep their previous hashes.")
+        .flag();
+
+    program.add_argument("--check-layout")
+        .help("Check the partition layout of the parameter file (the input, the parameter item of a cfg file or the one of an update image): overlapping partitions, unused sectors between them, addresses off --layout-alignment and images larger than their partition. Diagnostics are written to --layout-report, or to stdout, one NDJSON object per line (logs go to stderr), errors fail the job.")
+        .flag();
+
+    program.add_argument("--layout-report")
+        .help("With --check-layout, write the diagnostics to this file instead of stdout. Required with --format and --profile, which write to stdout too.");
+
+    program.add_argument("--layout-alignment")
+        .help("With --check-layout, sectors every partition address must be a multiple of, 0 to skip the check. Example: '0x2000'.")
+        .default_value("0x800");
+
+    program.add_argument("--pack-update")
+        .help("Pack the selected images of the resulting cfg file into an update image (RKAF package), with the parameter file and the Loader. Images are copied by the kernel where possible and checksummed in the same pass.");
+
+    program.add_argument("--pack-chip")
+        .help("With --pack-update, wrap the package into an RKFW image for this chip code (as given to rkImageMaker, example: '0x33353638'), the Loader being required.");
+
+    program.add_argument("--extract-dir")
+        .help("With an update image (.img) as input, point the image paths into this directory and extract the selected partitions there. Images already extracted from the same package are kept.");
+
+    program.add_argument("--watch")
+        .help("Convert a parameter file (.txt) to --output, then keep watching its directory: the output is regenerated when the parameter file changes, and its image paths are updated when images are added, removed or renamed.")
+        .flag();
+
+    program.add_argument("--watch-debounce")
+        .help("With --watch, milliseconds without changes to wait for before regenerating.")
+        .default_value(size_t(200))
+        .scan<'u', size_t>();
+
+    program.add_argument("--cache-dir")
+        .help("Keep the outputs of parameter.txt conversions in this directory, and copy them from there when the parameter file, the options and (with --enable-auto-scan) the image directory are unchanged.");
+
+    program.add_argument("--cache-max-size")
+        .help("With --cache-dir, evict the least recently used outputs once the cache grows over this size. Example: '256M'. 0 means unbounded.")
+        .default_value("0");
+
+    program.add_argument("--cache-stats")
+        .help("With --cache-dir, print the hits, misses and size of the cache at the end.")
+        .flag();
+
+    program.add_argument("--profile")
+        .help("Print where the time went (per phase, summed over every job and thread) and the bytes read/written, filesystem calls and string conversions at the end.")
+        .flag();
+
+    program.add_argument("--profile-format")
+        .help("Format of --profile: 'table' or 'ndjson'.")
+        .default_value("table");
+
+    argparse::ArgumentParser serve_command("serve");
+    serve_command.add_description("Keep running and serve conversions to other processes over a Unix socket.");
+
+    serve_command.add_argument("--socket")
+        .help("Path of the Unix socket to listen on.")
+        .required();
+
+    serve_command.add_argument("--threads")
+        .help("Number of workers, each serving one connection at a time. 0 means one per hardware thread.")
+        .default_value(size_t(0))
+        .scan<'u', size_t>();
+
+    serve_command.add_argument("--max-connections")
+        .help("Connections accepted at most, the others wait in the backlog. At most (and 0 means) one per worker, as a connection holds its worker until it is closed.")
+        .default_value(size_t(0))
+        .scan<'u', size_t>();
+
+    program.add_subparser(serve_command);
+
+    argparse::ArgumentParser diff_command("diff");
+    diff_command.add_description("Compare cfg files with a baseline, partitions being matched by name.");
+
+    diff_command.add_argument("base")
+        .help("Baseline: a cfg, json, parameter.txt or update image file.");
+
+    diff_command.add_argument("variants")
+        .help("Files to compare with the baseline, directories or globs such as './variants/*.cfg' are expanded.")
+        .nargs(argparse::nargs_pattern::at_least_one);
+
+    diff_command.add_argument("--format")
+        .help("'text': changed fields per partition, '+' and '-' for added and removed partitions, or 'json': one object per variant.")
+        .default_value("text");
+
+    program.add_subparser(diff_command);
+
+    argparse::ArgumentParser index_command("index");
+    index_command.add_description("Build an index of many cfg files and query it.");
+
+    argparse::ArgumentParser index_build_command("build");
+    index_build_command.add_description("Index the cfg files of a directory tree. Files unchanged since the previous build (same size and modification time) are not parsed again.");
+
+    index_build_command.add_argument("directory")
+        .help("Directory searched recursively for .cfg files.");
+
+    index_build_command.add_argument("--index")
+        .help("Index file to create or update.")
+        .required();
+
+    argparse::ArgumentParser index_query_command("query");
+    index_query_command.add_description("Print the items of the indexed cfg files matching every given criterion.");
+
+    index_query_command.add_argument("--index")
+        .help("Index file built by 'index build'.")
+        .required();
+
+    index_query_command.add_argument("--name")
+        .help("Partition name, example: 'userdata'.");
+
+    index_query_command.add_argument("--image")
+        .help("Image file name (example: 'rootfs_v3.img'), or whole image path if it contains a separator.");
+
+    index_query_command.add_argument("--address")
+        .help("Partition address, example: '0x0000a000'.");
+
+    index_query_command.add_argument("--format")
+        .help("'text' or 'json': one object per item.")
+        .default_value("text");
+
+    index_command.add_subparser(index_build_command);
+    index_command.add_subparser(index_query_command);
+    program.add_subparser(index_command);
+
     // clang-format on
 
     std::error_code ec;
 
     program.parse_args(argc, argv);
 
-    auto input_file_path = program.get<std::string>("--input");
-
-    spdlog::info("Loading... {}", input_file_path);
+    if (program.is_subcommand_used(serve_command)) {
+        cli::ServeOptions options;
+        options.socket          = serve_command.get<std::string>("--socket");
+        options.threads         = serve_command.get<size_t>("--threads");
+        options.max_connections = serve_command.get<size_t>("--max-connections");
+        return cli::run_server(options);
+    }
 
-    std::optional<RKCfgFile> file;
+    if (program.is_subcommand_used(diff_command)) {
+        log_to_stderr();
+        cli::DiffOptions options;
+        options.base     = diff_command.get<std::string>("base");
+        options.variants = diff_command.get<std::vector<std::string>>("variants");
+        auto format      = diff_command.get<std::string>("--format");
+        if (format != "text" && format != "json") {
+            spdlog::error("Invalid --format {}, expected text or json.", format);
+            return -1;
+        }
+        options.json = format == "json";
+        return cli::run_diff(options);
+    }
 
-    if (input_file_path.ends_with(".json")) {
-        file = RKCfgFile::fromJson(input_file_path, ec);
-    } else if (input_file_path.ends_with(".txt")) {
-        RKCfgFile::AutoScanArgument auto_scan_args;
-        auto_scan_args.enabled = program.get<bool>("--enable-auto-scan");
-        auto_scan_args.prefix  = program.get<std::string>("--set-auto-scan-prefix");
-        if (auto_scan_args.prefix.find("/") != std::string::npos) {
-            if (!auto_scan_args.prefix.ends_with("/")) auto_scan_args.prefix += "/";
-        } else if (auto_scan_args.prefix.find("\\") != std::string::npos) {
-            if (!auto_scan_args.prefix.ends_with("\\")) auto_scan_args.prefix += "\\";
+    if (program.is_subcommand_used(index_command)) {
+        if (index_command.is_subcommand_used(index_build_command)) {
+            cli::IndexBuildOptions options;
+            options.directory = index_build_command.get<std::string>("directory");
+            options.index     = index_build_command.get<std::string>("--index");
+            return cli::run_index_build(options);
+        }
+        if (!index_command.is_subcommand_used(index_query_command)) {
+            spdlog::error("Expected 'index build' or 'index query'.");
+            return -1;
+        }
+        log_to_stderr();
+        cli::IndexQueryOptions options;
+        options.index = index_query_command.get<std::string>("--index");
+        options.name  = index_query_command.present("--name");
+        options.image = index_query_command.present("--image");
+        if (auto address = index_query_command.present("--address")) {
+            options.address = util::string::to_uint32(*address);
+            if (!options.address) {
+                spdlog::error("Invalid --address {}.", *address);
+                return -1;
+            }
+        }
+        auto format = index_query_command.get<std::string>("--format");
+        if (format != "text" && format != "json") {
+            spdlog::error("Invalid --format {}, expected text or json.", format);
+            return -1;
         }
-        file = RKCfgFile::fromParameter(input_file_path, auto_scan_args, ec);
-    } else {
-        file = RKCfgFile::fromFile(input_file_path, ec);
+        if (!options.name && !options.image && !options.address) {
+            spdlog::error("index query needs at least one of --name, --image and --address.");
+            return -1;
+        }
+        options.json = format == "json";
+        return cli::run_index_query(options);
     }
 
-    if (ec) {
-        spdlog::error(ec.message());
+    auto profile_format = program.get<std::string>("--profile-format");
+    if (profile_format != "table" && profile_format != "ndjson") {
+        spdlog::error("Invalid --profile-format {}, expected table or ndjson.", profile_format);
         return -1;
     }
+    bool profile = program["--profile"] == true;
+    util::profile::set_enabled(profile);
+    if (profile) log_to_stderr();
+    auto finish_profile = [&] {
+        if (!profile) return;
+        auto snapshot = util::profile::snapshot();
+        fmt::print(
+            "{}",
+            profile_format == "ndjson" ? util::profile::to_ndjson(snapshot) : util::profile::to_table(snapshot)
+        );
+    };
 
-    if (program.is_used("--remove-partition")) {
-        auto should_removed_parts = program.get<std::vector<std::string>>("--remove-partition");
-        for (const auto& part : should_removed_parts) {
-            // "address=0x10000000,name=test,"
-            std::unordered_map<std::string, std::string> kv_result;
-            spdlog::debug("should_remove_part: {}", part);
-            bool        is_in_quotation_mark{};
-            size_t      idx{};
-            std::string buffer;
-            std::string left;
-            std::string right;
-            while (true) {
-                if (idx > part.size() - 1) break;
-                auto chr = part[idx];
-                idx++;
-                if (chr == '\'') {
-                    is_in_quotation_mark = !is_in_quotation_mark;
-                    continue;
-                }
-                if (is_in_quotation_mark) {
-                    buffer += chr;
-                    continue;
-                }
-                switch (chr) {
-                case ':':
-                    left = buffer;
-                    buffer.clear();
-                    break;
-                case ',':
-                    right = buffer;
-                    buffer.clear();
-                    kv_result[left] = right;
-                    break;
-                default:
-                    buffer += chr;
-                    break;
-                }
-            }
-            right = buffer;
-            buffer.clear();
-            kv_result[left] = right;
-            RKCfgFile::ItemFilterCollection filters;
-            for (const auto& [key, value] : kv_result) {
-                if (key == "address") {
-                    auto address = util::string::to_uint32(value);
-                    if (!address) {
-                        spdlog::error("Syntax error: {} is not a number.", value);
-                        return -1;
-                    }
-                    filters.emplace_back(new RKCfgFile::AddressItemFilter(*address));
-                } else if (key == "name") {
-                    filters.emplace_back(new RKCfgFile::NameItemFilter(value));
-                } else if (key == "image_path") {
-                    filters.emplace_back(new RKCfgFile::ImagePathItemFilter(value));
-                } else if (key == "index") {
-                    auto index = util::string::to_uint32(value);
-                    if (!index) {
-                        spdlog::error("Syntax error: {} is not a number.", value);
-                        return -1;
-                    }
-                    filters.emplace_back(new RKCfgFile::IndexItemFilter(*index));
-                } else {
-                    spdlog::error("Syntax error: unknown filter({}).", key);
-                    return -1;
-                }
+    cli::Job job;
+    if (program.is_used("--output")) job.output = program.get<std::string>("--output");
+    if (program.is_used("--remove-partition"))
+        job.remove_partitions = program.get<std::vector<std::string>>("--remove-partition");
+    job.auto_scan_args.enabled = program.get<bool>("--enable-auto-scan");
+    job.auto_scan_args.prefix  = cli::normalize_auto_scan_prefix(program.get<std::string>("--set-auto-scan-prefix"));
+    if (program.is_used("--patch")) job.patches = program.get<std::vector<std::string>>("--patch");
+    job.crash_safe             = program["--crash-safe"] == true;
+    job.show                   = program["--show"] == true;
+    job.compact_json           = program["--compact-json"] == true;
+    if (program.is_used("--format")) {
+        auto format     = program.get<std::string>("--format");
+        job.show_format = rockchip::RKTextWriter::parseFormat(format);
+        if (!job.show_format) {
+            spdlog::error("Invalid --format {}, expected table, ndjson, csv or tsv.", format);
+            return -1;
+        }
+        log_to_stderr();
+    }
+    job.verify_images          = program["--verify-images"] == true;
+    job.emit_manifest          = program["--emit-manifest"] == true;
+    if (program["--check-layout"] == true) {
+        auto alignment = util::string::to_uint32(program.get<std::string>("--layout-alignment"));
+        if (!alignment) {
+            spdlog::error("Invalid --layout-alignment {}.", program.get<std::string>("--layout-alignment"));
+            return -1;
+        }
+        job.check_layout = cli::LayoutCheckOptions{*alignment};
+        if (program.is_used("--layout-report")) {
+            auto path         = program.get<std::string>("--layout-report");
+            job.layout_report = std::shared_ptr<std::FILE>(std::fopen(path.c_str(), "w"), std::fclose);
+            if (!job.layout_report) {
+                spdlog::error("Unable to open {}: {}", path, std::strerror(errno));
+                return -1;
             }
-            file->removeItem(filters);
+        } else if (job.show_format || profile) {
+            spdlog::error("--check-layout with --format or --profile needs a --layout-report, stdout is taken.");
+            return -1;
         }
+        log_to_stderr();
     }
-
-    if (program["--show"] == true) {
-        file->printDebugString();
+    if (program.is_used("--pack-update")) job.pack_update = program.get<std::string>("--pack-update");
+    if (program.is_used("--extract-dir")) job.extract_dir = program.get<std::string>("--extract-dir");
+    if (program.is_used("--pack-chip")) {
+        job.pack_chip = util::string::to_uint32(program.get<std::string>("--pack-chip"));
+        if (!job.pack_chip) {
+            spdlog::error("Invalid --pack-chip {}.", program.get<std::string>("--pack-chip"));
+            return -1;
+        }
     }
 
-    if (program.is_used("--output")) {
-        auto output_file_path = program.get<std::string>("--output");
-        file->save(
-            output_file_path,
-            output_file_path.ends_with(".json") ? RKCfgFile::JsonMode : RKCfgFile::DefaultMode,
-            ec
+    if (program.is_used("--cache-dir")) {
+        auto max_size = util::string::to_size(program.get<std::string>("--cache-max-size"));
+        if (!max_size) {
+            spdlog::error("Invalid --cache-max-size {}.", program.get<std::string>("--cache-max-size"));
+            return -1;
+        }
+        auto directory = program.get<std::string>("--cache-dir");
+        job.cache      = cli::OutputCache::open(directory, *max_size, ec);
+        if (!job.cache) {
+            spdlog::error("Unable to open cache {}: {}", directory, ec.message());
+            return -1;
+        }
+    }
+    // A lowered --cache-max-size applies even if nothing was stored.
+    auto finish_cache = [&, cache = job.cache] {
+        if (!cache) return;
+        cache->evict();
+        if (!program.get<bool>("--cache-stats")) return;
+        auto stats = cache->getStats();
+        spdlog::info(
+            "Cache: {} hits, {} misses, {} stored, {} evicted, {} entries ({} bytes).",
+            stats.hits,
+            stats.misses,
+            stats.stores,
+            stats.evictions,
+            stats.entries,
+            stats.bytes
         );
-        if (ec) {
-            spdlog::error(ec.message());
+    };
+
+    if (program.is_used("--batch")) {
+        if (!job.pack_update.empty()) {
+            spdlog::error("--pack-update takes a single input, set \"pack_update\" per line of the manifest instead.");
             return -1;
         }
-        spdlog::info("Results have been saved to {}", output_file_path);
+        cli::BatchOptions options;
+        options.manifest   = program.get<std::string>("--batch");
+        options.output_dir = job.output;
+        job.output.clear();
+        options.defaults = std::move(job);
+        auto result      = cli::run_batch(options);
+        finish_cache();
+        finish_profile();
+        return result;
+    }
+
+    if (!program.is_used("--input")) {
+        spdlog::error("Either --input or --batch is required.");
+        return -1;
     }
+    job.input = program.get<std::string>("--input");
+
+    if (program["--watch"] == true) {
+        if (!job.input.ends_with(".txt") || job.output.empty()) {
+            spdlog::error("--watch takes a parameter file (.txt) as input and an --output.");
+            return -1;
+        }
+        cli::WatchOptions options;
+        options.job      = std::move(job);
+        options.debounce = std::chrono::milliseconds(program.get<size_t>("--watch-debounce"));
+        auto result      = cli::run_watch(options);
+        finish_cache();
+        finish_profile();
+        return result;
+    }
+
+    spdlog::info("Loading... {}", job.input);
+
+    rockchip::RKErrorLocation location;
+    cli::run_job(job, ec, location);
+
+    finish_cache();
+    finish_profile();
+
+    if (ec) {
+        spdlog::error(cli::describe_error(ec, location));
+        return -1;
+    }
+
+    if (!job.patches.empty()) spdlog::info("{} has been patched.", job.input);
+    if (!job.output.empty()) spdlog::info("Results have been saved to {}", job.output);
 
     return 0;
 } catch (const std::runtime_error& e) {
@@ -0,0 +1,324 @@
+#include "rkcfg.h"
+
+#include "rockchip/RKCfg.h"
+#include "rockchip/RKCfgView.h"
+#include "rockchip/RKJsonWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+using namespace rockchip;
+
+// cfg files stay a view over their mapping (or the caller's buffer) until they are modified, as in cli::run_job.
+struct rkcfg_file {
+    std::optional<RKCfgView> view;
+    std::optional<RKCfgFile> file;
+
+    // The view follows the owning copy, whose items move when it is modified.
+    void own() {
+        if (!file) file = view->toFile();
+        view.emplace(*file);
+    }
+};
+
+struct rkcfg_filter {
+    RKCfgFile::ItemFilterPlan plan;
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+rkcfg_status fail(rkcfg_status status, std::string message) {
+    last_error = std::move(message);
+    return status;
+}
+
+rkcfg_status fail(const std::error_code& ec, const RKErrorLocation& location = {}) {
+    auto status = RKCFG_ERROR_FORMAT;
+    if (ec.category() == std::system_category() || ec.category() == rkcfg_save_error_category)
+        status = RKCFG_ERROR_IO;
+    else if (ec.category() == rkcfg_item_filter_error_category)
+        status = RKCFG_ERROR_INVALID_ARGUMENT;
+    else if (ec.category() == rkcfg_load_error_category &&
+             (ec.value() == (int)RKCfgLoadErrorCode::FileNotExists ||
+              ec.value() == (int)RKCfgLoadErrorCode::UnableToOpenFile))
+        status = RKCFG_ERROR_IO;
+    else if (ec.category() == rkcfg_convert_param_error_category &&
+             (ec.value() == (int)RKConvertParamErrorCode::FileNotExists ||
+              ec.value() == (int)RKConvertParamErrorCode::UnableToOpenFile ||
+              ec.value() == (int)RKConvertParamErrorCode::UnableToScanDirectory))
+        status = RKCFG_ERROR_IO;
+    else if (ec.category() == rkcfg_update_image_error_category &&
+             ec.value() == (int)RKUpdateImageErrorCode::UnableToOpenFile)
+        status = RKCFG_ERROR_IO;
+    if (!location.line) return fail(status, ec.message());
+    return fail(
+        status,
+        ec.message() + " (line " + std::to_string(location.line) + ", column " + std::to_string(location.column) + ")"
+    );
+}
+
+// Runs body, turning every exception into a status: nothing may unwind through the C ABI.
+template <typename Body>
+rkcfg_status guard(Body&& body) noexcept {
+    try {
+        last_error.clear();
+        return body();
+    } catch (const std::bad_alloc&) {
+        return fail(RKCFG_ERROR_OUT_OF_MEMORY, "Out of memory.");
+    } catch (const std::exception& e) {
+        return fail(RKCFG_ERROR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(RKCFG_ERROR_INTERNAL, "Unknown error.");
+    }
+}
+
+rkcfg_status invalid_argument(const char* message) { return fail(RKCFG_ERROR_INVALID_ARGUMENT, message); }
+
+rkcfg_format format_of_path(std::string_view path) {
+    if (path.ends_with(".json")) return RKCFG_FORMAT_JSON;
+    if (path.ends_with(".txt")) return RKCFG_FORMAT_PARAMETER;
+    if (path.ends_with(".img")) return RKCFG_FORMAT_UPDATE_IMAGE;
+    return RKCFG_FORMAT_CFG;
+}
+
+size_t field_length(const char16_t* field, size_t max_length) {
+    return std::find(field, field + max_length, u'\0') - field;
+}
+
+rkcfg_status copy_string(const std::string& value, char* buffer, size_t capacity, size_t* length) {
+    if (length) *length = value.size();
+    if (!buffer || capacity <= value.size()) return fail(RKCFG_ERROR_BUFFER_TOO_SMALL, "The buffer is too small.");
+    std::memcpy(buffer, value.data(), value.size());
+    buffer[value.size()] = '\0';
+    return RKCFG_OK;
+}
+
+rkcfg_status
+get_item_field(const rkcfg_file* file, size_t index, bool image_path, char* buffer, size_t capacity, size_t* length) {
+    if (!file) return invalid_argument("The file is null.");
+    auto items = file->view->getItems();
+    if (index >= items.size()) return invalid_argument("The item index is out of range.");
+    const auto& item  = items[index];
+    auto        value = image_path ? util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE)
+                                   : util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+    return copy_string(value, buffer, capacity, length);
+}
+
+} // namespace
+
+extern "C" {
+
+unsigned rkcfg_abi_version(void) { return RKCFG_ABI_VERSION; }
+
+const char* rkcfg_last_error(void) { return last_error.c_str(); }
+
+rkcfg_status rkcfg_open_file(const char* path, rkcfg_format format, const char* auto_scan_prefix, rkcfg_file** out) {
+    return guard([&] {
+        if (!path || !out) return invalid_argument("The path and out must not be null.");
+        if (format == RKCFG_FORMAT_AUTO) format = format_of_path(path);
+        auto                        result = std::make_unique<rkcfg_file>();
+        std::error_code             ec;
+        RKErrorLocation             location;
+        RKCfgFile::AutoScanArgument auto_scan_args;
+        if (auto_scan_prefix) {
+            auto_scan_args.enabled = true;
+            auto_scan_args.prefix  = auto_scan_prefix;
+        }
+        switch (format) {
+        case RKCFG_FORMAT_CFG:
+            result->view = RKCfgView::open(path, ec);
+            break;
+        case RKCFG_FORMAT_JSON:
+        case RKCFG_FORMAT_JSON_COMPACT:
+            result->file = RKCfgFile::fromJson(path, ec, location);
+            break;
+        case RKCFG_FORMAT_PARAMETER:
+            result->file = RKCfgFile::fromParameter(path, auto_scan_args, ec, location);
+            break;
+        case RKCFG_FORMAT_UPDATE_IMAGE:
+            result->file = RKCfgFile::fromUpdateImage(path, {}, ec, location);
+            break;
+        default:
+            return invalid_argument("Unknown format.");
+        }
+        if (ec) return fail(ec, location);
+        if (result->file) result->view.emplace(*result->file);
+        *out = result.release();
+        return RKCFG_OK;
+    });
+}
+
+rkcfg_status rkcfg_open_buffer(const void* data, size_t size, rkcfg_format format, rkcfg_file** out) {
+    return guard([&] {
+        if ((!data && size) || !out) return invalid_argument("The data and out must not be null.");
+        auto bytes = std::span(static_cast<const std::byte*>(data), size);
+        if (format == RKCFG_FORMAT_AUTO) {
+            auto first = std::find_if(bytes.begin(), bytes.end(), [](std::byte byte) {
+                return !std::isspace(static_cast<unsigned char>(byte));
+            });
+            format = first != bytes.end() && *first == std::byte('{') ? RKCFG_FORMAT_JSON : RKCFG_FORMAT_CFG;
+        }
+        auto             result = std::make_unique<rkcfg_file>();
+        std::error_code  ec;
+        RKErrorLocation  location;
+        std::string_view text(static_cast<const char*>(data), size);
+        switch (format) {
+        case RKCFG_FORMAT_CFG:
+            result->view = RKCfgView::fromBuffer(bytes, ec);
+            break;
+        case RKCFG_FORMAT_JSON:
+        case RKCFG_FORMAT_JSON_COMPACT:
+            result->file = RKCfgFile::fromJsonBuffer(text, ec, location);
+            break;
+        case RKCFG_FORMAT_PARAMETER:
+            result->file = RKCfgFile::fromParameterBuffer(text, ec, location);
+            break;
+        default:
+            return invalid_argument("Unsupported format for a buffer.");
+        }
+        if (ec) return fail(ec, location);
+        if (result->file) result->view.emplace(*result->file);
+        *out = result.release();
+        return RKCFG_OK;
+    });
+}
+
+void rkcfg_close(rkcfg_file* file) { delete file; }
+
+rkcfg_status rkcfg_item_count(const rkcfg_file* file, size_t* count) {
+    return guard([&] {
+        if (!file || !count) return invalid_argument("The file and count must not be null.");
+        *count = file->view->getItems().size();
+        return RKCFG_OK;
+    });
+}
+
+rkcfg_status rkcfg_get_item(const rkcfg_file* file, size_t index, rkcfg_item* item) {
+    return guard([&] {
+        if (!file || !item) return invalid_argument("The file and item must not be null.");
+        auto items = file->view->getItems();
+        if (index >= items.size()) return invalid_argument("The item index is out of range.");
+        const auto& source      = items[index];
+        item->name              = reinterpret_cast<const uint16_t*>(source.name);
+        item->name_length       = field_length(source.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+        item->image_path        = reinterpret_cast<const uint16_t*>(source.image_path);
+        item->image_path_length = field_length(source.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+        item->address           = source.address;
+        item->selected          = source.is_selected != 0;
+        return RKCFG_OK;
+    });
+}
+
+rkcfg_status rkcfg_get_item_name(const rkcfg_file* file, size_t index, char* buffer, size_t capacity, size_t* length) {
+    return guard([&] { return get_item_field(file, index, false, buffer, capacity, length); });
+}
+
+rkcfg_status
+rkcfg_get_item_image_path(const rkcfg_file* file, size_t index, char* buffer, size_t capacity, size_t* length) {
+    return guard([&] { return get_item_field(file, index, true, buffer, capacity, length); });
+}
+
+rkcfg_status rkcfg_filter_compile(const char* expression, rkcfg_filter** out) {
+    return guard([&] {
+        if (!expression || !out) return invalid_argument("The expression and out must not be null.");
+        std::error_code ec;
+        auto            filters = RKCfgFile::parseItemFilters(expression, ec);
+        if (ec) return fail(ec);
+        *out = new rkcfg_filter{RKCfgFile::ItemFilterPlan(std::move(filters))};
+        return RKCFG_OK;
+    });
+}
+
+void rkcfg_filter_free(rkcfg_filter* filter) { delete filter; }
+
+rkcfg_status rkcfg_find(const rkcfg_file* file, const rkcfg_filter* filter, size_t start, size_t* index) {
+    return guard([&] {
+        if (!file || !filter || !index) return invalid_argument("The file, filter and index must not be null.");
+        auto items = file->view->getItems();
+        for (*index = start; *index < items.size(); ++*index) {
+            if (filter->plan.matches(*index, items[*index])) return RKCFG_OK;
+        }
+        *index = items.size();
+        return RKCFG_OK;
+    });
+}
+
+rkcfg_status rkcfg_remove(rkcfg_file* file, const rkcfg_filter* filter, size_t* removed) {
+    return guard([&] {
+        if (!file || !filter) return invalid_argument("The file and filter must not be null.");
+        auto before = file->view->getItems().size();
+        file->own();
+        file->file->removeItem(filter->plan);
+        file->view.emplace(*file->file);
+        if (removed) *removed = before - file->view->getItems().size();
+        return RKCFG_OK;
+    });
+}
+
+rkcfg_status rkcfg_serialize(const rkcfg_file* file, rkcfg_format format, void* buffer, size_t capacity, size_t* size) {
+    return guard([&] {
+        if (!file || !size) return invalid_argument("The file and size must not be null.");
+        const auto& view = *file->view;
+        auto        out  = static_cast<char*>(buffer);
+        size_t      used{};
+        // Keeps counting past the capacity, so that the required size is known after one pass.
+        auto write = [&](std::string_view chunk) {
+            if (out && used + chunk.size() <= capacity) std::memcpy(out + used, chunk.data(), chunk.size());
+            used += chunk.size();
+        };
+        switch (format) {
+        case RKCFG_FORMAT_CFG:
+            write({reinterpret_cast<const char*>(&view.getHeader()), sizeof(RKCfgHeader)});
+            write({reinterpret_cast<const char*>(view.getItems().data()), view.getItems().size_bytes()});
+            break;
+        case RKCFG_FORMAT_JSON:
+        case RKCFG_FORMAT_JSON_COMPACT: {
+            RKJsonWriter writer(write, format == RKCFG_FORMAT_JSON);
+            writer.write(view.getHeader(), view.getItems());
+            break;
+        }
+        default:
+            return invalid_argument("Unsupported format for serialization.");
+        }
+        *size = used;
+        if (!out || used > capacity) return fail(RKCFG_ERROR_BUFFER_TOO_SMALL, "The buffer is too small.");
+        return RKCFG_OK;
+    });
+}
+
+rkcfg_status rkcfg_save(const rkcfg_file* file, const char* path, rkcfg_format format) {
+    return guard([&] {
+        if (!file || !path) return invalid_argument("The file and path must not be null.");
+        if (format == RKCFG_FORMAT_AUTO)
+            format = std::string_view(path).ends_with(".json") ? RKCFG_FORMAT_JSON : RKCFG_FORMAT_CFG;
+        RKCfgFile::SaveMode mode;
+        switch (format) {
+        case RKCFG_FORMAT_CFG:
+            mode = RKCfgFile::DefaultMode;
+            break;
+        case RKCFG_FORMAT_JSON:
+            mode = RKCfgFile::JsonMode;
+            break;
+        case RKCFG_FORMAT_JSON_COMPACT:
+            mode = RKCfgFile::JsonCompactMode;
+            break;
+        default:
+            return invalid_argument("Unsupported format for saving.");
+        }
+        std::error_code ec;
+        file->view->save(path, mode, ec);
+        if (ec) return fail(ec);
+        return RKCFG_OK;
+    });
+}
+
+} // extern "C"
@@ -0,0 +1,112 @@
+#pragma once
+
+// librkcfg: C ABI over the cfg loaders, for in-process use from other languages.
+//
+// Every function returns an rkcfg_status and never throws, rkcfg_last_error() then describes the failure. Handles
+// are not thread-safe, but different handles can be used on different threads. Strings are UTF-8 unless noted.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(RKCFG_SHARED)
+#ifdef RKCFG_BUILD
+#define RKCFG_API __declspec(dllexport)
+#else
+#define RKCFG_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define RKCFG_API __attribute__((visibility("default")))
+#else
+#define RKCFG_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a declaration of this header changes incompatibly.
+#define RKCFG_ABI_VERSION 1
+
+typedef enum rkcfg_status {
+    RKCFG_OK = 0,
+    RKCFG_ERROR_INVALID_ARGUMENT, // null handle, unknown format, malformed filter expression...
+    RKCFG_ERROR_IO,               // unable to open, read or write a file
+    RKCFG_ERROR_FORMAT,           // malformed cfg, json, parameter.txt or update image
+    RKCFG_ERROR_BUFFER_TOO_SMALL, // the required size has been stored, call again with a large enough buffer
+    RKCFG_ERROR_OUT_OF_MEMORY,
+    RKCFG_ERROR_INTERNAL
+} rkcfg_status;
+
+typedef enum rkcfg_format {
+    RKCFG_FORMAT_AUTO = 0, // files: by extension as rkcfgtool does, buffers: cfg or json by their first bytes
+    RKCFG_FORMAT_CFG,
+    RKCFG_FORMAT_JSON,
+    RKCFG_FORMAT_JSON_COMPACT, // serialization only, the same as RKCFG_FORMAT_JSON when loading
+    RKCFG_FORMAT_PARAMETER,    // parameter.txt, loading only
+    RKCFG_FORMAT_UPDATE_IMAGE  // RKAF or RKFW package, loading files only
+} rkcfg_format;
+
+typedef struct rkcfg_file   rkcfg_file;
+typedef struct rkcfg_filter rkcfg_filter;
+
+// An item in place: name and image_path point into the loaded file (UTF-16, not NUL-terminated when they fill
+// their field) and stay valid until the file is modified or closed.
+typedef struct rkcfg_item {
+    const uint16_t* name;
+    size_t          name_length; // code units
+    const uint16_t* image_path;
+    size_t          image_path_length; // code units
+    uint32_t        address;
+    int             selected;
+} rkcfg_item;
+
+RKCFG_API unsigned rkcfg_abi_version(void);
+
+// Message of the last failure on the calling thread (empty if none), valid until the next call on that thread.
+RKCFG_API const char* rkcfg_last_error(void);
+
+// Loads a file. cfg files are only mapped, items are copied once the file is modified. auto_scan_prefix (may be
+// NULL to disable) enables the image scan of parameter.txt conversions, as --enable-auto-scan does.
+RKCFG_API rkcfg_status
+rkcfg_open_file(const char* path, rkcfg_format format, const char* auto_scan_prefix, rkcfg_file** out);
+
+// Loads a file from memory. cfg buffers are borrowed and must outlive the handle (or until it is modified), json and
+// parameter.txt buffers are converted and can be released right away.
+RKCFG_API rkcfg_status rkcfg_open_buffer(const void* data, size_t size, rkcfg_format format, rkcfg_file** out);
+
+RKCFG_API void rkcfg_close(rkcfg_file* file);
+
+RKCFG_API rkcfg_status rkcfg_item_count(const rkcfg_file* file, size_t* count);
+
+RKCFG_API rkcfg_status rkcfg_get_item(const rkcfg_file* file, size_t index, rkcfg_item* item);
+
+// UTF-8 name or image path of an item into buffer (NUL-terminated). length receives the length without the NUL,
+// on RKCFG_ERROR_BUFFER_TOO_SMALL too.
+RKCFG_API rkcfg_status
+rkcfg_get_item_name(const rkcfg_file* file, size_t index, char* buffer, size_t capacity, size_t* length);
+RKCFG_API rkcfg_status
+rkcfg_get_item_image_path(const rkcfg_file* file, size_t index, char* buffer, size_t capacity, size_t* length);
+
+// Compiles a --remove-partition expression, e.g. "name:userdisk" or "address:0x0123a000,index:3". A filter can be
+// shared between threads and files.
+RKCFG_API rkcfg_status rkcfg_filter_compile(const char* expression, rkcfg_filter** out);
+
+RKCFG_API void rkcfg_filter_free(rkcfg_filter* filter);
+
+// Index of the first item at or after start matching the filter, the item count if none.
+RKCFG_API rkcfg_status rkcfg_find(const rkcfg_file* file, const rkcfg_filter* filter, size_t start, size_t* index);
+
+// Removes every matching item, removed (may be NULL) receives how many.
+RKCFG_API rkcfg_status rkcfg_remove(rkcfg_file* file, const rkcfg_filter* filter, size_t* removed);
+
+// Writes the file as cfg, json or compact json into buffer. size receives the number of bytes written, or the
+// required capacity on RKCFG_ERROR_BUFFER_TOO_SMALL (buffer may be NULL to query it). json is not NUL-terminated.
+RKCFG_API rkcfg_status
+rkcfg_serialize(const rkcfg_file* file, rkcfg_format format, void* buffer, size_t capacity, size_t* size);
+
+// Writes the file as cfg, json or compact json (RKCFG_FORMAT_AUTO: json for paths ending with .json).
+RKCFG_API rkcfg_status rkcfg_save(const rkcfg_file* file, const char* path, rkcfg_format format);
+
+#ifdef __cplusplus
+}
+#endif
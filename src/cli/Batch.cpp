@@ -0,0 +1,248 @@
+#include "Batch.h"
+
+#include "rockchip/RKCfgView.h"
+#include "util/String.h"
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace cli {
+
+namespace {
+
+// Plain cfg inputs read ahead at once, see run_batch.
+constexpr size_t read_ahead_chunk = 1024;
+
+// Neither json, parameter.txt nor update image.
+bool is_cfg_input(const std::string& input) {
+    return !input.ends_with(".json") && !input.ends_with(".txt") && !input.ends_with(".img");
+}
+
+bool is_ndjson_manifest(const std::string& manifest) {
+    return manifest.ends_with(".json") || manifest.ends_with(".jsonl") || manifest.ends_with(".ndjson");
+}
+
+// One job per line, see parse_job.
+std::optional<std::vector<Job>> load_ndjson_manifest(const BatchOptions& options) {
+    using json = nlohmann::json;
+
+    std::ifstream file(options.manifest);
+    if (!file.is_open()) {
+        spdlog::error("Unable to open manifest {}.", options.manifest);
+        return {};
+    }
+    std::vector<Job> jobs;
+    std::string      line;
+    size_t           line_number{};
+    while (std::getline(file, line)) {
+        line_number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        try {
+            jobs.emplace_back(parse_job(json::parse(line), options.defaults));
+        } catch (const json::exception& e) {
+            spdlog::error("{}:{}: {}", options.manifest, line_number, e.what());
+            return {};
+        }
+    }
+    return jobs;
+}
+
+std::optional<std::vector<Job>> load_glob_manifest(const BatchOptions& options) {
+    auto inputs = list_inputs(options.manifest);
+    if (!inputs) return {};
+    std::vector<Job> jobs;
+    for (auto& input : *inputs) {
+        Job job   = options.defaults;
+        job.input = std::move(input);
+        if (!options.output_dir.empty()) {
+            // cfg files are exported as json, everything else is converted to cfg.
+            auto extension = is_cfg_input(job.input) ? ".json" : ".cfg";
+            auto stem      = std::filesystem::path(job.input).stem();
+            job.output     = (std::filesystem::path(options.output_dir) / stem).string() + extension;
+        }
+        jobs.emplace_back(std::move(job));
+    }
+    return jobs;
+}
+
+// One directory snapshot per image directory, shared by every parameter file of the batch living there.
+class ImageIndexCache {
+public:
+    void attach(Job& job) {
+        if (!job.auto_scan_args.enabled || !job.input.ends_with(".txt")) return;
+        auto directory = std::filesystem::path(job.input).parent_path();
+        if (directory.empty()) directory = "./";
+        std::promise<std::shared_ptr<const rockchip::RKImageIndex>>       promise;
+        std::shared_future<std::shared_ptr<const rockchip::RKImageIndex>> future;
+        bool                                                              inserted{};
+        {
+            std::lock_guard lock(m_mutex);
+            auto [it, is_new] = m_indexes.try_emplace(directory.lexically_normal().string());
+            if (is_new) it->second = promise.get_future().share();
+            future   = it->second;
+            inserted = is_new;
+        }
+        if (inserted) {
+            // A failed scan leaves the index empty, fromParameter retries and reports it for the job. The cache
+            // keys on the file sizes and mtimes too.
+            std::error_code ec;
+            promise.set_value(rockchip::RKImageIndex::scan(directory, ec, job.cache != nullptr));
+        }
+        job.auto_scan_args.index = future.get();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const rockchip::RKImageIndex>>> m_indexes;
+};
+
+} // namespace
+
+std::optional<std::vector<std::string>> list_inputs(const std::string& pattern) {
+    std::filesystem::path directory = pattern;
+    std::string           wildcard  = "*";
+    if (!std::filesystem::is_directory(directory)) {
+        wildcard  = directory.filename().string();
+        directory = directory.parent_path();
+        if (directory.empty()) directory = "./";
+    }
+    std::error_code ec;
+    auto            iterator = std::filesystem::directory_iterator(directory, ec);
+    if (ec) {
+        spdlog::error("Unable to list {}: {}", directory.string(), ec.message());
+        return {};
+    }
+    std::vector<std::string> inputs;
+    for (auto& entry : iterator) {
+        auto filename = entry.path().filename().string();
+        if (!entry.is_regular_file() || !util::string::match_wildcard(wildcard, filename)) continue;
+        inputs.emplace_back(entry.path().string());
+    }
+    std::sort(inputs.begin(), inputs.end());
+    return inputs;
+}
+
+int run_batch(const BatchOptions& options) {
+    auto jobs = is_ndjson_manifest(options.manifest) ? load_ndjson_manifest(options) : load_glob_manifest(options);
+    if (!jobs) return -1;
+    // Jobs with the same filters share one compiled plan. Invalid expressions are left to each job to report.
+    std::map<std::vector<std::string>, FilterPlans> plans;
+    for (auto& job : *jobs) {
+        if (job.remove_partitions.empty()) continue;
+        auto [it, inserted] = plans.try_emplace(job.remove_partitions);
+        if (inserted) {
+            std::error_code ec;
+            it->second = compile_filters(job.remove_partitions, ec);
+        }
+        job.filter_plans = it->second;
+    }
+    if (!options.output_dir.empty()) std::filesystem::create_directories(options.output_dir);
+
+    // One stream for the whole batch: the column names first, then the rows of each file as it is done.
+    if (options.defaults.show_format) {
+        fmt::memory_buffer header;
+        rockchip::RKTextWriter::writeHeader(*options.defaults.show_format, header);
+        std::fwrite(header.data(), 1, header.size(), stdout);
+        for (auto& job : *jobs) job.show_header = false;
+    }
+
+    util::ThreadPool      pool;
+    ImageIndexCache       indexes;
+    std::atomic<size_t>   failed{};
+    std::atomic<uint64_t> bytes_read{};
+
+    spdlog::info("Running {} jobs on {} threads...", jobs->size(), pool.size());
+    auto begin = std::chrono::steady_clock::now();
+    auto run   = [&](const Job& job) {
+        std::error_code           ec;
+        rockchip::RKErrorLocation location;
+        try {
+            auto local = job;
+            local.pool = &pool;
+            indexes.attach(local);
+            run_job(local, ec, location);
+        } catch (const std::exception& e) {
+            spdlog::error("{}: {}", job.input, e.what());
+            failed++;
+            return;
+        }
+        if (ec) {
+            spdlog::error("{}: {}", job.input, describe_error(ec, location));
+            failed++;
+            return;
+        }
+        if (job.input_data) {
+            bytes_read += job.input_data->size();
+            return;
+        }
+        std::error_code size_ec;
+        auto            size = std::filesystem::file_size(job.input, size_ec);
+        if (!size_ec) bytes_read += size;
+    };
+
+    // Plain cfg inputs (not patched in place) are read ahead in bulk, io_uring batching the opens and reads of a
+    // whole chunk into a few system calls, and each job is queued as soon as its file is in. A chunk is only read
+    // once fewer than a chunk of contents wait for their jobs, which bounds the memory held.
+    std::vector<size_t> read_ahead;
+    for (size_t idx = 0; idx < jobs->size(); idx++) {
+        const auto& job = (*jobs)[idx];
+        if (is_cfg_input(job.input) && job.patches.empty()) {
+            read_ahead.push_back(idx);
+        } else {
+            pool.submit([&, idx] { run((*jobs)[idx]); });
+        }
+    }
+    std::atomic<size_t> waiting{};
+    for (size_t first = 0; first < read_ahead.size(); first += read_ahead_chunk) {
+        for (auto count = waiting.load(); count >= read_ahead_chunk; count = waiting.load()) waiting.wait(count);
+        auto chunk  = std::span(read_ahead).subspan(first, std::min(read_ahead_chunk, read_ahead.size() - first));
+        waiting    += chunk.size();
+        std::vector<std::string> paths;
+        for (auto idx : chunk) paths.push_back((*jobs)[idx].input);
+        auto queue = [&](size_t idx, auto&& buffer, auto&& view, const std::error_code& ec) {
+            auto job_idx = chunk[idx];
+            if (view) (*jobs)[job_idx].input_data = std::make_shared<const InputBuffer>(std::move(buffer));
+            pool.submit([&, job_idx, ec] {
+                auto& job = (*jobs)[job_idx];
+                if (ec) {
+                    spdlog::error("{}: {}", job.input, describe_error(ec, {}));
+                    failed++;
+                } else {
+                    run(job);
+                }
+                job.input_data.reset();
+                waiting--;
+                waiting.notify_one();
+            });
+        };
+        rockchip::RKCfgView::openAll(paths, pool, queue);
+    }
+    pool.wait();
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    spdlog::info(
+        "Batch finished: {} jobs, {} succeeded, {} failed in {:.3f}s ({:.1f} jobs/s, {:.2f} MiB/s read).",
+        jobs->size(),
+        jobs->size() - failed,
+        failed.load(),
+        seconds,
+        seconds > 0 ? jobs->size() / seconds : 0.0,
+        seconds > 0 ? bytes_read / seconds / (1024 * 1024) : 0.0
+    );
+    return failed ? -1 : 0;
+}
+
+} // namespace cli
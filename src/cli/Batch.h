@@ -0,0 +1,27 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Job.h"
+
+namespace cli {
+
+struct BatchOptions {
+    // NDJSON file (.json, .jsonl, .ndjson), a directory, or a glob like "./cfgs/*.cfg".
+    std::string manifest;
+    // Output directory for directory/glob manifests, NDJSON jobs name their own outputs.
+    std::string output_dir;
+    // Options applied to every job unless an NDJSON line overrides them.
+    Job defaults;
+};
+
+// Regular files of a directory, or of the files matching a glob such as "./cfgs/*.cfg" (wildcards in the file name
+// only), sorted. Logs why and returns nothing if the directory cannot be listed.
+std::optional<std::vector<std::string>> list_inputs(const std::string& pattern);
+
+// Runs every job of the manifest on a thread pool sized to the core count and returns the process exit code.
+int run_batch(const BatchOptions& options);
+
+} // namespace cli
@@ -0,0 +1,179 @@
+#include "Cache.h"
+
+#include "Job.h"
+
+#include "util/Hash.h"
+#include "util/MappedFile.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+using namespace rockchip;
+
+namespace cli {
+
+namespace {
+
+// Bumped whenever the output of a conversion changes for the same inputs.
+constexpr std::string_view cache_version = "rkcfgtool-output-cache-1";
+
+constexpr std::string_view temp_suffix = ".tmp";
+
+struct Entry {
+    std::filesystem::path           path;
+    uint64_t                        size;
+    std::filesystem::file_time_type mtime;
+};
+
+std::vector<Entry> list_entries(const std::string& directory) {
+    std::vector<Entry> entries;
+    std::error_code    ec;
+    for (auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        std::error_code entry_ec;
+        if (!entry.is_regular_file(entry_ec) || entry.path().filename().string().ends_with(temp_suffix)) continue;
+        auto size  = entry.file_size(entry_ec);
+        auto mtime = entry.last_write_time(entry_ec);
+        if (!entry_ec) entries.push_back({entry.path(), size, mtime});
+    }
+    return entries;
+}
+
+std::string directory_of(const std::string& path) {
+    auto directory = std::filesystem::path(path).parent_path();
+    if (directory.empty()) directory = "./";
+    return directory.lexically_normal().string();
+}
+
+} // namespace
+
+std::shared_ptr<OutputCache> OutputCache::open(const std::string& directory, uint64_t max_size, std::error_code& ec) {
+    std::filesystem::create_directories(directory, ec);
+    if (ec) return {};
+    auto cache          = std::make_shared<OutputCache>();
+    cache->m_directory  = directory;
+    cache->m_max_size   = max_size;
+    for (const auto& entry : list_entries(directory)) cache->m_bytes += entry.size;
+    return cache;
+}
+
+std::optional<std::string> OutputCache::key(const Job& job, RKCfgFile::AutoScanArgument& auto_scan_args) {
+    if (!job.input.ends_with(".txt") || job.output.empty() || !job.patches.empty()) return {};
+    std::error_code ec;
+    auto            parameter = util::MappedFile::open(job.input, ec);
+    if (!parameter) return {};
+
+    util::Sha256 hasher;
+    hasher.update(cache_version);
+    hasher.update(uint64_t(parameter->size()));
+    hasher.update(parameter->bytes());
+    hasher.update(uint64_t(job.auto_scan_args.enabled));
+    hasher.update(uint64_t(job.auto_scan_args.prefix.size()));
+    hasher.update(job.auto_scan_args.prefix);
+    hasher.update(uint64_t(job.remove_partitions.size()));
+    for (const auto& expression : job.remove_partitions) {
+        hasher.update(uint64_t(expression.size()));
+        hasher.update(expression);
+    }
+    hasher.update(uint64_t(output_mode(job.output, job.compact_json)));
+
+    if (job.auto_scan_args.enabled) {
+        // The input path is written as is into the image path of the parameter item.
+        hasher.update(uint64_t(job.input.size()));
+        hasher.update(job.input);
+        auto directory = directory_of(job.input);
+        auto& index    = auto_scan_args.index;
+        if (!index || index->getFileInfo().size() != index->getFiles().size() ||
+            !std::filesystem::equivalent(index->getDirectory(), directory, ec))
+            index = RKImageIndex::scan(directory, ec, true);
+        if (!index) return {};
+        // The parameter file is hashed by content, and an output written next to it must not change the key of
+        // the next run.
+        auto input_name  = std::filesystem::path(job.input).filename().string();
+        auto output_name = directory_of(job.output) == directory
+                             ? std::filesystem::path(job.output).filename().string()
+                             : std::string();
+        const auto& files = index->getFiles();
+        const auto& info  = index->getFileInfo();
+        for (size_t i = 0; i < files.size(); i++) {
+            if (files[i] == input_name || files[i] == output_name) continue;
+            hasher.update(uint64_t(files[i].size()));
+            hasher.update(files[i]);
+            hasher.update(info[i].size);
+            hasher.update(uint64_t(info[i].mtime));
+        }
+    }
+    return util::Sha256::toHex(hasher.finish()) + (job.output.ends_with(".json") ? ".json" : ".cfg");
+}
+
+bool OutputCache::fetch(const std::string& key, const std::string& output) {
+    auto            entry = entryPath(key);
+    std::error_code ec;
+    std::filesystem::copy_file(entry, output, std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec) {
+        m_misses++;
+        return false;
+    }
+    // The mtime of an entry is its last use, see evict.
+    std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), ec);
+    m_hits++;
+    return true;
+}
+
+void OutputCache::store(const std::string& key, const std::string& output) {
+    auto entry = entryPath(key);
+    // Written under a unique name first, so that concurrent readers never see a partial entry.
+    auto            temp = fmt::format("{}.{:016x}{}", entry, std::random_device{}(), temp_suffix);
+    std::error_code ec;
+    std::filesystem::copy_file(output, temp, std::filesystem::copy_options::overwrite_existing, ec);
+    if (!ec) std::filesystem::rename(temp, entry, ec);
+    if (ec) {
+        spdlog::debug("Unable to cache {}: {}", output, ec.message());
+        std::filesystem::remove(temp, ec);
+        return;
+    }
+    m_stores++;
+    auto size = std::filesystem::file_size(entry, ec);
+    if (!ec && (m_bytes += size) > m_max_size && m_max_size) evict();
+}
+
+void OutputCache::evict() {
+    if (!m_max_size) return;
+    std::lock_guard lock(m_mutex);
+    auto            entries = list_entries(m_directory);
+    uint64_t        total{};
+    for (const auto& entry : entries) total += entry.size;
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.mtime < rhs.mtime;
+    });
+    for (auto it = entries.begin(); it != entries.end() && total > m_max_size; it++) {
+        std::error_code ec;
+        if (!std::filesystem::remove(it->path, ec)) continue;
+        total -= it->size;
+        m_evictions++;
+    }
+    m_bytes = total;
+}
+
+OutputCache::Stats OutputCache::getStats() {
+    Stats stats;
+    stats.hits      = m_hits;
+    stats.misses    = m_misses;
+    stats.stores    = m_stores;
+    stats.evictions = m_evictions;
+    for (const auto& entry : list_entries(m_directory)) {
+        stats.entries++;
+        stats.bytes += entry.size;
+    }
+    return stats;
+}
+
+std::string OutputCache::entryPath(const std::string& key) const {
+    return (std::filesystem::path(m_directory) / key).string();
+}
+
+} // namespace cli
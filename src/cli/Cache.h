@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+
+#include "rockchip/RKCfg.h"
+
+namespace cli {
+
+struct Job;
+
+// On-disk cache of parameter.txt conversions, one file per output named after the hash of everything the output
+// depends on: the parameter file contents, the auto scan arguments, the partition filters, the output format and,
+// with auto scan, the image directory snapshot (names, sizes, mtimes). Entries are touched on every hit and the
+// least recently used ones are evicted once the cache grows over its size limit. Thread-safe.
+class OutputCache {
+public:
+    struct Stats {
+        uint64_t hits{};
+        uint64_t misses{};
+        uint64_t stores{};
+        uint64_t evictions{};
+        uint64_t entries{};
+        uint64_t bytes{};
+    };
+
+    // Creates the directory if needed. A max_size of 0 means unbounded.
+    // TODO: Replace with: std::expected
+    static std::shared_ptr<OutputCache> open(const std::string& directory, uint64_t max_size, std::error_code& ec);
+
+    // Key of the job's output, nothing if the job cannot be cached (not a parameter file, no output, patches, or
+    // the parameter file cannot be read, which the conversion itself then reports). With auto scan,
+    // auto_scan_args (the job's, copied) is given a directory snapshot with file info, to be passed on to the
+    // conversion so that it does not list the directory again.
+    std::optional<std::string> key(const Job& job, rockchip::RKCfgFile::AutoScanArgument& auto_scan_args);
+
+    // Copies the cached output of key to output. Counts a hit or a miss.
+    bool fetch(const std::string& key, const std::string& output);
+
+    // Copies output into the cache, then evicts the oldest entries if the cache has grown too large. Failures are
+    // only logged, the cache is an optimization.
+    void store(const std::string& key, const std::string& output);
+
+    // Evicts least recently used entries until the cache fits its size limit.
+    void evict();
+
+    Stats getStats();
+
+private:
+    std::string entryPath(const std::string& key) const;
+
+    std::string           m_directory;
+    uint64_t              m_max_size{};
+    std::mutex            m_mutex; // guards eviction
+    std::atomic<uint64_t> m_bytes{};
+    std::atomic<uint64_t> m_hits{};
+    std::atomic<uint64_t> m_misses{};
+    std::atomic<uint64_t> m_stores{};
+    std::atomic<uint64_t> m_evictions{};
+};
+
+} // namespace cli
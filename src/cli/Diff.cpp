@@ -0,0 +1,233 @@
+#include "Diff.h"
+
+#include "Batch.h"
+#include "Job.h"
+
+#include "rockchip/RKCfgDiff.h"
+#include "rockchip/RKCfgView.h"
+#include "rockchip/RKJsonWriter.h"
+#include "util/String.h"
+#include "util/ThreadPool.h"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+using namespace rockchip;
+
+namespace cli {
+
+namespace {
+
+// cfg files are only mapped, the other formats are converted as run_job does.
+struct Input {
+    std::optional<RKCfgFile> file;
+    std::optional<RKCfgView> view;
+};
+
+void load(const std::string& path, Input& input, std::error_code& ec, RKErrorLocation& location) {
+    if (path.ends_with(".json") || path.ends_with(".txt") || path.ends_with(".img")) {
+        input.file = load_file(path, {}, ec, location);
+        if (input.file) input.view.emplace(*input.file);
+    } else {
+        input.view = RKCfgView::open(path, ec);
+    }
+}
+
+// UTF-8 name and image path of an item.
+struct ItemText {
+    explicit ItemText(const RKCfgItem& item) {
+        name       = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE, name_buffer);
+        image_path = util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE, image_path_buffer);
+    }
+
+    char             name_buffer[RKCfgItem::RK_V286_MAX_NAME_SIZE * 3];
+    char             image_path_buffer[RKCfgItem::RK_V286_MAX_PATH_SIZE * 3];
+    std::string_view name;
+    std::string_view image_path;
+};
+
+std::string_view or_empty(std::string_view str) { return str.empty() ? "(empty)" : str; }
+
+void write_text(
+    const std::string&                    base_path,
+    const std::string&                    path,
+    std::span<const RKCfgItem>            base,
+    std::span<const RKCfgItem>            items,
+    const std::vector<RKCfgDiff::Change>& changes,
+    fmt::memory_buffer&                   out
+) {
+    if (changes.empty()) return;
+    auto it = std::back_inserter(out);
+    fmt::format_to(it, "--- {}\n+++ {}\n", base_path, path);
+    for (const auto& change : changes) {
+        if (change.kind != RKCfgDiff::Change::Modified) {
+            bool        added = change.kind == RKCfgDiff::Change::Added;
+            const auto& item  = added ? items[change.other_index] : base[change.base_index];
+            ItemText    text(item);
+            fmt::format_to(
+                it,
+                "{} {}: {:#010x} {} {}\n",
+                added ? '+' : '-',
+                or_empty(text.name),
+                item.address,
+                item.is_selected ? "[x]" : "[ ]",
+                or_empty(text.image_path)
+            );
+            continue;
+        }
+        const auto& from = base[change.base_index];
+        const auto& to   = items[change.other_index];
+        ItemText    from_text(from);
+        ItemText    to_text(to);
+        fmt::format_to(it, "~ {}:", or_empty(to_text.name));
+        auto separator = " ";
+        if (change.fields & RKCfgDiff::Address) {
+            fmt::format_to(it, "{}address {:#010x} -> {:#010x}", separator, from.address, to.address);
+            separator = ", ";
+        }
+        if (change.fields & RKCfgDiff::ImagePath) {
+            auto from_path = or_empty(from_text.image_path);
+            fmt::format_to(it, "{}image_path {} -> {}", separator, from_path, or_empty(to_text.image_path));
+            separator = ", ";
+        }
+        if (change.fields & RKCfgDiff::Selected) {
+            fmt::format_to(it, "{}selected {} -> {}", separator, from.is_selected ? 1 : 0, to.is_selected ? 1 : 0);
+        }
+        out.push_back('\n');
+    }
+}
+
+void write_json(
+    const std::string&                    base_path,
+    const std::string&                    path,
+    std::span<const RKCfgItem>            base,
+    std::span<const RKCfgItem>            items,
+    const std::vector<RKCfgDiff::Change>& changes,
+    fmt::memory_buffer&                   out
+) {
+    auto it = std::back_inserter(out);
+    out.append(std::string_view("{\"base\":"));
+    RKJsonWriter::writeString(base_path, out);
+    out.append(std::string_view(",\"variant\":"));
+    RKJsonWriter::writeString(path, out);
+    out.append(std::string_view(",\"changes\":["));
+    for (size_t idx = 0; idx < changes.size(); idx++) {
+        const auto& change = changes[idx];
+        if (idx) out.push_back(',');
+        out.append(std::string_view("{\"name\":"));
+        if (change.kind != RKCfgDiff::Change::Modified) {
+            bool        added = change.kind == RKCfgDiff::Change::Added;
+            const auto& item  = added ? items[change.other_index] : base[change.base_index];
+            ItemText    text(item);
+            RKJsonWriter::writeString(text.name, out);
+            fmt::format_to(
+                it,
+                ",\"change\":\"{}\",\"address\":{},\"selected\":{},\"image_path\":",
+                added ? "added" : "removed",
+                item.address,
+                item.is_selected ? "true" : "false"
+            );
+            RKJsonWriter::writeString(text.image_path, out);
+            out.push_back('}');
+            continue;
+        }
+        const auto& from = base[change.base_index];
+        const auto& to   = items[change.other_index];
+        ItemText    from_text(from);
+        ItemText    to_text(to);
+        RKJsonWriter::writeString(to_text.name, out);
+        out.append(std::string_view(",\"change\":\"modified\""));
+        if (change.fields & RKCfgDiff::Address) {
+            fmt::format_to(it, ",\"address\":{{\"from\":{},\"to\":{}}}", from.address, to.address);
+        }
+        if (change.fields & RKCfgDiff::ImagePath) {
+            out.append(std::string_view(",\"image_path\":{\"from\":"));
+            RKJsonWriter::writeString(from_text.image_path, out);
+            out.append(std::string_view(",\"to\":"));
+            RKJsonWriter::writeString(to_text.image_path, out);
+            out.push_back('}');
+        }
+        if (change.fields & RKCfgDiff::Selected) {
+            fmt::format_to(
+                it,
+                ",\"selected\":{{\"from\":{},\"to\":{}}}",
+                from.is_selected ? "true" : "false",
+                to.is_selected ? "true" : "false"
+            );
+        }
+        out.push_back('}');
+    }
+    out.append(std::string_view("]}\n"));
+}
+
+} // namespace
+
+int run_diff(const DiffOptions& options) {
+    std::error_code ec;
+    RKErrorLocation location;
+    Input           base;
+    load(options.base, base, ec, location);
+    if (ec) {
+        spdlog::error("{}: {}", options.base, describe_error(ec, location));
+        return -1;
+    }
+
+    // Directories and globs are expanded, the baseline is left out of them.
+    std::vector<std::string> variants;
+    auto                     base_path = std::filesystem::path(options.base).lexically_normal();
+    for (const auto& variant : options.variants) {
+        bool is_pattern = variant.find_first_of("*?") != std::string::npos || std::filesystem::is_directory(variant);
+        if (!is_pattern) {
+            variants.emplace_back(variant);
+            continue;
+        }
+        auto inputs = list_inputs(variant);
+        if (!inputs) return -1;
+        for (auto& input : *inputs) {
+            if (std::filesystem::path(input).lexically_normal() != base_path) variants.emplace_back(std::move(input));
+        }
+    }
+
+    RKCfgDiff                diff(base.view->getItems());
+    std::vector<std::string> outputs(variants.size());
+    std::atomic<bool>        failed{};
+    std::atomic<bool>        differs{};
+    util::ThreadPool         pool;
+    pool.parallelFor(variants.size(), [&](size_t idx) {
+        std::error_code ec;
+        RKErrorLocation location;
+        Input           variant;
+        try {
+            load(variants[idx], variant, ec, location);
+        } catch (const std::exception& e) {
+            spdlog::error("{}: {}", variants[idx], e.what());
+            failed = true;
+            return;
+        }
+        if (ec) {
+            spdlog::error("{}: {}", variants[idx], describe_error(ec, location));
+            failed = true;
+            return;
+        }
+        auto items   = variant.view->getItems();
+        auto changes = diff.compare(items);
+        if (!changes.empty()) differs = true;
+
+        thread_local fmt::memory_buffer buffer;
+        buffer.clear();
+        auto write = options.json ? write_json : write_text;
+        write(options.base, variants[idx], diff.getBase(), items, changes, buffer);
+        outputs[idx].assign(buffer.data(), buffer.size());
+    });
+
+    for (const auto& output : outputs) std::fwrite(output.data(), 1, output.size(), stdout);
+    if (failed) return -1;
+    return differs ? 1 : 0;
+}
+
+} // namespace cli
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace cli {
+
+struct DiffOptions {
+    // cfg, json, parameter.txt or update image, like the variants.
+    std::string base;
+    // Files, directories or globs such as "./variants/*.cfg" (see list_inputs).
+    std::vector<std::string> variants;
+    bool                     json{};
+};
+
+// Compares every variant with the baseline on a thread pool, the baseline being loaded and indexed once, and prints
+// the changes to stdout in the order of the variants: as text ("~ boot: address 0x00004000 -> 0x00006000", "+ name"
+// and "- name" lines under a "--- base" / "+++ variant" header, nothing for identical files) or as one json object per
+// variant. Returns 0 if every variant matches the baseline, 1 if any differs, -1 if a file could not be loaded.
+int run_diff(const DiffOptions& options);
+
+} // namespace cli
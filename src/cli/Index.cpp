@@ -0,0 +1,86 @@
+#include "Index.h"
+
+#include "Job.h"
+
+#include "rockchip/RKCfgIndex.h"
+#include "rockchip/RKJsonWriter.h"
+#include "util/ThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+using namespace rockchip;
+
+namespace cli {
+
+int run_index_build(const IndexBuildOptions& options) {
+    util::ThreadPool       pool;
+    RKCfgIndex::BuildStats stats;
+    std::error_code        ec;
+    auto                   begin = std::chrono::steady_clock::now();
+    RKCfgIndex::build(options.directory, options.index, pool, stats, ec);
+    if (ec) {
+        spdlog::error("{}: {}", options.index, describe_error(ec, {}));
+        return -1;
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    spdlog::info(
+        "Indexed {} files ({} unchanged, {} parsed, {} skipped), {} items and {} strings in {:.3f}s.",
+        stats.files,
+        stats.reused,
+        stats.parsed,
+        stats.failed,
+        stats.items,
+        stats.strings,
+        seconds
+    );
+    return 0;
+}
+
+int run_index_query(const IndexQueryOptions& options) {
+    std::error_code ec;
+    auto            index = RKCfgIndex::open(options.index, ec);
+    if (!index) {
+        spdlog::error("{}: {}", options.index, describe_error(ec, {}));
+        return -1;
+    }
+    auto matches = index->find({options.name, options.image, options.address});
+
+    fmt::memory_buffer buffer;
+    auto               it = std::back_inserter(buffer);
+    for (const auto& match : matches) {
+        if (!options.json) {
+            fmt::format_to(
+                it,
+                "{}: [{}] {:#010x} {} {}\n",
+                match.file,
+                match.is_selected ? "x" : " ",
+                match.address,
+                match.name.empty() ? "(empty)" : match.name,
+                match.image_path.empty() ? "(empty)" : match.image_path
+            );
+            continue;
+        }
+        buffer.append(std::string_view("{\"file\":"));
+        RKJsonWriter::writeString(match.file, buffer);
+        fmt::format_to(
+            it,
+            ",\"index\":{},\"selected\":{},\"address\":{},\"name\":",
+            match.index,
+            match.is_selected ? "true" : "false",
+            match.address
+        );
+        RKJsonWriter::writeString(match.name, buffer);
+        buffer.append(std::string_view(",\"image_path\":"));
+        RKJsonWriter::writeString(match.image_path, buffer);
+        buffer.append(std::string_view("}\n"));
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+    return matches.empty() ? 1 : 0;
+}
+
+} // namespace cli
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace cli {
+
+struct IndexBuildOptions {
+    // Searched recursively for .cfg files.
+    std::string directory;
+    std::string index;
+};
+
+struct IndexQueryOptions {
+    std::string                index;
+    std::optional<std::string> name;
+    // Image file name, or whole image path.
+    std::optional<std::string> image;
+    std::optional<uint32_t>    address;
+    bool                       json{};
+};
+
+// Builds or updates the index of a directory tree, see RKCfgIndex::build. Returns the process exit code.
+int run_index_build(const IndexBuildOptions& options);
+
+// Prints the items matching every given criterion to stdout, one line per item: as text ("file: [x] address name
+// image_path") or as json objects. Returns 0 if something matched, 1 if nothing did, -1 on errors.
+int run_index_query(const IndexQueryOptions& options);
+
+} // namespace cli
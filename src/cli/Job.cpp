@@ -0,0 +1,312 @@
+#include "Job.h"
+
+#include "Cache.h"
+
+#include "rockchip/RKCfgView.h"
+#include "rockchip/RKImageManifest.h"
+#include "rockchip/RKJsonWriter.h"
+#include "rockchip/RKUpdateImage.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+using namespace rockchip;
+
+namespace cli {
+
+namespace {
+
+void show(const Job& job, const RKCfgView& view) {
+    if (!job.show_format) {
+        view.printDebugString();
+        return;
+    }
+    // Reused by every job of the thread, a single fwrite keeps the rows of a file together in a batch.
+    thread_local fmt::memory_buffer buffer;
+    buffer.clear();
+    if (job.show_header) RKTextWriter::writeHeader(*job.show_format, buffer);
+    RKTextWriter::write(*job.show_format, job.input, view.getHeader(), view.getItems(), buffer);
+    std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+}
+
+// The cfg file image paths are relative to.
+std::string cfg_path_of(const Job& job) {
+    return !job.output.empty() && !job.output.ends_with(".json") ? job.output : job.input;
+}
+
+void check_images(const Job& job, const RKCfgView& view, std::error_code& ec) {
+    auto cfg_path      = cfg_path_of(job);
+    auto manifest_path = RKImageManifest::pathOf(cfg_path);
+
+    std::optional<RKImageManifest> previous;
+    if (std::filesystem::exists(manifest_path)) {
+        previous = RKImageManifest::load(manifest_path, ec);
+        if (!previous) {
+            if (job.verify_images) return;
+            spdlog::warn("{}: {} Every image is hashed again.", manifest_path, ec.message());
+            ec.clear();
+        }
+    } else if (job.verify_images) {
+        spdlog::warn("{} does not exist, only the presence of the images is checked.", manifest_path);
+    }
+
+    std::optional<util::ThreadPool> local_pool;
+    auto                            pool = job.pool ? job.pool : &local_pool.emplace();
+    std::vector<std::string>        missing;
+    auto manifest = RKImageManifest::build(cfg_path, view.getItems(), previous ? &*previous : nullptr, *pool, missing);
+    spdlog::info(
+        "{}: {} images, {} hashed ({:.2f} MiB).",
+        cfg_path,
+        manifest.getRecords().size() + missing.size(),
+        manifest.getHashedImages(),
+        manifest.getHashedBytes() / (1024.0 * 1024.0)
+    );
+    for (const auto& path : missing) spdlog::error("{}: image {} not found.", cfg_path, path);
+
+    size_t mismatches{};
+    if (job.verify_images && previous) {
+        for (const auto& record : manifest.getRecords()) {
+            auto expected = previous->find(record.path);
+            if (!expected || (expected->sha256 == record.sha256 && expected->crc32 == record.crc32)) continue;
+            spdlog::error("{}: {} does not match the manifest.", cfg_path, record.path);
+            mismatches++;
+        }
+    }
+
+    if (job.emit_manifest) {
+        manifest.save(manifest_path, ec);
+        if (ec) return;
+        spdlog::info("Manifest has been saved to {}", manifest_path);
+    }
+    if (!missing.empty()) ec = make_rkcfg_image_manifest_error(RKImageManifestErrorCode::ImageNotFound);
+    else if (mismatches) ec = make_rkcfg_image_manifest_error(RKImageManifestErrorCode::ImageMismatch);
+}
+
+// Diagnostics to the layout report (stdout by default), one NDJSON line each and one write per file. Errors fail the
+// job, warnings do not.
+void check_layout(const Job& job, const RKCfgView& view, std::error_code& ec) {
+    RKErrorLocation                                       location;
+    std::optional<std::vector<RKLayoutCheck::Diagnostic>> diagnostics;
+    std::string                                           parameter_path = job.input;
+    if (job.input.ends_with(".img")) {
+        auto image = RKUpdateImage::open(job.input, ec);
+        if (!image) return;
+        diagnostics = RKLayoutCheck::checkUpdateImage(*image, *job.check_layout, ec, location);
+    } else {
+        auto cfg_path = cfg_path_of(job);
+        if (!job.input.ends_with(".txt")) {
+            auto parameter = RKLayoutCheck::findParameter(cfg_path, view.getItems(), ec);
+            if (!parameter) return;
+            parameter_path = std::move(*parameter);
+        }
+        diagnostics =
+            RKLayoutCheck::checkParameter(parameter_path, cfg_path, view.getItems(), *job.check_layout, ec, location);
+    }
+    if (!diagnostics) {
+        if (location.line) spdlog::debug("{}: line {}, column {}", parameter_path, location.line, location.column);
+        return;
+    }
+
+    thread_local fmt::memory_buffer buffer;
+    buffer.clear();
+    auto   it = std::back_inserter(buffer);
+    size_t errors{};
+    for (const auto& diagnostic : *diagnostics) {
+        if (diagnostic.severity == RKLayoutCheck::Error) errors++;
+        buffer.append(std::string_view("{\"file\":"));
+        RKJsonWriter::writeString(job.input, buffer);
+        fmt::format_to(
+            it,
+            ",\"severity\":\"{}\",\"code\":\"{}\",\"partition\":",
+            RKLayoutCheck::severityName(diagnostic.severity),
+            RKLayoutCheck::codeName(diagnostic.code)
+        );
+        RKJsonWriter::writeString(diagnostic.partition, buffer);
+        buffer.append(std::string_view(",\"other\":"));
+        RKJsonWriter::writeString(diagnostic.other, buffer);
+        buffer.append(std::string_view(",\"message\":"));
+        RKJsonWriter::writeString(diagnostic.message, buffer);
+        buffer.append(std::string_view("}\n"));
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), job.layout_report ? job.layout_report.get() : stdout);
+    spdlog::info("{}: {} partition layout errors, {} warnings.", job.input, errors, diagnostics->size() - errors);
+    if (errors) ec = make_rkcfg_layout_check_error(RKLayoutCheckErrorCode::InvalidLayout);
+}
+
+void pack_update(const Job& job, const RKCfgView& view, std::error_code& ec) {
+    RKUpdateImage::PackOptions options;
+    options.chip = job.pack_chip;
+    std::optional<util::ThreadPool> local_pool;
+    auto                            pool = job.pool ? job.pool : &local_pool.emplace();
+    RKUpdateImage::pack(cfg_path_of(job), view.getItems(), job.pack_update, options, *pool, ec);
+    if (!ec) spdlog::info("Update image has been saved to {}", job.pack_update);
+}
+
+void extract_images(const Job& job, const RKCfgView& view, std::error_code& ec) {
+    auto image = RKUpdateImage::open(job.input, ec);
+    if (!image) return;
+    std::optional<util::ThreadPool> local_pool;
+    auto                            pool = job.pool ? job.pool : &local_pool.emplace();
+    image->extract(cfg_path_of(job), view.getItems(), *pool, ec);
+}
+
+// Extraction, layout and image checks and packing, once the cfg is final.
+void finish_job(const Job& job, const RKCfgView& view, std::error_code& ec) {
+    if (!job.extract_dir.empty() && job.input.ends_with(".img")) extract_images(job, view, ec);
+    if (!ec && job.check_layout) check_layout(job, view, ec);
+    if (!ec && (job.verify_images || job.emit_manifest)) check_images(job, view, ec);
+    if (!ec && !job.pack_update.empty()) pack_update(job, view, ec);
+}
+
+} // namespace
+
+std::string normalize_auto_scan_prefix(std::string prefix) {
+    if (prefix.find("/") != std::string::npos) {
+        if (!prefix.ends_with("/")) prefix += "/";
+    } else if (prefix.find("\\") != std::string::npos) {
+        if (!prefix.ends_with("\\")) prefix += "\\";
+    }
+    return prefix;
+}
+
+std::string describe_error(const std::error_code& ec, const RKErrorLocation& location) {
+    if (!location.line) return ec.message();
+    return fmt::format(
+        "{} (line {}, column {}, byte offset {})",
+        ec.message(),
+        location.line,
+        location.column,
+        location.offset
+    );
+}
+
+Job parse_job(const nlohmann::json& data, Job job) {
+    job.input = data.at("input").get<std::string>();
+    if (data.contains("output")) job.output = data["output"].get<std::string>();
+    if (data.contains("remove_partition")) {
+        job.remove_partitions = data["remove_partition"].get<std::vector<std::string>>();
+        job.filter_plans.reset();
+    }
+    if (data.contains("enable_auto_scan")) job.auto_scan_args.enabled = data["enable_auto_scan"].get<bool>();
+    if (data.contains("auto_scan_prefix"))
+        job.auto_scan_args.prefix = normalize_auto_scan_prefix(data["auto_scan_prefix"].get<std::string>());
+    if (data.contains("show")) job.show = data["show"].get<bool>();
+    if (data.contains("compact_json")) job.compact_json = data["compact_json"].get<bool>();
+    if (data.contains("patch")) job.patches = data["patch"].get<std::vector<std::string>>();
+    if (data.contains("crash_safe")) job.crash_safe = data["crash_safe"].get<bool>();
+    if (data.contains("verify_images")) job.verify_images = data["verify_images"].get<bool>();
+    if (data.contains("emit_manifest")) job.emit_manifest = data["emit_manifest"].get<bool>();
+    if (data.contains("check_layout")) {
+        if (!data["check_layout"].get<bool>()) job.check_layout.reset();
+        else if (!job.check_layout) job.check_layout.emplace();
+    }
+    if (data.contains("layout_alignment") && job.check_layout)
+        job.check_layout->alignment = data["layout_alignment"].get<uint32_t>();
+    if (data.contains("pack_update")) job.pack_update = data["pack_update"].get<std::string>();
+    if (data.contains("pack_chip")) job.pack_chip = data["pack_chip"].get<uint32_t>();
+    if (data.contains("extract_dir")) job.extract_dir = data["extract_dir"].get<std::string>();
+    return job;
+}
+
+FilterPlans compile_filters(const std::vector<std::string>& expressions, std::error_code& ec) {
+    std::vector<RKCfgFile::ItemFilterPlan> plans;
+    plans.reserve(expressions.size());
+    for (const auto& expression : expressions) {
+        auto filters = RKCfgFile::parseItemFilters(expression, ec);
+        if (ec) return {};
+        plans.emplace_back(std::move(filters));
+    }
+    return std::make_shared<const std::vector<RKCfgFile::ItemFilterPlan>>(std::move(plans));
+}
+
+void run_job(const Job& job, std::error_code& ec, RKErrorLocation& location) {
+    if (!job.patches.empty()) {
+        RKCfgFile::ItemPatchCollection patches;
+        for (const auto& expression : job.patches) {
+            auto patch = RKCfgFile::parseItemPatch(expression, ec);
+            if (!patch) return;
+            patches.emplace_back(std::move(*patch));
+        }
+        RKCfgFile::patch(job.input, patches, job.crash_safe, ec);
+        bool check = job.verify_images || job.emit_manifest || job.check_layout || !job.pack_update.empty();
+        if (ec || (job.remove_partitions.empty() && !job.show && job.output.empty() && !check)) return;
+    }
+
+    auto                       auto_scan_args = job.auto_scan_args;
+    std::optional<std::string> cache_key;
+    if (job.cache) cache_key = job.cache->key(job, auto_scan_args);
+    if (cache_key && job.cache->fetch(*cache_key, job.output)) {
+        if (!job.show && !job.verify_images && !job.emit_manifest && !job.check_layout && job.pack_update.empty())
+            return;
+        auto cached = load_file(job.output, {}, ec, location);
+        if (!cached) return;
+        RKCfgView cached_view(*cached);
+        if (job.show) show(job, cached_view);
+        finish_job(job, cached_view, ec);
+        return;
+    }
+
+    // cfg files are only mapped, an owning copy is made once a partition is removed.
+    std::optional<RKCfgView> view;
+    std::optional<RKCfgFile> file;
+
+    if (job.input.ends_with(".json")) {
+        file = RKCfgFile::fromJson(job.input, ec, location);
+    } else if (job.input.ends_with(".txt")) {
+        file = RKCfgFile::fromParameter(job.input, auto_scan_args, ec, location);
+    } else if (job.input.ends_with(".img")) {
+        file = RKCfgFile::fromUpdateImage(job.input, job.extract_dir, ec, location);
+    } else if (job.input_data) {
+        view = RKCfgView::fromBuffer(*job.input_data, ec);
+    } else {
+        view = RKCfgView::open(job.input, ec);
+    }
+    if (ec) return;
+
+    auto plans = job.filter_plans;
+    if (!plans && !job.remove_partitions.empty()) {
+        plans = compile_filters(job.remove_partitions, ec);
+        if (ec) return;
+    }
+    if (plans) {
+        for (const auto& plan : *plans) {
+            if (!file) file = view->toFile();
+            file->removeItem(plan);
+        }
+    }
+
+    if (file) view.emplace(*file);
+
+    if (job.show) show(job, *view);
+
+    if (!job.output.empty()) {
+        view->save(job.output, output_mode(job.output, job.compact_json), ec);
+        if (ec) return;
+        if (cache_key) job.cache->store(*cache_key, job.output);
+    }
+
+    finish_job(job, *view, ec);
+}
+
+std::optional<RKCfgFile> load_file(
+    const std::string&                 input,
+    const RKCfgFile::AutoScanArgument& auto_scan_args,
+    std::error_code&                   ec,
+    RKErrorLocation&                   location
+) {
+    if (input.ends_with(".json")) return RKCfgFile::fromJson(input, ec, location);
+    if (input.ends_with(".txt")) return RKCfgFile::fromParameter(input, auto_scan_args, ec, location);
+    if (input.ends_with(".img")) return RKCfgFile::fromUpdateImage(input, {}, ec, location);
+    return RKCfgFile::fromFile(input, ec);
+}
+
+RKCfgFile::SaveMode output_mode(const std::string& output, bool compact_json) {
+    if (!output.ends_with(".json")) return RKCfgFile::DefaultMode;
+    return compact_json ? RKCfgFile::JsonCompactMode : RKCfgFile::JsonMode;
+}
+
+} // namespace cli
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "rockchip/RKCfg.h"
+#include "rockchip/RKLayoutCheck.h"
+#include "rockchip/RKTextWriter.h"
+#include "util/ThreadPool.h"
+
+namespace cli {
+
+class OutputCache;
+
+// One compiled plan per '--remove-partition' expression, applied in order.
+using FilterPlans = std::shared_ptr<const std::vector<rockchip::RKCfgFile::ItemFilterPlan>>;
+
+using ShowFormat = rockchip::RKTextWriter::Format;
+
+using LayoutCheckOptions = rockchip::RKLayoutCheck::Options;
+
+using InputBuffer = std::vector<std::byte>;
+
+// One input -> output conversion, as described by the command line or by a line of a batch manifest.
+struct Job {
+    std::string                           input;
+    // Contents of a cfg input read ahead by a batch (see RKCfgView::openAll), used instead of mapping the file.
+    std::shared_ptr<const InputBuffer>    input_data;
+    std::string                           output;
+    std::vector<std::string>              remove_partitions;
+    // remove_partitions compiled once (see compile_filters), run_job compiles them itself if missing.
+    FilterPlans                           filter_plans;
+    // '--patch' expressions, applied to the input file in place before anything else.
+    std::vector<std::string>              patches;
+    bool                                  crash_safe{};
+    rockchip::RKCfgFile::AutoScanArgument auto_scan_args;
+    bool                                  show{};
+    // Rendered to stdout in one write per file if set, through the logger otherwise.
+    std::optional<ShowFormat>             show_format;
+    // Column names before the rows (csv and tsv), a batch writes them once itself.
+    bool                                  show_header{true};
+    bool                                  compact_json{};
+    // Outputs of parameter.txt conversions are looked up here first and stored after a miss (if set).
+    std::shared_ptr<OutputCache>          cache;
+    // Hash the images of the resulting cfg, compare them with its manifest and/or write a new manifest.
+    bool                                  verify_images{};
+    bool                                  emit_manifest{};
+    // Check the partition layout of the parameter file (see RKLayoutCheck), diagnostics being written as NDJSON.
+    std::optional<LayoutCheckOptions>     check_layout;
+    // Where the diagnostics go, stdout if missing. Shared by the jobs of a batch, one write per job.
+    std::shared_ptr<std::FILE>            layout_report;
+    // Update image (RKAF, RKFW with a chip code) to pack the selected images of the resulting cfg into.
+    std::string                           pack_update;
+    std::optional<uint32_t>               pack_chip;
+    // For update image inputs, the directory the image paths point into and the selected images are extracted to.
+    std::string                           extract_dir;
+    // Pool to hash the images on, run_job creates one if missing.
+    util::ThreadPool*                     pool{};
+};
+
+// Adds the trailing separator the auto scan prefix is expected to end with (if it contains one at all).
+std::string normalize_auto_scan_prefix(std::string prefix);
+
+// Job described by a json object, e.g. a line of a batch manifest or a server request: {"input", "output",
+// "remove_partition": [...], "enable_auto_scan", "auto_scan_prefix", "show", "compact_json", "patch": [...],
+// "crash_safe", "verify_images", "emit_manifest", "check_layout", "layout_alignment", "pack_update", "pack_chip",
+// "extract_dir"}. Missing keys keep the value of defaults. Throws nlohmann::json::exception on wrong types.
+Job parse_job(const nlohmann::json& data, Job defaults);
+
+// TODO: Replace with: std::expected
+FilterPlans compile_filters(const std::vector<std::string>& expressions, std::error_code& ec);
+
+// Patches job.input in place (if asked to), loads it (cfg, json, parameter.txt or update image by extension), applies
+// the partition filters, then shows and/or saves the result. Plain cfg files are only mapped unless a filter has to
+// modify them. Cached parameter.txt conversions are copied from the cache instead. Finally the selected images of an
+// update image are extracted, the partition layout is checked, then the images are checked against the manifest of
+// the cfg and/or packed into an update image, image paths being relative to the cfg (the output if it is a cfg file,
+// the input otherwise). For text inputs, location tells where the error was found.
+void run_job(const Job& job, std::error_code& ec, rockchip::RKErrorLocation& location);
+
+// Loads an owning copy of a cfg, json, parameter.txt or update image file (by extension), the image paths of an update
+// image being the ones stored in it.
+// TODO: Replace with: std::expected
+std::optional<rockchip::RKCfgFile> load_file(
+    const std::string&                           input,
+    const rockchip::RKCfgFile::AutoScanArgument& auto_scan_args,
+    std::error_code&                             ec,
+    rockchip::RKErrorLocation&                   location
+);
+
+// json for outputs ending with .json, cfg otherwise.
+rockchip::RKCfgFile::SaveMode output_mode(const std::string& output, bool compact_json);
+
+// Error message including the location (if any).
+std::string describe_error(const std::error_code& ec, const rockchip::RKErrorLocation& location);
+
+} // namespace cli
@@ -0,0 +1,61 @@
+#include "Protocol.h"
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <unistd.h>
+
+namespace cli::protocol {
+
+namespace {
+
+bool read_all(int fd, char* data, size_t size) {
+    while (size) {
+        auto count = ::read(fd, data, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size) {
+        auto count = ::write(fd, data, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+} // namespace
+
+bool read_frame(int fd, std::string& body) {
+    unsigned char prefix[4];
+    if (!read_all(fd, reinterpret_cast<char*>(prefix), sizeof(prefix))) return false;
+    uint32_t size = prefix[0] | prefix[1] << 8 | prefix[2] << 16 | (uint32_t)prefix[3] << 24;
+    if (size > max_frame_size) return false;
+    body.resize(size);
+    return read_all(fd, body.data(), size);
+}
+
+bool write_frame(int fd, std::string_view body) {
+    if (body.size() > max_frame_size) return false;
+    auto size = static_cast<uint32_t>(body.size());
+    // One write for small responses, so that they do not leave as two packets.
+    std::string frame;
+    frame.reserve(sizeof(size) + body.size());
+    frame += static_cast<char>(size);
+    frame += static_cast<char>(size >> 8);
+    frame += static_cast<char>(size >> 16);
+    frame += static_cast<char>(size >> 24);
+    frame += body;
+    return write_all(fd, frame.data(), frame.size());
+}
+
+} // namespace cli::protocol
+
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Framing of the serve protocol: every message is a little-endian uint32 length followed by that many bytes of
+// json. Requests and responses are one message each. POSIX only.
+
+namespace cli::protocol {
+
+// Larger frames are refused and the connection is closed.
+inline constexpr uint32_t max_frame_size = 16 * 1024 * 1024;
+
+// Returns false on end of stream, on errors and on oversized frames.
+bool read_frame(int fd, std::string& body);
+
+bool write_frame(int fd, std::string_view body);
+
+} // namespace cli::protocol
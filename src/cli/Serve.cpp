@@ -0,0 +1,266 @@
+#include "Serve.h"
+
+#include "Job.h"
+
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+
+namespace cli {
+
+int run_server(const ServeOptions&) {
+    spdlog::error("serve is only supported on POSIX systems.");
+    return -1;
+}
+
+} // namespace cli
+
+#else
+
+#include "Protocol.h"
+
+#include "rockchip/RKCfgView.h"
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <semaphore>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace rockchip;
+using json = nlohmann::json;
+
+namespace cli {
+
+namespace {
+
+enum class ServeErrorCode { SUCCESS = 0, MalformedRequest, UnknownOperation, NoFileLoaded };
+
+class ServeErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "RKServeError"; }
+    std::string message(int ev) const override {
+        switch (static_cast<ServeErrorCode>(ev)) {
+        case ServeErrorCode::SUCCESS:
+            return "Everything is ok.";
+        case ServeErrorCode::MalformedRequest:
+            return "Malformed request.";
+        case ServeErrorCode::UnknownOperation:
+            return "Unknown operation, expected one of load, remove-partition, show, save or convert.";
+        case ServeErrorCode::NoFileLoaded:
+            return "No file has been loaded on this connection.";
+        default:
+            return {};
+        }
+    }
+};
+
+const ServeErrorCategory serve_error_category{};
+
+std::error_code make_serve_error(ServeErrorCode ec) { return {static_cast<int>(ec), serve_error_category}; }
+
+std::atomic<bool> stop_requested;
+
+void request_stop(int) { stop_requested = true; }
+
+json error_response(const std::error_code& ec, const RKErrorLocation& location = {}) {
+    json error = {{"category", ec.category().name()}, {"code", ec.value()}, {"message", ec.message()}};
+    if (location.line) {
+        error["line"]   = location.line;
+        error["column"] = location.column;
+        error["offset"] = location.offset;
+    }
+    return {{"ok", false}, {"error", std::move(error)}};
+}
+
+// State of one connection: the file the load / remove-partition / show / save requests work on.
+class Session {
+public:
+    json handle(const json& request) {
+        auto op = request.at("op").get<std::string>();
+        if (op == "convert") return convert(request);
+        if (op == "load") return load(request);
+        if (op != "remove-partition" && op != "show" && op != "save")
+            return error_response(make_serve_error(ServeErrorCode::UnknownOperation));
+        if (!m_file) return error_response(make_serve_error(ServeErrorCode::NoFileLoaded));
+        if (op == "remove-partition") return removePartition(request);
+        if (op == "show") return {{"ok", true}, {"cfg", RKCfgView(*m_file).toJson()}};
+        return save(request);
+    }
+
+private:
+    json convert(const json& request) {
+        auto            job = parse_job(request, {});
+        std::error_code ec;
+        RKErrorLocation location;
+        run_job(job, ec, location);
+        if (ec) return error_response(ec, location);
+        return {{"ok", true}};
+    }
+
+    json load(const json& request) {
+        auto            job = parse_job(request, {});
+        std::error_code ec;
+        RKErrorLocation location;
+        auto            file = load_file(job.input, job.auto_scan_args, ec, location);
+        // A failed load keeps the previous file.
+        if (!file) return error_response(ec, location);
+        m_file = std::move(file);
+        return {{"ok", true}, {"items", m_file->getItems().size()}};
+    }
+
+    json removePartition(const json& request) {
+        std::error_code ec;
+        auto plans = compile_filters(request.at("remove_partition").get<std::vector<std::string>>(), ec);
+        if (ec) return error_response(ec);
+        for (const auto& plan : *plans) m_file->removeItem(plan);
+        return {{"ok", true}, {"items", m_file->getItems().size()}};
+    }
+
+    json save(const json& request) {
+        auto            output       = request.at("output").get<std::string>();
+        bool            compact_json = request.value("compact_json", false);
+        std::error_code ec;
+        m_file->save(output, output_mode(output, compact_json), ec);
+        if (ec) return error_response(ec);
+        return {{"ok", true}};
+    }
+
+    std::optional<RKCfgFile> m_file;
+};
+
+// Open connections, shut down on exit so that workers blocked in read return.
+class ConnectionSet {
+public:
+    void add(int fd) {
+        std::lock_guard lock(m_mutex);
+        m_fds.insert(fd);
+    }
+
+    void remove(int fd) {
+        std::lock_guard lock(m_mutex);
+        m_fds.erase(fd);
+    }
+
+    void shutdownAll() {
+        std::lock_guard lock(m_mutex);
+        for (auto fd : m_fds) ::shutdown(fd, SHUT_RDWR);
+    }
+
+private:
+    std::mutex              m_mutex;
+    std::unordered_set<int> m_fds;
+};
+
+void serve_connection(int fd) {
+    Session     session;
+    std::string body;
+    while (!stop_requested && protocol::read_frame(fd, body)) {
+        json response;
+        json id;
+        try {
+            auto request = json::parse(body);
+            if (request.is_object() && request.contains("id")) id = request["id"];
+            response = session.handle(request);
+        } catch (const json::exception& e) {
+            spdlog::debug("Malformed request: {}", e.what());
+            response = error_response(make_serve_error(ServeErrorCode::MalformedRequest));
+            response["error"]["detail"] = e.what();
+        } catch (const std::exception& e) {
+            spdlog::warn("Request failed: {}", e.what());
+            response = error_response(make_serve_error(ServeErrorCode::MalformedRequest));
+            response["error"]["detail"] = e.what();
+        }
+        if (!id.is_null()) response["id"] = std::move(id);
+        if (!protocol::write_frame(fd, response.dump())) break;
+    }
+}
+
+int listen_on(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        spdlog::error("Socket path {} is too long.", path);
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        spdlog::error("Unable to create a socket: {}", std::strerror(errno));
+        return -1;
+    }
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    // A socket left behind by a previous server is replaced, anything else is not touched.
+    std::error_code ec;
+    if (std::filesystem::is_socket(path, ec)) std::filesystem::remove(path, ec);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        spdlog::error("Unable to listen on {}: {}", path, std::strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+int run_server(const ServeOptions& options) {
+    int listener = listen_on(options.socket);
+    if (listener < 0) return -1;
+
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    util::ThreadPool pool(options.threads);
+    ConnectionSet    connections;
+    // A connection is served on one worker until it is closed: accepting more than there are workers would leave
+    // clients connected but unanswered, while the listen backlog makes them wait for a free worker.
+    auto max_connections = options.max_connections ? std::min(options.max_connections, pool.size()) : pool.size();
+
+    std::counting_semaphore<> slots(max_connections);
+    spdlog::info("Serving on {} with {} workers.", options.socket, pool.size());
+
+    while (!stop_requested) {
+        // Waiting with a timeout keeps the loop responsive to signals.
+        if (!slots.try_acquire_for(std::chrono::milliseconds(200))) continue;
+        pollfd request{listener, POLLIN, 0};
+        int    fd = -1;
+        if (::poll(&request, 1, 200) > 0) fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            slots.release();
+            continue;
+        }
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        connections.add(fd);
+        pool.submit([&, fd] {
+            serve_connection(fd);
+            connections.remove(fd);
+            ::close(fd);
+            slots.release();
+        });
+    }
+
+    spdlog::info("Shutting down...");
+    ::close(listener);
+    connections.shutdownAll();
+    pool.wait();
+    std::error_code ec;
+    std::filesystem::remove(options.socket, ec);
+    return 0;
+}
+
+} // namespace cli
+
+#endif
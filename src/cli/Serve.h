@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+namespace cli {
+
+struct ServeOptions {
+    std::string socket;
+    // Workers, 0 means one per hardware thread. Every worker serves one connection at a time.
+    size_t threads{};
+    // Accepted connections at most, further clients wait in the listen backlog. A connection holds its worker until
+    // it is closed, so this is capped to the number of workers, which is also what 0 means.
+    size_t max_connections{};
+};
+
+// Serves requests on a Unix socket until SIGINT or SIGTERM, see Protocol.h for the framing. A request is a json
+// object {"id", "op", ...}, the operations being:
+//  - "load": {"input", "enable_auto_scan", "auto_scan_prefix"}, loads a file into the connection's session;
+//  - "remove-partition": {"remove_partition": [...]}, removes partitions from the session's file;
+//  - "show": returns the session's file as json in "cfg";
+//  - "save": {"output", "compact_json"}, saves the session's file;
+//  - "convert": a whole job as in batch manifests, independent of the session.
+// Responses carry the request's "id" and "ok"; failures add "error": {"category", "code", "message"} using the
+// RKError.h categories (plus "line", "column" and "offset" for text inputs).
+// Returns the process exit code.
+int run_server(const ServeOptions& options);
+
+} // namespace cli
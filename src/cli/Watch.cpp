@@ -0,0 +1,216 @@
+#include "Watch.h"
+
+#include <spdlog/spdlog.h>
+
+#ifndef __linux__
+
+namespace cli {
+
+int run_watch(const WatchOptions&) {
+    spdlog::error("--watch is only supported on Linux.");
+    return -1;
+}
+
+} // namespace cli
+
+#else
+
+#include "rockchip/RKCfgView.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <vector>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace rockchip;
+
+namespace cli {
+
+namespace {
+
+std::atomic<bool> stop_requested;
+
+void request_stop(int) { stop_requested = true; }
+
+// Files being created, written, renamed or removed, and the directory itself going away.
+constexpr uint32_t watch_mask =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF;
+
+// What happened in the directory during one debounce window, a file being in added or removed depending on its
+// last event.
+struct Changes {
+    bool                  parameter{};
+    bool                  overflow{};
+    std::set<std::string> added;
+    std::set<std::string> removed;
+};
+
+class Watcher {
+public:
+    explicit Watcher(const WatchOptions& options) : m_options(options), m_job(options.job) {
+        m_directory = std::filesystem::path(m_job.input).parent_path();
+        if (m_directory.empty()) m_directory = "./";
+        m_parameter_name = std::filesystem::path(m_job.input).filename().string();
+        // Writing the output must not look like an image being added when it lives next to the images.
+        auto            output_dir = std::filesystem::path(m_job.output).parent_path();
+        std::error_code ec;
+        if (std::filesystem::equivalent(output_dir.empty() ? "./" : output_dir, m_directory, ec)) {
+            m_output_name = std::filesystem::path(m_job.output).filename().string();
+            m_temp_name   = m_output_name + std::string(RKCfgView::save_temp_suffix);
+        }
+    }
+
+    ~Watcher() {
+        if (m_fd >= 0) ::close(m_fd);
+    }
+
+    int run() {
+        if (!m_job.remove_partitions.empty()) {
+            std::error_code ec;
+            m_plans = compile_filters(m_job.remove_partitions, ec);
+            if (ec) {
+                spdlog::error(describe_error(ec, {}));
+                return -1;
+            }
+        }
+        m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd < 0 || ::inotify_add_watch(m_fd, m_directory.c_str(), watch_mask) < 0) {
+            spdlog::error("Unable to watch {}: {}", m_directory.string(), std::strerror(errno));
+            return -1;
+        }
+        std::signal(SIGINT, request_stop);
+        std::signal(SIGTERM, request_stop);
+
+        // A broken parameter file is reported and waited for, like any later edit.
+        reparse();
+        spdlog::info("Watching {} for changes.", m_directory.string());
+        while (!stop_requested) {
+            // Waiting with a timeout keeps the loop responsive to signals.
+            pollfd request{m_fd, POLLIN, 0};
+            if (::poll(&request, 1, 200) <= 0) continue;
+            Changes changes;
+            bool    watching = read(changes);
+            while (watching && !stop_requested) {
+                request.revents = 0;
+                if (::poll(&request, 1, static_cast<int>(m_options.debounce.count())) <= 0) break;
+                watching = read(changes);
+            }
+            if (!watching) {
+                spdlog::error("{} is no longer available.", m_directory.string());
+                return -1;
+            }
+            apply(changes);
+        }
+        spdlog::info("Stopped watching {}.", m_directory.string());
+        return 0;
+    }
+
+private:
+    // Drains the pending events into changes, false once the directory itself is gone.
+    bool read(Changes& changes) {
+        alignas(inotify_event) char buffer[16 * 1024];
+        while (true) {
+            auto size = ::read(m_fd, buffer, sizeof(buffer));
+            if (size <= 0) return size == 0 || errno == EAGAIN || errno == EINTR;
+            const inotify_event* event;
+            for (auto ptr = buffer; ptr < buffer + size; ptr += sizeof(inotify_event) + event->len) {
+                event = reinterpret_cast<const inotify_event*>(ptr);
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) return false;
+                if (event->mask & IN_Q_OVERFLOW) changes.overflow = true;
+                if (!event->len || (event->mask & IN_ISDIR)) continue;
+                std::string name = event->name;
+                if (name == m_parameter_name) {
+                    if (event->mask & (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO)) changes.parameter = true;
+                } else if (name == m_output_name || name == m_temp_name) {
+                    continue;
+                } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    changes.removed.erase(name);
+                    changes.added.insert(std::move(name));
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    changes.added.erase(name);
+                    changes.removed.insert(std::move(name));
+                }
+            }
+        }
+    }
+
+    void apply(const Changes& changes) {
+        if (changes.parameter || changes.overflow) {
+            spdlog::info("{} changed, converting it again...", m_job.input);
+            reparse();
+            return;
+        }
+        // Until the parameter file converts, there is nothing to update.
+        if (!m_file || !m_job.auto_scan_args.enabled) return;
+        if (changes.added.empty() && changes.removed.empty()) return;
+        std::vector<std::string> added(changes.added.begin(), changes.added.end());
+        std::vector<std::string> removed(changes.removed.begin(), changes.removed.end());
+        m_index = m_index->withChanges(added, removed);
+        added.insert(added.end(), removed.begin(), removed.end());
+        if (m_file->updateImagePaths(*m_index, m_job.auto_scan_args.prefix, added)) save();
+    }
+
+    void reparse() {
+        std::error_code ec;
+        RKErrorLocation location;
+        auto            auto_scan_args = m_job.auto_scan_args;
+        if (auto_scan_args.enabled) {
+            m_index = RKImageIndex::scan(m_directory, ec);
+            if (!m_index) {
+                spdlog::error("Unable to scan {}: {}", m_directory.string(), ec.message());
+                return;
+            }
+            auto_scan_args.index = m_index;
+        }
+        auto file = RKCfgFile::fromParameter(m_job.input, auto_scan_args, ec, location);
+        if (!file) {
+            spdlog::error("{}: {}", m_job.input, describe_error(ec, location));
+            return;
+        }
+        m_file = std::move(file);
+        save();
+    }
+
+    // The filters are applied to a copy, m_file keeps the item order updateImagePaths relies on.
+    void save() {
+        auto result = *m_file;
+        if (m_plans) {
+            for (const auto& plan : *m_plans) result.removeItem(plan);
+        }
+        std::error_code ec;
+        // Written to a temporary file renamed over the output, which keeps the previous one until then.
+        result.save(m_job.output, output_mode(m_job.output, m_job.compact_json), ec);
+        if (ec) {
+            spdlog::error("Unable to write {}: {}", m_job.output, ec.message());
+            return;
+        }
+        spdlog::info("Results have been saved to {}", m_job.output);
+    }
+
+    const WatchOptions&                 m_options;
+    const Job&                          m_job;
+    std::filesystem::path               m_directory;
+    std::string                         m_parameter_name;
+    std::string                         m_output_name;
+    std::string                         m_temp_name;
+    FilterPlans                         m_plans;
+    std::shared_ptr<const RKImageIndex> m_index;
+    std::optional<RKCfgFile>            m_file;
+    int                                 m_fd{-1};
+};
+
+} // namespace
+
+int run_watch(const WatchOptions& options) { return Watcher(options).run(); }
+
+} // namespace cli
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <chrono>
+
+#include "Job.h"
+
+namespace cli {
+
+struct WatchOptions {
+    // Conversion of a parameter file: job.input is watched and job.output regenerated, the partition filters and the
+    // auto scan options apply.
+    Job job;
+    // Quiet time after the last change before regenerating, so that a burst of build output triggers a single run.
+    std::chrono::milliseconds debounce{200};
+};
+
+// Converts the parameter file, then watches its directory (which the auto scan looks into) until SIGINT or SIGTERM.
+// The parameter file changing triggers a full reparse, images being added, removed or renamed only recompute the
+// image paths of the partitions they can match. Outputs are written to a temporary file renamed over the previous
+// one. Linux only (inotify). Returns the process exit code.
+int run_watch(const WatchOptions& options);
+
+} // namespace cli
@@ -1,202 +1,158 @@
 #include "RKCfg.h"
+#include "RKCfgView.h"
+#include "RKJsonReader.h"
+#include "RKParameter.h"
 
+#include "util/MappedFile.h"
+#include "util/Profile.h"
 #include "util/String.h"
+#include "util/Unicode.h"
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
-#include <fstream>
+#include <functional>
+#include <typeinfo>
 
 #include <spdlog/spdlog.h>
 
 namespace rockchip {
 
-std::optional<RKCfgFile> RKCfgFile::fromFile(const std::string& path, std::error_code& ec) {
-    if (!std::filesystem::exists(path)) {
-        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::FileNotExists);
-        return {};
-    }
-    auto file_size = std::filesystem::file_size(path);
-    if (file_size < sizeof(RKCfgHeader)) {
-        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::IsNotRKCfgFile);
-        return {};
-    }
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnableToOpenFile);
-        return {};
-    }
-    RKCfgFile result;
-    file.read(reinterpret_cast<char*>(&result.m_header), sizeof(m_header));
-    if (strcmp(result.m_header.magic, "CFG") != 0) {
-        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::IsNotRKCfgFile);
-        return {};
-    }
-    if (result.m_header.item_size != sizeof(RKCfgItem)) {
-        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnsupportedItemSize);
-        return {};
+std::string RKCfgFile::resolveImagePath(const std::string& cfg_path, const RKCfgItem& item) {
+    auto image_path = util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+#ifndef _WIN32
+    std::replace(image_path.begin(), image_path.end(), '\\', '/');
+#endif
+    std::filesystem::path path(image_path);
+    if (path.is_relative()) {
+        auto base_dir = std::filesystem::path(cfg_path).parent_path();
+        path          = (base_dir.empty() ? std::filesystem::path("./") : base_dir) / path;
     }
-    auto legal_size = sizeof(m_header) + result.m_header.item_size * result.m_header.length;
-    if (file_size != legal_size) {
-        spdlog::debug("file_size = {:#x} (legal size = {:#x})", file_size, legal_size);
-        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::AbnormalFileSize);
-        return {};
-    }
-    result.m_items.reserve(result.m_header.length + 1);
-    for (size_t idx = 0; idx < result.m_header.length; idx++) {
-        file.seekg(result.m_header.begin + idx * result.m_header.item_size, std::ios::beg);
-        RKCfgItem item;
-        file.read(reinterpret_cast<char*>(&item), sizeof(item));
-        result.addItem(item, false);
-    }
-    return result;
+    return path.lexically_normal().string();
+}
+
+std::optional<RKCfgFile> RKCfgFile::fromFile(const std::string& path, std::error_code& ec) {
+    auto view = RKCfgView::open(path, ec);
+    if (!view) return {};
+    return view->toFile();
 }
 
 std::optional<RKCfgFile>
 RKCfgFile::fromParameter(const std::string& path, AutoScanArgument auto_scan_args, std::error_code& ec) {
+    RKErrorLocation location;
+    return fromParameter(path, std::move(auto_scan_args), ec, location);
+}
+
+std::optional<RKCfgFile> RKCfgFile::fromParameter(
+    const std::string& path,
+    AutoScanArgument   auto_scan_args,
+    std::error_code&   ec,
+    RKErrorLocation&   location
+) {
+    util::profile::ScopedTimer timer(util::profile::Phase::FromParameter);
+    util::profile::count(util::profile::Counter::FsCalls);
     if (!std::filesystem::exists(path)) {
         ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::FileNotExists);
         return {};
     }
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    std::error_code map_ec;
+    auto            mapping = util::MappedFile::open(path, map_ec);
+    if (!mapping) {
+        spdlog::debug("Unable to map {}: {}", path, map_ec.message());
         ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::UnableToOpenFile);
         return {};
     }
-    // "mtdparts=rk29xxnand:0x00002000@0x00004000(uboot),...,0x00400000@0x00E3a000(userdata),-@0x0123a000(userdisk:grow)"
-    std::string mtdparts;
-    while (std::getline(file, mtdparts)) {
-        if (mtdparts.starts_with("CMDLINE: ")) util::string::remove_prefix(mtdparts, "CMDLINE: ");
-        if (mtdparts.starts_with("mtdparts=")) break;
-    }
-    spdlog::debug("mtdparts: {}", mtdparts);
-    if (mtdparts.empty()) {
-        ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::MtdPartsNotFound);
-        return {};
-    }
-    auto first_quotation_mark_pos = mtdparts.find(':');
-    if (first_quotation_mark_pos == std::string::npos) {
-        spdlog::debug("Illegal mark position. (0)");
-        ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::IllegalMtdPartFormat);
-        return {};
-    }
-    auto mtdparts_stream = std::stringstream(mtdparts.substr(first_quotation_mark_pos + 1));
-    // "0x00002000@0x00004000(uboot)"
-    // "-@0x0123a000(userdisk:grow)"
-    std::string mtdpart;
-    struct Partition {
-        std::string name;
-        uint32_t    address;
-        // size is unused in rkcfg format.
-        [[maybe_unused]] std::optional<uint32_t> size;
-    };
-    std::vector<Partition> parts;
-    while (std::getline(mtdparts_stream, mtdpart, ',')) {
-        spdlog::debug("mtdpart: {}", mtdpart);
-        auto at_mark_pos             = mtdpart.find('@');
-        auto left_quotation_mark_pos = mtdpart.find('(');
-        if (at_mark_pos == std::string::npos || left_quotation_mark_pos == std::string::npos
-            || at_mark_pos > left_quotation_mark_pos) {
-            spdlog::debug("Illegal mark position. (1)");
-            ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::IllegalMtdPartFormat);
-            return {};
-        }
-        auto right_quotation_mark_pos = mtdpart.find(')', left_quotation_mark_pos);
-        if (right_quotation_mark_pos == std::string::npos) {
-            spdlog::debug("Illegal mark position. (2)");
-            ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::IllegalMtdPartFormat);
-            return {};
-        }
-
-        auto name = mtdpart.substr(left_quotation_mark_pos + 1, mtdpart.size() - left_quotation_mark_pos - 2);
-
-        auto size_str    = mtdpart.substr(0, at_mark_pos);
-        auto address_str = mtdpart.substr(at_mark_pos + 1, 10);
-
-        std::optional<uint32_t> size;
-        std::optional<uint32_t> address = util::string::to_uint32(address_str);
-
-        if (!address) {
-            spdlog::debug("Invalid address. (3)");
-            ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::IllegalMtdPartFormat);
+    // Part names are views into the mapping, which outlives the loop below.
+    std::vector<RKMtdPart> parts;
+    {
+        util::profile::ScopedTimer phase(util::profile::Phase::ParameterParse);
+        if (!RKParameterParser::parse(
+                {reinterpret_cast<const char*>(mapping->data()), mapping->size()},
+                nullptr,
+                parts,
+                ec,
+                location
+            ))
             return {};
-        }
-
-        if (size_str != "-") { // grow
-            size = util::string::to_uint32(size_str);
-            if (!size) {
-                spdlog::debug("Invalid size. (4)");
-                ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::IllegalMtdPartFormat);
+    }
+    auto base_dir = std::filesystem::path(path).parent_path();
+    if (base_dir.empty()) base_dir = "./";
+    spdlog::debug("base_dir: {}", base_dir.string());
+    // list the images once, every partition is then looked up in the snapshot.
+    auto index = auto_scan_args.index;
+    if (auto_scan_args.enabled) {
+        util::profile::ScopedTimer phase(util::profile::Phase::AutoScan);
+        std::error_code            index_ec;
+        if (index) util::profile::count(util::profile::Counter::FsCalls);
+        if (!index || !std::filesystem::equivalent(index->getDirectory(), base_dir, index_ec)) {
+            index = RKImageIndex::scan(base_dir, index_ec);
+            if (!index) {
+                spdlog::debug("Unable to scan {}: {}", base_dir.string(), index_ec.message());
+                ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::UnableToScanDirectory);
                 return {};
             }
-        } else {
-            util::string::remove_suffix(name, ":grow"); // extend to maximum position.
         }
+    }
+    util::profile::ScopedTimer phase(util::profile::Phase::ItemBuild);
+    return fromMtdParts(
+        parts,
+        [&](size_t idx) -> std::string {
+            if (!auto_scan_args.enabled) return {};
+            if (idx == loader_index)
+                return index->contains("MiniLoaderAll.bin") ? auto_scan_args.prefix + "MiniLoaderAll.bin" : "";
+            if (idx == parameter_index) return auto_scan_args.prefix + path;
+            const auto& part                 = parts[idx - mtd_parts_index];
+            auto        potential_image_path = index->findImage(part.name);
+            if (!potential_image_path) return {};
+            spdlog::info("Selected {} as the image file of {}.", *potential_image_path, part.name);
+            return auto_scan_args.prefix + std::string(*potential_image_path);
+        },
+        ec
+    );
+}
 
-        parts.emplace_back(name, *address, size);
+std::optional<RKCfgFile>
+RKCfgFile::fromParameterBuffer(std::string_view text, std::error_code& ec, RKErrorLocation& location) {
+    util::profile::ScopedTimer timer(util::profile::Phase::FromParameter);
+    std::vector<RKMtdPart>     parts;
+    {
+        util::profile::ScopedTimer phase(util::profile::Phase::ParameterParse);
+        if (!RKParameterParser::parse(text, nullptr, parts, ec, location)) return {};
     }
+    util::profile::ScopedTimer phase(util::profile::Phase::ItemBuild);
+    return fromMtdParts(parts, [](size_t) { return std::string(); }, ec);
+}
+
+std::optional<RKCfgFile> RKCfgFile::fromMtdParts(
+    std::span<const RKMtdPart>                 parts,
+    const std::function<std::string(size_t)>& image_path_of,
+    std::error_code&                           ec
+) {
     RKCfgFile result;
-    auto      base_dir = std::filesystem::path(path).parent_path();
-    if (base_dir.empty()) base_dir = "./";
     // add rkcfg default parts
     RKCfgItem loader;
     util::string::to_char16("Loader", loader.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
-    if (auto_scan_args.enabled && std::filesystem::exists(base_dir / "MiniLoaderAll.bin"))
-        util::string::to_char16(
-            auto_scan_args.prefix + "MiniLoaderAll.bin",
-            loader.image_path,
-            RKCfgItem::RK_V286_MAX_PATH_SIZE
-        );
-    spdlog::debug("base_dir: {}", base_dir.string());
+    if (auto image_path = image_path_of(loader_index); !image_path.empty())
+        util::string::to_char16(image_path, loader.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
     loader.address     = 0x00000000;
     loader.is_selected = true;
     result.addItem(loader);
     RKCfgItem parameter;
     util::string::to_char16("parameter", parameter.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
-    if (auto_scan_args.enabled)
-        util::string::to_char16(auto_scan_args.prefix + path, parameter.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+    if (auto image_path = image_path_of(parameter_index); !image_path.empty())
+        util::string::to_char16(image_path, parameter.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
     parameter.address     = 0x00000000;
     parameter.is_selected = true;
     result.addItem(parameter);
-    for (auto& part : parts) {
+    for (size_t idx = 0; idx < parts.size(); idx++) {
         RKCfgItem item;
-        if (!util::string::to_char16(part.name, item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE)) {
+        if (!util::string::to_char16(parts[idx].name, item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE)) {
             ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::IllegalMtdPartFormat);
             return {};
         }
-        if (auto_scan_args.enabled) {
-
-            auto potential_image_name = part.name;
-            auto potential_image_path = std::string();
-
-            auto scan = [&]() {
-                for (auto& entry : std::filesystem::directory_iterator(base_dir)) {
-                    auto this_path = entry.path();
-                    if (entry.is_regular_file() && this_path.filename().string().starts_with(potential_image_name)) {
-                        // msvc on windows can only implicitly convert std::filesystem::path to std::wstring.
-                        potential_image_path = this_path.filename().string();
-                        break;
-                    }
-                }
-            };
-            scan();
-            if (potential_image_path.empty()) {
-                util::string::remove_suffix(potential_image_name, "_a");
-                util::string::remove_suffix(potential_image_name, "_b");
-                scan();
-            }
-            if (!potential_image_path.empty()) {
-                spdlog::info(
-                    "Selected {} as the image file of {}.",
-                    potential_image_path,
-                    util::string::from_char16(item.name)
-                );
-                util::string::to_char16(
-                    auto_scan_args.prefix + potential_image_path,
-                    item.image_path,
-                    RKCfgItem::RK_V286_MAX_PATH_SIZE
-                );
-            }
-        }
-        item.address     = part.address;
+        if (auto image_path = image_path_of(mtd_parts_index + idx); !image_path.empty())
+            util::string::to_char16(image_path, item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+        item.address     = parts[idx].address;
         item.is_selected = true;
         result.addItem(item);
     }
@@ -204,78 +160,164 @@ RKCfgFile::fromParameter(const std::string& path, AutoScanArgument auto_scan_arg
 }
 
 std::optional<RKCfgFile> RKCfgFile::fromJson(const std::string& path, std::error_code& ec) {
-    using json = nlohmann::json;
+    RKErrorLocation location;
+    return fromJson(path, ec, location);
+}
 
+std::optional<RKCfgFile>
+RKCfgFile::fromJson(const std::string& path, std::error_code& ec, RKErrorLocation& location) {
+    util::profile::ScopedTimer timer(util::profile::Phase::FromJson);
+    util::profile::count(util::profile::Counter::FsCalls);
     if (!std::filesystem::exists(path)) {
         ec = make_rkcfg_load_error(RKCfgLoadErrorCode::FileNotExists);
         return {};
     }
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    std::error_code map_ec;
+    auto            mapping = util::MappedFile::open(path, map_ec);
+    if (!mapping) {
+        spdlog::debug("Unable to map {}: {}", path, map_ec.message());
         ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnableToOpenFile);
         return {};
     }
-    try {
-        const auto data = json::parse(file);
-        RKCfgFile  file;
-        if (file.m_header.begin != data["header"]["size"]) {
-            ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnsupportedHeaderSize);
-            return {};
+    return fromJsonBuffer({reinterpret_cast<const char*>(mapping->data()), mapping->size()}, ec, location);
+}
+
+std::optional<RKCfgFile>
+RKCfgFile::fromJsonBuffer(std::string_view json, std::error_code& ec, RKErrorLocation& location) {
+    RKCfgFile result;
+    if (!RKJsonReader::read(json, result.m_items, ec, location)) return {};
+    result.m_header.length = static_cast<uint8_t>(result.m_items.size());
+    return result;
+}
+
+void RKCfgFile::save(const std::string& path, SaveMode mode, std::error_code& ec) const {
+    RKCfgView(*this).save(path, mode, ec);
+}
+
+nlohmann::json RKCfgFile::toJson() const { return RKCfgView(*this).toJson(); }
+
+RKCfgFile::ItemFilterCollection RKCfgFile::parseItemFilters(const std::string& expression, std::error_code& ec) {
+    // "address=0x10000000,name=test,"
+    std::unordered_map<std::string, std::string> kv_result;
+    spdlog::debug("should_remove_part: {}", expression);
+    bool        is_in_quotation_mark{};
+    std::string buffer;
+    std::string left;
+    std::string right;
+    for (auto chr : expression) {
+        if (chr == '\'') {
+            is_in_quotation_mark = !is_in_quotation_mark;
+            continue;
         }
-        if (file.m_header.item_size != data["header"]["item_size"]) {
-            ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnsupportedItemSize);
-            return {};
+        if (is_in_quotation_mark) {
+            buffer += chr;
+            continue;
         }
-        for (auto& item_data : data["items"]) {
-            RKCfgItem item;
-            util::string::to_char16(item_data["name"], item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
-            util::string::to_char16(item_data["image_path"], item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
-            item.address     = item_data["address"];
-            item.is_selected = item_data["is_selected"];
-            file.addItem(item);
+        switch (chr) {
+        case ':':
+            left = buffer;
+            buffer.clear();
+            break;
+        case ',':
+            right = buffer;
+            buffer.clear();
+            kv_result[left] = right;
+            break;
+        default:
+            buffer += chr;
+            break;
+        }
+    }
+    right = buffer;
+    buffer.clear();
+    kv_result[left] = right;
+    ItemFilterCollection filters;
+    for (const auto& [key, value] : kv_result) {
+        if (key == "address") {
+            auto address = util::string::to_uint32(value);
+            if (!address) {
+                spdlog::debug("{} is not a number.", value);
+                ec = make_rkcfg_item_filter_error(RKItemFilterErrorCode::NotANumber);
+                return {};
+            }
+            filters.emplace_back(new AddressItemFilter(*address));
+        } else if (key == "name") {
+            filters.emplace_back(new NameItemFilter(value));
+        } else if (key == "image_path") {
+            filters.emplace_back(new ImagePathItemFilter(value));
+        } else if (key == "index") {
+            auto index = util::string::to_uint32(value);
+            if (!index) {
+                spdlog::debug("{} is not a number.", value);
+                ec = make_rkcfg_item_filter_error(RKItemFilterErrorCode::NotANumber);
+                return {};
+            }
+            filters.emplace_back(new IndexItemFilter(*index));
+        } else {
+            spdlog::debug("unknown filter({}).", key);
+            ec = make_rkcfg_item_filter_error(RKItemFilterErrorCode::UnknownFilter);
+            return {};
         }
-        return file;
-    } catch (const json::exception& e) {
-        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::JsonParseError);
-        return {};
     }
+    return filters;
 }
 
-void RKCfgFile::save(const std::string& path, SaveMode mode, std::error_code& ec) const {
-    if (mode == JsonMode) {
-        std::ofstream file(path);
-        if (!file.is_open()) {
-            ec = make_rkcfg_save_error(RKCfgSaveErrorCode::UnableToOpenFile);
-            return;
+namespace {
+
+// Encodes a literal like it is stored in a field of max_len code units. Returns nothing if it cannot fit.
+std::optional<std::u16string> encode_field(const std::string& value, size_t max_len) {
+    std::u16string result(max_len, u'\0');
+    auto length = util::unicode::utf8_to_utf16(value.data(), value.size(), result.data(), max_len);
+    if (length == util::unicode::npos) return {};
+    // A shorter value has to be followed by NUL, one filling the whole field has none.
+    result.resize(std::min(length + 1, max_len));
+    return result;
+}
+
+bool matches_field(const char16_t* field, const std::vector<std::u16string>& literals) {
+    for (auto& literal : literals)
+        if (std::memcmp(field, literal.data(), literal.size() * sizeof(char16_t)) == 0) return true;
+    return false;
+}
+
+} // namespace
+
+RKCfgFile::ItemFilterPlan::ItemFilterPlan(ItemFilterCollection&& filters) : m_owned(std::move(filters)) {
+    compile(m_owned);
+}
+
+RKCfgFile::ItemFilterPlan::ItemFilterPlan(const ItemFilterCollection& filters) { compile(filters); }
+
+void RKCfgFile::ItemFilterPlan::compile(const ItemFilterCollection& filters) {
+    for (auto& filter : filters) {
+        // Subclasses of the built-in filters may override filt, only the exact classes are compiled.
+        const auto& type = typeid(*filter);
+        if (type == typeid(AddressItemFilter)) {
+            m_addresses.push_back(static_cast<const AddressItemFilter&>(*filter).getValue());
+        } else if (type == typeid(IndexItemFilter)) {
+            m_indexes.push_back(static_cast<const IndexItemFilter&>(*filter).getValue());
+        } else if (type == typeid(NameItemFilter)) {
+            auto& value = static_cast<const NameItemFilter&>(*filter).getValue();
+            // A name longer than the field can never match.
+            if (auto name = encode_field(value, RKCfgItem::RK_V286_MAX_NAME_SIZE)) m_names.push_back(*name);
+        } else if (type == typeid(ImagePathItemFilter)) {
+            auto& value = static_cast<const ImagePathItemFilter&>(*filter).getValue();
+            if (auto path = encode_field(value, RKCfgItem::RK_V286_MAX_PATH_SIZE)) m_image_paths.push_back(*path);
+        } else {
+            m_fallbacks.push_back(filter.get());
         }
-        file << toJson().dump(4);
-        file.close();
-        return;
-    }
-    std::ofstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        ec = make_rkcfg_save_error(RKCfgSaveErrorCode::UnableToOpenFile);
-        return;
-    }
-    file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
-    for (auto& item : m_items) {
-        file.write(reinterpret_cast<const char*>(&item), sizeof(item));
     }
 }
 
-nlohmann::json RKCfgFile::toJson() const {
-    nlohmann::json result;
-    result["header"]["size"]      = m_header.begin;
-    result["header"]["item_size"] = m_header.item_size;
-    for (auto& item : m_items) {
-        result["items"].emplace_back(nlohmann::json{
-            {"is_selected", (bool)item.is_selected                    },
-            {"address",     item.address                              },
-            {"name",        util::string::from_char16(item.name)      },
-            {"image_path",  util::string::from_char16(item.image_path)}
-        });
-    }
-    return result;
+bool RKCfgFile::ItemFilterPlan::matches(size_t idx, const RKCfgItem& item) const {
+    for (auto address : m_addresses)
+        if (item.address == address) return true;
+    for (auto index : m_indexes)
+        if (idx == index) return true;
+    if (matches_field(item.name, m_names) || matches_field(item.image_path, m_image_paths)) return true;
+    for (auto filter : m_fallbacks)
+        if (filter->filt(idx, item)) return true;
+    return false;
 }
 
 void RKCfgFile::addItem(const RKCfgItem& item, bool auto_increase_length) {
@@ -293,44 +335,62 @@ void RKCfgFile::removeItem(size_t index) {
     m_header.length--;
 }
 
-void RKCfgFile::removeItem(const ItemFilterCollection& filters) {
-    for (size_t idx = 0; idx < m_items.size();) {
-        bool is_deleted{};
-        for (auto& filter : filters) {
-            if (filter->filt(idx, m_items.at(idx))) {
-                m_items.erase(m_items.begin() + idx);
-                m_header.length--;
-                is_deleted = true;
-                break;
-            }
-        }
-        if (is_deleted) continue;
-        else idx++;
-    }
+void RKCfgFile::removeItem(const ItemFilterCollection& filters) { removeItem(ItemFilterPlan(filters)); }
+
+void RKCfgFile::removeItem(const ItemFilterPlan& plan) {
+    util::profile::ScopedTimer timer(util::profile::Phase::RemoveItem);
+    // remove_if only moves items towards the front, so an item is still at its original position when tested.
+    auto begin = m_items.begin();
+    auto end   = std::remove_if(begin, m_items.end(), [&](const RKCfgItem& item) {
+        return plan.matches(&item - m_items.data(), item);
+    });
+    m_header.length -= static_cast<uint8_t>(m_items.end() - end);
+    m_items.erase(end, m_items.end());
 }
 
 void RKCfgFile::updateItem(size_t index, const RKCfgItem& item) { m_items.at(index) = item; }
 
+size_t RKCfgFile::updateImagePaths(
+    const RKImageIndex&          index,
+    const std::string&           prefix,
+    std::span<const std::string> changed_files
+) {
+    auto changed = [&](std::string_view name) {
+        // findImage only looks at the files starting with the name, or with the name without its A/B suffix.
+        auto stripped = name;
+        if (stripped.ends_with("_a")) stripped.remove_suffix(2);
+        if (stripped.ends_with("_b")) stripped.remove_suffix(2);
+        return std::any_of(changed_files.begin(), changed_files.end(), [&](const std::string& file) {
+            return file.starts_with(stripped);
+        });
+    };
+    size_t updated{};
+    for (size_t idx = 0; idx < m_items.size(); idx++) {
+        if (idx == parameter_index) continue;
+        auto&       item = m_items[idx];
+        auto        name = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+        std::string image_path;
+        if (idx == loader_index) {
+            if (!changed("MiniLoaderAll.bin")) continue;
+            if (index.contains("MiniLoaderAll.bin")) image_path = prefix + "MiniLoaderAll.bin";
+        } else {
+            if (!changed(name)) continue;
+            if (auto image = index.findImage(name)) image_path = prefix + std::string(*image);
+        }
+        char16_t buffer[RKCfgItem::RK_V286_MAX_PATH_SIZE]{};
+        if (!image_path.empty()) util::string::to_char16(image_path, buffer, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+        if (std::memcmp(buffer, item.image_path, sizeof(buffer)) == 0) continue;
+        std::memcpy(item.image_path, buffer, sizeof(buffer));
+        spdlog::info("Selected {} as the image file of {}.", image_path.empty() ? "nothing" : image_path, name);
+        updated++;
+    }
+    return updated;
+}
+
 RKCfgHeader const& RKCfgFile::getHeader() const { return m_header; }
 
 RKCfgItemContainer const& RKCfgFile::getItems() const { return m_items; }
 
-void RKCfgFile::printDebugString() const {
-    spdlog::info("{:<12} {:#x}", "Header size:", m_header.begin);
-    spdlog::info("{:<12} {:#x}", "Item size:", m_header.item_size);
-    spdlog::info("Partitions({}): ", m_header.length);
-    spdlog::info("    {:<10} {:10} {}", "Address", "Name", "Path");
-    for (auto& item : m_items) {
-        auto name       = util::string::from_char16(item.name);
-        auto image_path = util::string::from_char16(item.image_path);
-        spdlog::info(
-            "[{}] {:#010x} {:<10} {}",
-            item.is_selected ? "x" : " ",
-            item.address,
-            name.empty() ? "(empty)" : name,
-            image_path.empty() ? "(empty)" : image_path
-        );
-    }
-}
+void RKCfgFile::printDebugString() const { RKCfgView(*this).printDebugString(); }
 
 } // namespace rockchip
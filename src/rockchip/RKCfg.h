@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+#include <span>
 #include <vector>
 
 #include <nlohmann/json.hpp>
@@ -7,16 +9,17 @@
 #include "util/String.h"
 
 #include "RKError.h"
+#include "RKImageIndex.h"
+#include "RKParameter.h"
 #include "RKPreDefines.h"
 
 namespace rockchip {
 
 using RKCfgItemContainer = std::vector<RKCfgItem>;
-using RKParameter        = std::unordered_map<std::string, std::string>;
 
 class RKCfgFile {
 public:
-    enum SaveMode { DefaultMode, JsonMode };
+    enum SaveMode { DefaultMode, JsonMode, JsonCompactMode };
 
     class ItemFilter {
     public:
@@ -37,6 +40,8 @@ public:
 
         bool filt(size_t idx, const RKCfgItem& item) const override { return item.address == value; }
 
+        uint32_t getValue() const { return value; }
+
     private:
         uint32_t value;
     };
@@ -48,9 +53,12 @@ public:
         Type getType() const override { return Name; }
 
         bool filt(size_t idx, const RKCfgItem& item) const override {
-            return util::string::from_char16(item.name) == value;
+            char buffer[RKCfgItem::RK_V286_MAX_NAME_SIZE * 3];
+            return util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE, buffer) == value;
         }
 
+        std::string const& getValue() const { return value; }
+
     private:
         std::string value;
     };
@@ -62,9 +70,12 @@ public:
         Type getType() const override { return ImagePath; }
 
         bool filt(size_t idx, const RKCfgItem& item) const override {
-            return util::string::from_char16(item.image_path) == value;
+            char buffer[RKCfgItem::RK_V286_MAX_PATH_SIZE * 3];
+            return util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE, buffer) == value;
         }
 
+        std::string const& getValue() const { return value; }
+
     private:
         std::string value;
     };
@@ -77,6 +88,8 @@ public:
 
         bool filt(size_t idx, const RKCfgItem& item) const override { return idx == value; }
 
+        size_t getValue() const { return value; }
+
     private:
         size_t value;
     };
@@ -84,11 +97,70 @@ public:
     struct AutoScanArgument {
         bool        enabled;
         std::string prefix;
-        AutoScanArgument() : enabled{}, prefix{} {}
+        // Optional snapshot of the parameter's directory, taken by fromParameter if missing (or of another
+        // directory). Pass the same index to convert several parameter files sharing a directory.
+        std::shared_ptr<const RKImageIndex> index;
+        AutoScanArgument() : enabled{}, prefix{}, index{} {}
     };
 
     using ItemFilterCollection = std::vector<std::unique_ptr<const ItemFilter>>;
 
+    // A filter collection compiled once: name and image_path literals are encoded to UTF-16 up front and compared
+    // with memcmp, addresses and indexes are plain integer loops. Filters of other (user defined) classes are still
+    // asked through filt. An item matches if any filter matches. Can be shared between threads and files.
+    class ItemFilterPlan {
+    public:
+        // The plan owns the filters.
+        explicit ItemFilterPlan(ItemFilterCollection&& filters);
+        // The filters are borrowed, they must outlive the plan.
+        explicit ItemFilterPlan(const ItemFilterCollection& filters);
+
+        bool matches(size_t idx, const RKCfgItem& item) const;
+
+    private:
+        void compile(const ItemFilterCollection& filters);
+
+        ItemFilterCollection           m_owned;
+        std::vector<uint32_t>          m_addresses;
+        std::vector<size_t>            m_indexes;
+        // Code units to compare, including the terminating NUL unless the literal fills the whole field.
+        std::vector<std::u16string>    m_names;
+        std::vector<std::u16string>    m_image_paths;
+        std::vector<const ItemFilter*> m_fallbacks;
+    };
+
+    // An edit applied to every item matched by the selector.
+    struct ItemPatch {
+        enum Action { SetSelected, SetAddress, SetImagePath, Remove };
+
+        ItemFilterPlan selector;
+        Action         action;
+        uint32_t       value{}; // is_selected or address
+        char16_t       image_path[RKCfgItem::RK_V286_MAX_PATH_SIZE]{};
+    };
+
+    using ItemPatchCollection = std::vector<ItemPatch>;
+
+    // Parses a '--remove-partition' expression, e.g. "name:userdisk" or "address:0x0123a000,name:'a,b'".
+    // TODO: Replace with: std::expected
+    static ItemFilterCollection parseItemFilters(const std::string& expression, std::error_code& ec);
+
+    // Parses a '--patch' expression: "<filters>=<action>", the action being one of "selected:(0|1)",
+    // "address:<number>", "image_path:<path>" or "remove", e.g. "name:boot=image_path:'Image/boot.img'".
+    // TODO: Replace with: std::expected
+    static std::optional<ItemPatch> parseItemPatch(const std::string& expression, std::error_code& ec);
+
+    // Applies the patches, in order, to the cfg file at path without rewriting it: every edited item is a single
+    // positioned write of the bytes that changed, removals move the following items forward, update the header and
+    // truncate the file. With crash_safe, removals write a temporary file that is renamed over path instead, so the
+    // file is never left half-written. Index filters refer to the positions before the patch.
+    static void
+    patch(const std::string& path, const ItemPatchCollection& patches, bool crash_safe, std::error_code& ec);
+
+    // Path of the image of an item, relative image paths are relative to the directory of the cfg file. RKDevTool
+    // writes Windows paths, backslashes are turned into slashes on other systems.
+    static std::string resolveImagePath(const std::string& cfg_path, const RKCfgItem& item);
+
     // TODO: Replace with: std::expected
     static std::optional<RKCfgFile> fromFile(const std::string& path, std::error_code& ec);
 
@@ -96,9 +168,49 @@ public:
     static std::optional<RKCfgFile>
     fromParameter(const std::string& path, AutoScanArgument auto_scan_args, std::error_code& ec);
 
+    // Same as above, location points at the malformed mtdparts entry if parsing failed.
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgFile> fromParameter(
+        const std::string& path,
+        AutoScanArgument   auto_scan_args,
+        std::error_code&   ec,
+        RKErrorLocation&   location
+    );
+
+    // Converts parameter.txt contents, no image is looked up (image paths are left empty).
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgFile>
+    fromParameterBuffer(std::string_view text, std::error_code& ec, RKErrorLocation& location);
+
+    // Items of the parameter file embedded in an update image (RKAF or RKFW package), read in place from its
+    // mapping. Items with an entry in the package get extract_dir joined with the file name of the entry as their
+    // image path (the path stored in the package if extract_dir is empty). Nothing is extracted here, see
+    // RKUpdateImage::extract.
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgFile>
+    fromUpdateImage(const std::string& path, const std::string& extract_dir, std::error_code& ec);
+
+    // Same as above, location points at the malformed mtdparts entry of the embedded parameter file.
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgFile> fromUpdateImage(
+        const std::string& path,
+        const std::string& extract_dir,
+        std::error_code&   ec,
+        RKErrorLocation&   location
+    );
+
     // TODO: Replace with: std::expected
     static std::optional<RKCfgFile> fromJson(const std::string& path, std::error_code& ec);
 
+    // Same as above, location tells where parsing stopped if it failed.
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgFile>
+    fromJson(const std::string& path, std::error_code& ec, RKErrorLocation& location);
+
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgFile>
+    fromJsonBuffer(std::string_view json, std::error_code& ec, RKErrorLocation& location);
+
     void save(const std::string& path, SaveMode mode, std::error_code& ec) const;
 
     nlohmann::json toJson() const;
@@ -110,6 +222,17 @@ public:
 
     void removeItem(size_t index);
     void removeItem(const ItemFilterCollection& filters);
+    // Removes every matching item in one stable pass, indexes refer to the positions before the removal.
+    void removeItem(const ItemFilterPlan& plan);
+
+    // Same as patch, on the loaded items.
+    void applyPatches(const ItemPatchCollection& patches);
+
+    // For a file built by fromParameter with auto scan enabled and not reordered since: recomputes, as fromParameter
+    // would, the image paths of the items that could match one of changed_files (files added to or removed from the
+    // directory of index, which already reflects them). Returns the number of image paths that changed.
+    size_t
+    updateImagePaths(const RKImageIndex& index, const std::string& prefix, std::span<const std::string> changed_files);
 
     void updateItem(size_t index, const RKCfgItem& item);
 
@@ -119,8 +242,23 @@ public:
     void printDebugString() const;
 
 private:
+    friend class RKCfgView;
+    friend class RKCfgCompactFile;
+
     RKCfgFile() = default;
 
+    // Indexes of the items built by fromMtdParts: Loader, parameter, then one item per mtdparts entry.
+    static constexpr size_t loader_index    = 0;
+    static constexpr size_t parameter_index = 1;
+    static constexpr size_t mtd_parts_index = 2;
+
+    // image_path_of gives the image path of each item by index (empty for none).
+    static std::optional<RKCfgFile> fromMtdParts(
+        std::span<const RKMtdPart>                 parts,
+        const std::function<std::string(size_t)>& image_path_of,
+        std::error_code&                           ec
+    );
+
     RKCfgHeader        m_header{};
     RKCfgItemContainer m_items;
 };
@@ -0,0 +1,138 @@
+#include "RKCfgCompact.h"
+
+#include "util/String.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace rockchip {
+
+namespace {
+
+bool same_bytes(const RKCfgItem& lhs, const RKCfgItem& rhs) { return memcmp(&lhs, &rhs, sizeof(RKCfgItem)) == 0; }
+
+} // namespace
+
+RKStringArena::RKStringArena() { intern({}); }
+
+RKStringArena::~RKStringArena() {
+    for (auto& page : m_pages) delete[] page.load(std::memory_order_relaxed);
+}
+
+uint32_t RKStringArena::intern(std::string_view text) {
+    std::lock_guard lock(m_mutex);
+    if (auto it = m_ids.find(text); it != m_ids.end()) return it->second;
+
+    auto id = m_size.load(std::memory_order_relaxed);
+    if (id >= page_count * page_size) throw std::length_error("too many strings in arena");
+    if (m_blocks.empty() || m_block_used + text.size() > block_size) {
+        m_blocks.emplace_back(std::make_unique<char[]>(std::max(block_size, text.size())));
+        m_block_used  = 0;
+        m_bytes      += std::max(block_size, text.size());
+    }
+    auto* data = m_blocks.back().get() + m_block_used;
+    std::copy(text.begin(), text.end(), data);
+    m_block_used += text.size();
+
+    auto& page = m_pages[id >> page_bits];
+    if (!page.load(std::memory_order_relaxed)) {
+        page.store(new std::string_view[page_size], std::memory_order_release);
+        m_bytes += page_size * sizeof(std::string_view);
+    }
+    std::string_view stored(data, text.size());
+    page.load(std::memory_order_relaxed)[id & (page_size - 1)] = stored;
+    m_ids.emplace(stored, id);
+    m_size.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+std::optional<uint32_t> RKStringArena::find(std::string_view text) const {
+    std::lock_guard lock(m_mutex);
+    auto            it = m_ids.find(text);
+    if (it == m_ids.end()) return {};
+    return it->second;
+}
+
+std::string_view RKStringArena::get(uint32_t id) const {
+    return m_pages[id >> page_bits].load(std::memory_order_acquire)[id & (page_size - 1)];
+}
+
+size_t RKStringArena::size() const { return m_size.load(std::memory_order_acquire); }
+
+size_t RKStringArena::memoryUsage() const {
+    std::lock_guard lock(m_mutex);
+    // Buckets and nodes of the map, roughly.
+    auto map_bytes = m_ids.bucket_count() * sizeof(void*) + m_ids.size() * (sizeof(std::string_view) + 24);
+    return sizeof(*this) + m_bytes + map_bytes;
+}
+
+RKCfgCompactFile RKCfgCompactFile::fromView(const RKCfgView& view, std::shared_ptr<RKStringArena> arena) {
+    RKCfgCompactFile result;
+    auto             items = view.getItems();
+    result.m_header        = view.getHeader();
+    result.m_arena         = std::move(arena);
+    result.m_names.reserve(items.size());
+    result.m_image_paths.reserve(items.size());
+    result.m_addresses.reserve(items.size());
+    result.m_selected.reserve(items.size());
+
+    char name_buffer[RKCfgItem::RK_V286_MAX_NAME_SIZE * 3];
+    char image_path_buffer[RKCfgItem::RK_V286_MAX_PATH_SIZE * 3];
+    for (size_t idx = 0; idx < items.size(); idx++) {
+        const auto& item = items[idx];
+        auto        name = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE, name_buffer);
+        auto        image_path =
+            util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE, image_path_buffer);
+        result.m_names.push_back(result.m_arena->intern(name));
+        result.m_image_paths.push_back(result.m_arena->intern(image_path));
+        result.m_addresses.push_back(item.address);
+        result.m_selected.push_back(item.is_selected);
+        // Most items rebuild as they were, the others are kept whole.
+        if (!same_bytes(result.getItem(idx), item)) result.m_verbatim.emplace_back(static_cast<uint32_t>(idx), item);
+    }
+    result.m_names.shrink_to_fit();
+    result.m_image_paths.shrink_to_fit();
+    result.m_addresses.shrink_to_fit();
+    result.m_selected.shrink_to_fit();
+    result.m_verbatim.shrink_to_fit();
+    return result;
+}
+
+RKCfgItem RKCfgCompactFile::getItem(size_t index) const {
+    auto verbatim = std::lower_bound(
+        m_verbatim.begin(),
+        m_verbatim.end(),
+        index,
+        [](const std::pair<uint32_t, RKCfgItem>& entry, size_t index) { return entry.first < index; }
+    );
+    if (verbatim != m_verbatim.end() && verbatim->first == index) return verbatim->second;
+
+    RKCfgItem item;
+    item.address     = m_addresses[index];
+    item.is_selected = m_selected[index];
+    // Fields filled up to the last code unit do not fit back with a terminator, such items are kept verbatim.
+    util::string::to_char16(getName(index), item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+    util::string::to_char16(getImagePath(index), item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+    return item;
+}
+
+RKCfgFile RKCfgCompactFile::toFile() const {
+    RKCfgFile result;
+    result.m_header = m_header;
+    result.m_items.reserve(size() + 1);
+    for (size_t idx = 0; idx < size(); idx++) result.m_items.push_back(getItem(idx));
+    return result;
+}
+
+void RKCfgCompactFile::save(const std::string& path, RKCfgFile::SaveMode mode, std::error_code& ec) const {
+    toFile().save(path, mode, ec);
+}
+
+size_t RKCfgCompactFile::memoryUsage() const {
+    return sizeof(*this) + m_names.capacity() * sizeof(uint32_t) + m_image_paths.capacity() * sizeof(uint32_t) +
+           m_addresses.capacity() * sizeof(uint32_t) + m_selected.capacity() * sizeof(uint8_t) +
+           m_verbatim.capacity() * sizeof(m_verbatim[0]);
+}
+
+} // namespace rockchip
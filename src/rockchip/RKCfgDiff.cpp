@@ -0,0 +1,83 @@
+#include "RKCfgDiff.h"
+
+#include <cstring>
+
+namespace rockchip {
+
+namespace {
+
+std::u16string_view field_of(const char16_t* str, size_t max_len) {
+    size_t len = 0;
+    while (len < max_len && str[len]) len++;
+    return {str, len};
+}
+
+std::u16string_view name_of(const RKCfgItem& item) { return field_of(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE); }
+
+std::u16string_view image_path_of(const RKCfgItem& item) {
+    return field_of(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+}
+
+// Whatever follows the terminator of a name is ignored, but it is usually zeroed too.
+bool same_name(const RKCfgItem& lhs, const RKCfgItem& rhs) {
+    return std::memcmp(lhs.name, rhs.name, sizeof(RKCfgItem::name)) == 0 || name_of(lhs) == name_of(rhs);
+}
+
+} // namespace
+
+RKCfgDiff::RKCfgDiff(std::span<const RKCfgItem> base) : m_base(base) {
+    m_names.reserve(base.size());
+    m_previous.reserve(base.size());
+    for (size_t idx = 0; idx < base.size(); idx++) {
+        auto& indexes = m_names[name_of(base[idx])];
+        m_previous.push_back(indexes.empty() ? Change::npos : indexes.back());
+        indexes.push_back(idx);
+    }
+}
+
+std::vector<RKCfgDiff::Change> RKCfgDiff::compare(std::span<const RKCfgItem> other) const {
+    std::vector<Change> changes;
+    if (other.size() == m_base.size() && std::memcmp(other.data(), m_base.data(), other.size_bytes()) == 0) {
+        return changes;
+    }
+
+    std::vector<bool> matched(m_base.size());
+    for (size_t idx = 0; idx < other.size(); idx++) {
+        const auto& item       = other[idx];
+        auto        base_index = Change::npos;
+        // Variants mostly keep the order of the baseline, the name lookup is only needed once it diverges. Items of a
+        // name are matched in order, so the item at the same position only qualifies once the previous base item of
+        // its name is matched.
+        auto in_order = [&] { return m_previous[idx] == Change::npos || matched[m_previous[idx]]; };
+        if (idx < m_base.size() && !matched[idx] && same_name(m_base[idx], item) && in_order()) {
+            base_index = idx;
+        } else if (auto it = m_names.find(name_of(item)); it != m_names.end()) {
+            for (auto candidate : it->second) {
+                if (matched[candidate]) continue;
+                base_index = candidate;
+                break;
+            }
+        }
+        if (base_index == Change::npos) {
+            changes.push_back({Change::Added, 0, Change::npos, idx});
+            continue;
+        }
+        matched[base_index] = true;
+
+        const auto& base = m_base[base_index];
+        if (std::memcmp(&base, &item, sizeof(RKCfgItem)) == 0) continue;
+        uint8_t fields{};
+        if (base.address != item.address) fields |= Address;
+        if (image_path_of(base) != image_path_of(item)) fields |= ImagePath;
+        if (bool(base.is_selected) != bool(item.is_selected)) fields |= Selected;
+        if (fields) changes.push_back({Change::Modified, fields, base_index, idx});
+    }
+    for (size_t idx = 0; idx < m_base.size(); idx++) {
+        if (!matched[idx]) changes.push_back({Change::Removed, 0, idx, Change::npos});
+    }
+    return changes;
+}
+
+std::span<const RKCfgItem> RKCfgDiff::getBase() const { return m_base; }
+
+} // namespace rockchip
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "RKPreDefines.h"
+
+namespace rockchip {
+
+// Field-level differences between a baseline cfg and its variants, items being matched by name (the n-th item of a
+// name with the n-th item of that name in the other file). The baseline is indexed once, compare() can then be called
+// for any number of variants from any thread. Identical files and items are recognized with a memcmp of the packed
+// records before any field is looked at.
+class RKCfgDiff {
+public:
+    enum Field : uint8_t {
+        Address   = 1 << 0,
+        ImagePath = 1 << 1,
+        Selected  = 1 << 2,
+    };
+
+    struct Change {
+        static constexpr size_t npos = SIZE_MAX;
+
+        enum Kind : uint8_t { Added, Removed, Modified };
+
+        Kind    kind;
+        uint8_t fields{}; // Field bits, Modified only
+        size_t  base_index{npos};
+        size_t  other_index{npos};
+    };
+
+    // The items are borrowed and must outlive the diff.
+    explicit RKCfgDiff(std::span<const RKCfgItem> base);
+
+    // Modified and added items in the order of other, then the removed ones in the order of the baseline. Empty if
+    // both files hold the same items.
+    std::vector<Change> compare(std::span<const RKCfgItem> other) const;
+
+    std::span<const RKCfgItem> getBase() const;
+
+private:
+    std::span<const RKCfgItem>                                   m_base;
+    std::unordered_map<std::u16string_view, std::vector<size_t>> m_names;
+    // Index of the previous base item with the same name, Change::npos for the first one.
+    std::vector<size_t> m_previous;
+};
+
+} // namespace rockchip
@@ -0,0 +1,410 @@
+#include "RKCfgIndex.h"
+#include "RKCfgView.h"
+#include "RKError.h"
+
+#include "util/File.h"
+#include "util/String.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <memory>
+
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+namespace {
+
+constexpr size_t section_alignment = 8;
+
+size_t align(size_t size) { return (size + section_alignment - 1) / section_alignment * section_alignment; }
+
+// File name of an image path, with either separator.
+std::string_view file_name_of(std::string_view image_path) {
+    auto separator = image_path.find_last_of("/\\");
+    return separator == std::string_view::npos ? image_path : image_path.substr(separator + 1);
+}
+
+bool same_image_path(std::string_view lhs, std::string_view rhs) {
+    auto normalize = [](char chr) { return chr == '\\' ? '/' : chr; };
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [&](char x, char y) {
+        return normalize(x) == normalize(y);
+    });
+}
+
+// A file to index, before its strings are interned.
+struct FileRecord {
+    struct Item {
+        std::string name;
+        std::string image_path;
+        uint32_t    address{};
+        bool        is_selected{};
+    };
+
+    std::string       path;
+    uint64_t          size{};
+    int64_t           mtime{};
+    std::vector<Item> items;
+    bool              indexed{};
+};
+
+template <class T>
+void append_section(std::vector<std::byte>& out, std::span<const T> values) {
+    auto bytes = std::as_bytes(values);
+    out.insert(out.end(), bytes.begin(), bytes.end());
+    out.resize(align(out.size()));
+}
+
+// Points values at the next section of the mapping, false if it does not fit.
+template <class T>
+bool take_section(std::span<const std::byte> bytes, size_t& offset, uint64_t count, std::span<const T>& values) {
+    if (offset > bytes.size() || count > (bytes.size() - offset) / sizeof(T)) return false;
+    values  = {reinterpret_cast<const T*>(bytes.data() + offset), static_cast<size_t>(count)};
+    offset += align(count * sizeof(T));
+    return true;
+}
+
+// Posting keys and their runs from (key, item) pairs.
+void add_postings(
+    std::vector<std::pair<uint32_t, uint32_t>>& pairs,
+    std::vector<RKCfgIndexPostingKey>&          keys,
+    std::vector<uint32_t>&                      postings
+) {
+    std::sort(pairs.begin(), pairs.end());
+    for (size_t idx = 0; idx < pairs.size();) {
+        RKCfgIndexPostingKey key{pairs[idx].first, static_cast<uint32_t>(postings.size()), 0};
+        for (; idx < pairs.size() && pairs[idx].first == key.key; idx++) {
+            postings.push_back(pairs[idx].second);
+            key.posting_count++;
+        }
+        keys.push_back(key);
+    }
+}
+
+} // namespace
+
+void RKCfgIndex::build(
+    const std::string& directory,
+    const std::string& path,
+    util::ThreadPool&  pool,
+    BuildStats&        stats,
+    std::error_code&   ec
+) {
+    stats = {};
+    std::vector<FileRecord> records;
+    {
+        namespace fs = std::filesystem;
+        std::error_code list_ec;
+        auto            options = fs::directory_options::skip_permission_denied;
+        auto            it      = fs::recursive_directory_iterator(directory, options, list_ec);
+        for (; !list_ec && it != fs::recursive_directory_iterator(); it.increment(list_ec)) {
+            std::error_code entry_ec;
+            if (!it->is_regular_file(entry_ec) || it->path().extension() != ".cfg") continue;
+            FileRecord record;
+            record.path  = it->path().string();
+            record.size  = it->file_size(entry_ec);
+            record.mtime = it->last_write_time(entry_ec).time_since_epoch().count();
+            if (!entry_ec) records.emplace_back(std::move(record));
+        }
+        if (list_ec) {
+            spdlog::debug("Unable to list {}: {}", directory, list_ec.message());
+            ec = make_rkcfg_index_error(RKCfgIndexErrorCode::UnableToListDirectory);
+            return;
+        }
+    }
+    std::sort(records.begin(), records.end(), [](const auto& lhs, const auto& rhs) { return lhs.path < rhs.path; });
+
+    // Files are stored sorted by path, as are the strings, so a path id orders the files too.
+    std::optional<RKCfgIndex> previous;
+    if (std::error_code exists_ec; std::filesystem::exists(path, exists_ec)) {
+        std::error_code open_ec;
+        previous = open(path, open_ec);
+        if (!previous) spdlog::warn("Unable to read {} ({}), indexing every file again.", path, open_ec.message());
+    }
+    auto reuse = [&](FileRecord& record) {
+        if (!previous) return false;
+        auto id = previous->findString(record.path);
+        if (!id) return false;
+        auto it = std::lower_bound(
+            previous->m_files.begin(),
+            previous->m_files.end(),
+            *id,
+            [](const RKCfgIndexFile& file, uint32_t id) { return file.path < id; }
+        );
+        if (it == previous->m_files.end() || it->path != *id || it->size != record.size || it->mtime != record.mtime)
+            return false;
+        if (uint64_t(it->first_item) + it->item_count > previous->m_items.size()) return false;
+        for (const auto& item : previous->m_items.subspan(it->first_item, it->item_count)) {
+            auto name       = previous->string(item.name);
+            auto image_path = previous->string(item.image_path);
+            record.items.push_back({std::string(name), std::string(image_path), item.address, item.is_selected != 0});
+        }
+        return true;
+    };
+
+    std::vector<size_t> changed;
+    for (size_t idx = 0; idx < records.size(); idx++) {
+        records[idx].indexed = reuse(records[idx]);
+        if (records[idx].indexed) {
+            stats.reused++;
+        } else {
+            changed.push_back(idx);
+        }
+    }
+    // Read in bulk, then decoded on the pool: with io_uring the callback runs on this thread.
+    struct Loaded {
+        std::vector<std::byte> buffer;
+        RKCfgView              view;
+    };
+    std::vector<std::string> changed_paths;
+    changed_paths.reserve(changed.size());
+    for (auto idx : changed) changed_paths.push_back(records[idx].path);
+    auto decode = [&](size_t idx, auto&& buffer, auto&& view, const std::error_code& view_ec) {
+        auto& record = records[changed[idx]];
+        if (!view) {
+            spdlog::debug("Unable to index {}: {}", record.path, view_ec.message());
+            return;
+        }
+        auto loaded = std::make_shared<Loaded>(std::move(buffer), std::move(*view));
+        pool.submit([&record, loaded] {
+            for (const auto& item : loaded->view.getItems()) {
+                record.items.push_back({
+                    util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE),
+                    util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE),
+                    item.address,
+                    item.is_selected != 0,
+                });
+            }
+            record.indexed = true;
+        });
+    };
+    RKCfgView::openAll(changed_paths, pool, decode);
+    pool.wait();
+    stats.parsed = changed.size();
+    for (auto idx : changed) {
+        if (!records[idx].indexed) stats.failed++;
+    }
+    stats.parsed -= stats.failed;
+    std::erase_if(records, [](const FileRecord& record) { return !record.indexed; });
+
+    // Interned once: an id is the rank of the text.
+    std::vector<std::string_view> texts;
+    for (const auto& record : records) {
+        texts.emplace_back(record.path);
+        for (const auto& item : record.items) {
+            texts.emplace_back(item.name);
+            texts.emplace_back(item.image_path);
+            texts.emplace_back(file_name_of(item.image_path));
+        }
+    }
+    std::sort(texts.begin(), texts.end());
+    texts.erase(std::unique(texts.begin(), texts.end()), texts.end());
+    auto id_of = [&](std::string_view text) {
+        return static_cast<uint32_t>(std::lower_bound(texts.begin(), texts.end(), text) - texts.begin());
+    };
+
+    std::vector<RKCfgIndexString> strings;
+    std::string                   string_data;
+    strings.reserve(texts.size());
+    for (auto text : texts) {
+        strings.push_back({static_cast<uint32_t>(string_data.size()), static_cast<uint32_t>(text.size())});
+        string_data.append(text);
+    }
+    if (string_data.size() > std::numeric_limits<uint32_t>::max()) {
+        ec = make_rkcfg_index_error(RKCfgIndexErrorCode::UnableToWriteFile);
+        return;
+    }
+
+    std::vector<RKCfgIndexFile>                files;
+    std::vector<RKCfgIndexItem>                items;
+    std::vector<std::pair<uint32_t, uint32_t>> by_name, by_image, by_address;
+    for (const auto& record : records) {
+        auto file = static_cast<uint32_t>(files.size());
+        files.push_back({
+            id_of(record.path),
+            static_cast<uint32_t>(items.size()),
+            static_cast<uint32_t>(record.items.size()),
+            0,
+            record.size,
+            record.mtime,
+        });
+        for (const auto& item : record.items) {
+            auto idx  = static_cast<uint32_t>(items.size());
+            auto name = id_of(item.name);
+            items.push_back({file, name, id_of(item.image_path), item.address, item.is_selected});
+            by_name.emplace_back(name, idx);
+            by_address.emplace_back(item.address, idx);
+            if (!item.image_path.empty()) by_image.emplace_back(id_of(file_name_of(item.image_path)), idx);
+        }
+    }
+    std::vector<RKCfgIndexPostingKey> name_keys, image_keys, address_keys;
+    std::vector<uint32_t>             postings;
+    add_postings(by_name, name_keys, postings);
+    add_postings(by_image, image_keys, postings);
+    add_postings(by_address, address_keys, postings);
+
+    RKCfgIndexHeader header;
+    header.file_count        = static_cast<uint32_t>(files.size());
+    header.item_count        = static_cast<uint32_t>(items.size());
+    header.string_count      = static_cast<uint32_t>(strings.size());
+    header.name_key_count    = static_cast<uint32_t>(name_keys.size());
+    header.image_key_count   = static_cast<uint32_t>(image_keys.size());
+    header.address_key_count = static_cast<uint32_t>(address_keys.size());
+    header.posting_count     = static_cast<uint32_t>(postings.size());
+    header.string_data_size  = string_data.size();
+
+    std::vector<std::byte> out;
+    append_section(out, std::span<const RKCfgIndexHeader>(&header, 1));
+    append_section(out, std::span<const RKCfgIndexFile>(files));
+    append_section(out, std::span<const RKCfgIndexItem>(items));
+    append_section(out, std::span<const RKCfgIndexString>(strings));
+    append_section(out, std::span<const RKCfgIndexPostingKey>(name_keys));
+    append_section(out, std::span<const RKCfgIndexPostingKey>(image_keys));
+    append_section(out, std::span<const RKCfgIndexPostingKey>(address_keys));
+    append_section(out, std::span<const uint32_t>(postings));
+    append_section(out, std::span<const char>(string_data));
+
+    // Unmapped first, the rename may replace it.
+    previous.reset();
+    auto            temp_path = path + ".tmp";
+    std::error_code system_ec;
+    auto            file = util::File::open(temp_path, util::File::Create, system_ec);
+    if (file) {
+        file->write(0, out, system_ec);
+        file->close();
+        if (!system_ec) std::filesystem::rename(temp_path, path, system_ec);
+    }
+    if (system_ec) {
+        spdlog::debug("Unable to write {}: {}", path, system_ec.message());
+        std::error_code remove_ec;
+        std::filesystem::remove(temp_path, remove_ec);
+        ec = make_rkcfg_index_error(RKCfgIndexErrorCode::UnableToWriteFile);
+        return;
+    }
+    stats.files   = files.size();
+    stats.items   = items.size();
+    stats.strings = strings.size();
+}
+
+std::optional<RKCfgIndex> RKCfgIndex::open(const std::string& path, std::error_code& ec) {
+    std::error_code map_ec;
+    auto            mapping = util::MappedFile::open(path, map_ec);
+    if (!mapping) {
+        spdlog::debug("Unable to map {}: {}", path, map_ec.message());
+        ec = make_rkcfg_index_error(RKCfgIndexErrorCode::UnableToOpenFile);
+        return {};
+    }
+    auto       bytes = mapping->bytes();
+    RKCfgIndex index;
+    if (bytes.size() < sizeof(RKCfgIndexHeader)) {
+        ec = make_rkcfg_index_error(RKCfgIndexErrorCode::MalformedIndex);
+        return {};
+    }
+    const auto*      header = reinterpret_cast<const RKCfgIndexHeader*>(bytes.data());
+    RKCfgIndexHeader expected;
+    if (std::memcmp(header->magic, expected.magic, sizeof(expected.magic)) != 0
+        || header->version != expected.version) {
+        ec = make_rkcfg_index_error(RKCfgIndexErrorCode::MalformedIndex);
+        return {};
+    }
+    size_t                offset = align(sizeof(RKCfgIndexHeader));
+    std::span<const char> string_data;
+    if (!take_section(bytes, offset, header->file_count, index.m_files)
+        || !take_section(bytes, offset, header->item_count, index.m_items)
+        || !take_section(bytes, offset, header->string_count, index.m_strings)
+        || !take_section(bytes, offset, header->name_key_count, index.m_name_keys)
+        || !take_section(bytes, offset, header->image_key_count, index.m_image_keys)
+        || !take_section(bytes, offset, header->address_key_count, index.m_address_keys)
+        || !take_section(bytes, offset, header->posting_count, index.m_postings)
+        || !take_section(bytes, offset, header->string_data_size, string_data)) {
+        ec = make_rkcfg_index_error(RKCfgIndexErrorCode::MalformedIndex);
+        return {};
+    }
+    index.m_header      = header;
+    index.m_string_data = {string_data.data(), string_data.size()};
+    index.m_mapping     = std::move(*mapping);
+    return index;
+}
+
+std::vector<RKCfgIndex::Match> RKCfgIndex::find(const Query& query) const {
+    std::vector<uint32_t> candidates;
+    bool                  narrowed{};
+    // Intersection of the posting runs of the criteria, which are all sorted by item.
+    auto narrow = [&](std::span<const uint32_t> run) {
+        if (!narrowed) {
+            candidates.assign(run.begin(), run.end());
+            narrowed = true;
+            return;
+        }
+        std::vector<uint32_t> kept;
+        std::set_intersection(candidates.begin(), candidates.end(), run.begin(), run.end(), std::back_inserter(kept));
+        candidates.swap(kept);
+    };
+    if (query.name) {
+        auto id = findString(*query.name);
+        narrow(id ? postings(m_name_keys, *id) : std::span<const uint32_t>());
+    }
+    if (query.image) {
+        auto id = findString(file_name_of(*query.image));
+        narrow(id ? postings(m_image_keys, *id) : std::span<const uint32_t>());
+    }
+    if (query.address) narrow(postings(m_address_keys, *query.address));
+
+    bool               whole_path = query.image && query.image->find_first_of("/\\") != std::string::npos;
+    std::vector<Match> matches;
+    for (auto idx : candidates) {
+        if (idx >= m_items.size()) continue;
+        const auto& item = m_items[idx];
+        if (item.file >= m_files.size()) continue;
+        const auto& file       = m_files[item.file];
+        auto        image_path = string(item.image_path);
+        if (whole_path && !same_image_path(image_path, *query.image)) continue;
+        matches.push_back({
+            string(file.path),
+            idx - file.first_item,
+            string(item.name),
+            image_path,
+            item.address,
+            item.is_selected != 0,
+        });
+    }
+    return matches;
+}
+
+RKCfgIndexHeader const& RKCfgIndex::getHeader() const { return *m_header; }
+
+std::string_view RKCfgIndex::string(uint32_t id) const {
+    if (id >= m_strings.size()) return {};
+    const auto& entry = m_strings[id];
+    if (uint64_t(entry.offset) + entry.length > m_string_data.size()) return {};
+    return m_string_data.substr(entry.offset, entry.length);
+}
+
+std::optional<uint32_t> RKCfgIndex::findString(std::string_view text) const {
+    size_t first = 0;
+    size_t last  = m_strings.size();
+    while (first < last) {
+        auto middle = first + (last - first) / 2;
+        if (string(static_cast<uint32_t>(middle)) < text) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    if (first == m_strings.size() || string(static_cast<uint32_t>(first)) != text) return {};
+    return static_cast<uint32_t>(first);
+}
+
+std::span<const uint32_t> RKCfgIndex::postings(std::span<const RKCfgIndexPostingKey> keys, uint32_t key) const {
+    auto it = std::lower_bound(keys.begin(), keys.end(), key, [](const RKCfgIndexPostingKey& entry, uint32_t key) {
+        return entry.key < key;
+    });
+    if (it == keys.end() || it->key != key) return {};
+    if (uint64_t(it->first_posting) + it->posting_count > m_postings.size()) return {};
+    return m_postings.subspan(it->first_posting, it->posting_count);
+}
+
+} // namespace rockchip
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "util/MappedFile.h"
+#include "util/ThreadPool.h"
+
+// Index file, little-endian, every section starting on an 8-byte boundary:
+//     * header
+//     * files, then items (grouped by file, in file order)
+//     * strings: offset and length in the string data, sorted by text so that ids are found by binary search
+//     * posting keys by name, by image file name and by address, sorted by key, each pointing at a run of postings
+//     * postings: item indexes, ascending within a run
+//     * string data: UTF-8, not terminated
+
+namespace rockchip {
+
+struct RKCfgIndexHeader {
+    char     magic[8] = {'R', 'K', 'C', 'F', 'G', 'I', 'D', 'X'};
+    uint32_t version  = RK_CFG_INDEX_VERSION;
+    uint32_t file_count{};
+    uint32_t item_count{};
+    uint32_t string_count{};
+    uint32_t name_key_count{};
+    uint32_t image_key_count{};
+    uint32_t address_key_count{};
+    uint32_t posting_count{};
+    uint64_t string_data_size{};
+    // external
+    static constexpr uint32_t RK_CFG_INDEX_VERSION = 1;
+};
+
+struct RKCfgIndexFile {
+    uint32_t path; // string id
+    uint32_t first_item;
+    uint32_t item_count;
+    uint32_t reserved;
+    uint64_t size;
+    int64_t  mtime; // std::filesystem::file_time_type ticks
+};
+
+struct RKCfgIndexItem {
+    uint32_t file;
+    uint32_t name;       // string id
+    uint32_t image_path; // string id
+    uint32_t address;
+    uint32_t is_selected;
+};
+
+struct RKCfgIndexString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct RKCfgIndexPostingKey {
+    uint32_t key; // string id, or the address
+    uint32_t first_posting;
+    uint32_t posting_count;
+};
+
+static_assert(sizeof(RKCfgIndexHeader) == 48);
+static_assert(sizeof(RKCfgIndexFile) == 32);
+static_assert(sizeof(RKCfgIndexItem) == 20);
+static_assert(sizeof(RKCfgIndexString) == 8);
+static_assert(sizeof(RKCfgIndexPostingKey) == 12);
+
+// Reverse lookups over many cfg files ("which cfgs reference rootfs_v3.img", "which cfgs put userdata at X") from
+// an index built once per directory tree and mapped for every query: lookups are binary searches over the posting
+// keys, nothing is parsed.
+class RKCfgIndex {
+public:
+    struct BuildStats {
+        size_t files{};
+        size_t reused{}; // taken from the previous index, same size and modification time
+        size_t parsed{};
+        size_t failed{}; // not cfg files, left out of the index
+        size_t items{};
+        size_t strings{};
+    };
+
+    // Indexes every .cfg file under directory (recursively) into path. Files whose size and modification time match
+    // the previous index at path (if any) are taken from it, the others are read in bulk (RKCfgView::openAll) and
+    // parsed on the pool. The index is written to a temporary file renamed over path, so that queries running
+    // meanwhile see the previous one.
+    static void build(
+        const std::string& directory,
+        const std::string& path,
+        util::ThreadPool&  pool,
+        BuildStats&        stats,
+        std::error_code&   ec
+    );
+
+    // Maps an index and checks its header and section sizes, everything else is checked as it is read.
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgIndex> open(const std::string& path, std::error_code& ec);
+
+    struct Query {
+        std::optional<std::string> name;
+        // An image file name, or a whole image path if it has a separator ('\\' and '/' being the same).
+        std::optional<std::string> image;
+        std::optional<uint32_t>    address;
+    };
+
+    struct Match {
+        std::string_view file;
+        size_t           index; // in the file
+        std::string_view name;
+        std::string_view image_path;
+        uint32_t         address;
+        bool             is_selected;
+    };
+
+    // Items matching every criterion of the query, in file order. Views point into the mapping.
+    std::vector<Match> find(const Query& query) const;
+
+    RKCfgIndexHeader const& getHeader() const;
+
+private:
+    RKCfgIndex() = default;
+
+    // Empty for an id out of range.
+    std::string_view        string(uint32_t id) const;
+    std::optional<uint32_t> findString(std::string_view text) const;
+    // Empty if the key is missing or its run is out of range.
+    std::span<const uint32_t> postings(std::span<const RKCfgIndexPostingKey> keys, uint32_t key) const;
+
+    util::MappedFile m_mapping;
+    // Point into the mapping, which does not move with the object.
+    const RKCfgIndexHeader*               m_header{};
+    std::span<const RKCfgIndexFile>       m_files;
+    std::span<const RKCfgIndexItem>       m_items;
+    std::span<const RKCfgIndexString>     m_strings;
+    std::span<const RKCfgIndexPostingKey> m_name_keys;
+    std::span<const RKCfgIndexPostingKey> m_image_keys;
+    std::span<const RKCfgIndexPostingKey> m_address_keys;
+    std::span<const uint32_t>             m_postings;
+    std::string_view                      m_string_data;
+};
+
+} // namespace rockchip
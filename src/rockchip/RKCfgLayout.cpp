@@ -0,0 +1,58 @@
+#include "RKCfgLayout.h"
+#include "RKError.h"
+
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+// Compiles the decoding and encoding of a layout other than v2.86, see detail::rk_cfg_layout_round_trip.
+template struct RKCfgItemCodec<detail::rk_cfg_layout_round_trip>;
+
+const RKCfgHeader* check_cfg_header(std::span<const std::byte> buffer, std::error_code& ec) {
+    auto file_size = buffer.size();
+    if (file_size < sizeof(RKCfgHeader)) {
+        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::IsNotRKCfgFile);
+        return {};
+    }
+    auto header = reinterpret_cast<const RKCfgHeader*>(buffer.data());
+    if (memcmp(header->magic, "CFG", sizeof(header->magic)) != 0) {
+        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::IsNotRKCfgFile);
+        return {};
+    }
+    auto is_known = [&](const RKCfgItemLayout& layout) { return layout.item_size == header->item_size; };
+    if (std::ranges::none_of(rk_cfg_layouts, is_known)) {
+        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnsupportedItemSize);
+        return {};
+    }
+    auto items_size = (size_t)header->item_size * header->length;
+    auto legal_size = sizeof(RKCfgHeader) + items_size;
+    if (file_size != legal_size || header->begin > file_size - items_size) {
+        spdlog::debug("file_size = {:#x} (legal size = {:#x})", file_size, legal_size);
+        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::AbnormalFileSize);
+        return {};
+    }
+    return header;
+}
+
+std::optional<std::vector<std::byte>>
+convert_cfg(std::span<const std::byte> buffer, size_t item_size, std::error_code& ec) {
+    auto header = check_cfg_header(buffer, ec);
+    if (!header) return {};
+    // One dispatch on each side, then the copies of that pair of layouts.
+    std::optional<std::vector<std::byte>> result;
+    visit_layout(header->item_size, [&]<RKCfgItemLayout From>() {
+        visit_layout(item_size, [&]<RKCfgItemLayout To>() {
+            RKCfgHeader converted = *header;
+            converted.begin       = sizeof(RKCfgHeader);
+            converted.item_size   = static_cast<uint16_t>(To.item_size);
+            std::vector<std::byte> output(sizeof(RKCfgHeader) + To.item_size * header->length);
+            std::memcpy(output.data(), &converted, sizeof(RKCfgHeader));
+            convert_items<From, To>(buffer.data() + header->begin, output.data() + sizeof(RKCfgHeader), header->length);
+            result = std::move(output);
+        });
+    });
+    if (!result) ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnsupportedItemSize);
+    return result;
+}
+
+} // namespace rockchip
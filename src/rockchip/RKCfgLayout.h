@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "RKPreDefines.h"
+
+namespace rockchip {
+
+// Where the fields of an item lie in the cfg files of one RKDevTool version: offsets in bytes, widths in UTF-16 code
+// units. Fields come in this order, anything between them is padding. The header is the same for every version.
+struct RKCfgItemLayout {
+    size_t item_size;
+    size_t name_offset;
+    size_t name_width;
+    size_t image_path_offset;
+    size_t image_path_width;
+    size_t address_offset;
+    size_t selected_offset;
+
+    bool operator==(const RKCfgItemLayout&) const = default;
+
+    constexpr bool isValid() const {
+        return name_width > 0 && image_path_width > 0 &&
+               name_offset + name_width * sizeof(char16_t) <= image_path_offset &&
+               image_path_offset + image_path_width * sizeof(char16_t) <= address_offset &&
+               address_offset + sizeof(uint32_t) <= selected_offset && selected_offset < item_size &&
+               item_size <= UINT16_MAX;
+    }
+};
+
+// RKDevTool v2.86, the layout of RKCfgItem itself.
+inline constexpr RKCfgItemLayout rk_cfg_layout_v286 = {
+    sizeof(RKCfgItem),
+    offsetof(RKCfgItem, name),
+    sizeof(RKCfgItem::name) / sizeof(char16_t),
+    offsetof(RKCfgItem, image_path),
+    sizeof(RKCfgItem::image_path) / sizeof(char16_t),
+    offsetof(RKCfgItem, address),
+    offsetof(RKCfgItem, is_selected),
+};
+
+static_assert(rk_cfg_layout_v286.isValid());
+static_assert(rk_cfg_layout_v286.item_size == 610);
+static_assert(rk_cfg_layout_v286.name_width == 40 && rk_cfg_layout_v286.image_path_width == 260);
+
+// Every layout read, told apart by the item size of the header. Layouts of other RKDevTool versions go here once
+// they are known, RKCfgItem (and so everything in memory and every file written) stays in the v2.86 one.
+inline constexpr std::array rk_cfg_layouts = {rk_cfg_layout_v286};
+
+static_assert(std::ranges::all_of(rk_cfg_layouts, [](const RKCfgItemLayout& layout) { return layout.isValid(); }));
+static_assert(
+    [] {
+        for (size_t i = 0; i < rk_cfg_layouts.size(); i++) {
+            for (size_t j = i + 1; j < rk_cfg_layouts.size(); j++) {
+                if (rk_cfg_layouts[i].item_size == rk_cfg_layouts[j].item_size) return false;
+            }
+        }
+        return true;
+    }(),
+    "item sizes must tell the layouts apart"
+);
+
+namespace detail {
+
+// The fields of one item, dst being zeroed already. Strings are truncated or zero-padded to the widths of To.
+template <RKCfgItemLayout From, RKCfgItemLayout To>
+constexpr void copy_item_fields(const std::byte* src, std::byte* dst) {
+    constexpr auto name_size = std::min(From.name_width, To.name_width) * sizeof(char16_t);
+    constexpr auto path_size = std::min(From.image_path_width, To.image_path_width) * sizeof(char16_t);
+    std::copy_n(src + From.name_offset, name_size, dst + To.name_offset);
+    std::copy_n(src + From.image_path_offset, path_size, dst + To.image_path_offset);
+    std::copy_n(src + From.address_offset, sizeof(uint32_t), dst + To.address_offset);
+    std::copy_n(src + From.selected_offset, sizeof(uint8_t), dst + To.selected_offset);
+}
+
+} // namespace detail
+
+// Decoding to and encoding from RKCfgItem with every offset and width known at compile time: a plain copy for the
+// v2.86 layout, a fixed sequence of field copies for the others.
+template <RKCfgItemLayout Layout>
+struct RKCfgItemCodec {
+    static_assert(Layout.isValid());
+
+    static constexpr bool is_native = Layout == rk_cfg_layout_v286;
+
+    static void decode(const std::byte* src, RKCfgItem& item) {
+        if constexpr (is_native) {
+            std::memcpy(&item, src, sizeof(RKCfgItem));
+        } else {
+            item = RKCfgItem();
+            detail::copy_item_fields<Layout, rk_cfg_layout_v286>(src, reinterpret_cast<std::byte*>(&item));
+        }
+    }
+
+    static void encode(const RKCfgItem& item, std::byte* dst) {
+        if constexpr (is_native) {
+            std::memcpy(dst, &item, sizeof(RKCfgItem));
+        } else {
+            std::memset(dst, 0, Layout.item_size);
+            detail::copy_item_fields<rk_cfg_layout_v286, Layout>(reinterpret_cast<const std::byte*>(&item), dst);
+        }
+    }
+};
+
+// count items from one layout to another, buffer to buffer.
+template <RKCfgItemLayout From, RKCfgItemLayout To>
+constexpr void convert_items(const std::byte* src, std::byte* dst, size_t count) {
+    if constexpr (From == To) {
+        std::copy_n(src, count * From.item_size, dst);
+    } else {
+        std::fill_n(dst, count * To.item_size, std::byte{});
+        for (size_t idx = 0; idx < count; idx++)
+            detail::copy_item_fields<From, To>(src + idx * From.item_size, dst + idx * To.item_size);
+    }
+}
+
+namespace detail {
+
+// Not an RKDevTool version: narrower fields at other offsets in a 584-byte item, for the compile-time round trip
+// below (and the explicit instantiation of its codec in RKCfgLayout.cpp) to exercise the conversions between distinct
+// layouts while only v2.86 is registered.
+inline constexpr RKCfgItemLayout rk_cfg_layout_round_trip = {584, 0, 32, 64, 256, 576, 580};
+
+static_assert(rk_cfg_layout_round_trip.isValid());
+
+// An item converted from v2.86 to Other and back is unchanged, given strings that fit the widths of Other.
+template <RKCfgItemLayout Other>
+constexpr bool round_trips() {
+    constexpr auto                          native = rk_cfg_layout_v286;
+    std::array<std::byte, native.item_size> item{};
+    std::array<std::byte, native.item_size> back{};
+    std::array<std::byte, Other.item_size>  other{};
+
+    auto put = [&](size_t offset, std::u16string_view text) {
+        for (size_t idx = 0; idx < text.size(); idx++) {
+            item[offset + idx * 2]     = std::byte(text[idx] & 0xff);
+            item[offset + idx * 2 + 1] = std::byte(text[idx] >> 8);
+        }
+    };
+    put(native.name_offset, u"boot");
+    put(native.image_path_offset, u"Image/boot.img");
+    item[native.address_offset + 1] = std::byte{0x40};
+    item[native.selected_offset]    = std::byte{1};
+    convert_items<native, Other>(item.data(), other.data(), 1);
+    convert_items<Other, native>(other.data(), back.data(), 1);
+    return item == back && other[Other.name_offset] == std::byte{'b'} &&
+           other[Other.image_path_offset] == std::byte{'I'} && other[Other.address_offset + 1] == std::byte{0x40} &&
+           other[Other.selected_offset] == std::byte{1};
+}
+
+static_assert(round_trips<rk_cfg_layout_round_trip>());
+static_assert(round_trips<rk_cfg_layout_v286>());
+
+} // namespace detail
+
+// Calls visit.template operator()<Layout>() for the registered layout with that item size. Returns false if there is
+// none, without calling anything.
+template <class Visit>
+bool visit_layout(size_t item_size, Visit&& visit) {
+    return [&]<size_t... I>(std::index_sequence<I...>) {
+        return ((rk_cfg_layouts[I].item_size == item_size && (visit.template operator()<rk_cfg_layouts[I]>(), true)) ||
+                ...);
+    }(std::make_index_sequence<rk_cfg_layouts.size()>());
+}
+
+// Header of a cfg file in a registered layout, checked against the size of buffer. ec is a RKCfgLoadErrorCode
+// otherwise.
+const RKCfgHeader* check_cfg_header(std::span<const std::byte> buffer, std::error_code& ec);
+
+// Rewrites a whole cfg file (header and items) in the layout with item_size, the items being stored right after the
+// header. ec is a RKCfgLoadErrorCode if buffer is not a valid cfg file or either layout is unknown.
+// TODO: Replace with: std::expected
+std::optional<std::vector<std::byte>>
+convert_cfg(std::span<const std::byte> buffer, size_t item_size, std::error_code& ec);
+
+} // namespace rockchip
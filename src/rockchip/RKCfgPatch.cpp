@@ -0,0 +1,213 @@
+#include "RKCfg.h"
+#include "RKCfgView.h"
+
+#include "util/File.h"
+#include "util/String.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+namespace {
+
+// Applies every matching patch to item, returns true if it is removed.
+bool apply_patches(const RKCfgFile::ItemPatchCollection& patches, size_t idx, RKCfgItem& item) {
+    for (const auto& patch : patches) {
+        if (!patch.selector.matches(idx, item)) continue;
+        switch (patch.action) {
+        case RKCfgFile::ItemPatch::SetSelected:
+            item.is_selected = static_cast<uint8_t>(patch.value);
+            break;
+        case RKCfgFile::ItemPatch::SetAddress:
+            item.address = patch.value;
+            break;
+        case RKCfgFile::ItemPatch::SetImagePath:
+            std::memcpy(item.image_path, patch.image_path, sizeof(item.image_path));
+            break;
+        case RKCfgFile::ItemPatch::Remove:
+            return true;
+        }
+    }
+    return false;
+}
+
+// Quotes only group characters, like in filter expressions.
+std::string unquote(std::string_view str) {
+    std::string result;
+    for (auto chr : str)
+        if (chr != '\'') result += chr;
+    return result;
+}
+
+std::span<const std::byte> as_bytes(const void* data, size_t size) {
+    return {static_cast<const std::byte*>(data), size};
+}
+
+void write_failed(const std::string& path, const std::error_code& system_ec, std::error_code& ec) {
+    spdlog::debug("Unable to write {}: {}", path, system_ec.message());
+    ec = make_rkcfg_patch_error(RKCfgPatchErrorCode::UnableToWriteFile);
+}
+
+// Writes the whole file next to path, then renames it over path.
+void replace_file(
+    const std::string&            path,
+    RKCfgHeader                   header,
+    const std::vector<RKCfgItem>& items,
+    std::error_code&              ec
+) {
+    auto            temp_path = path + ".patch.tmp";
+    std::error_code system_ec;
+    auto            file = util::File::open(temp_path, util::File::Create, system_ec);
+    if (file) {
+        header.begin  = sizeof(RKCfgHeader);
+        header.length = static_cast<uint8_t>(items.size());
+        file->write(0, as_bytes(&header, sizeof(header)), system_ec);
+        if (!system_ec)
+            file->write(sizeof(header), as_bytes(items.data(), items.size() * sizeof(RKCfgItem)), system_ec);
+        if (!system_ec) file->sync(system_ec);
+        file->close();
+        if (!system_ec) std::filesystem::rename(temp_path, path, system_ec);
+    }
+    if (system_ec) {
+        std::error_code remove_ec;
+        std::filesystem::remove(temp_path, remove_ec);
+        write_failed(path, system_ec, ec);
+    }
+}
+
+} // namespace
+
+std::optional<RKCfgFile::ItemPatch> RKCfgFile::parseItemPatch(const std::string& expression, std::error_code& ec) {
+    // "name:boot=image_path:'Image/boot.img'", '=' inside quotes belongs to the filter.
+    bool   is_in_quotation_mark{};
+    size_t separator = std::string::npos;
+    for (size_t i = 0; i < expression.size() && separator == std::string::npos; i++) {
+        if (expression[i] == '\'') is_in_quotation_mark = !is_in_quotation_mark;
+        else if (expression[i] == '=' && !is_in_quotation_mark) separator = i;
+    }
+    if (separator == std::string::npos) {
+        ec = make_rkcfg_patch_error(RKCfgPatchErrorCode::SyntaxError);
+        return {};
+    }
+    auto filters = parseItemFilters(expression.substr(0, separator), ec);
+    if (ec) return {};
+
+    std::string_view action(expression);
+    action.remove_prefix(separator + 1);
+    std::string_view value;
+    if (auto colon = action.find(':'); colon != std::string_view::npos) {
+        value  = action.substr(colon + 1);
+        action = action.substr(0, colon);
+    }
+    ItemPatch result{ItemFilterPlan(std::move(filters)), ItemPatch::Remove};
+    if (action == "remove") return result;
+    if (action == "image_path") {
+        result.action = ItemPatch::SetImagePath;
+        if (!util::string::to_char16(unquote(value), result.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE)) {
+            ec = make_rkcfg_patch_error(RKCfgPatchErrorCode::PathTooLong);
+            return {};
+        }
+        return result;
+    }
+    if (action == "selected" || action == "address") {
+        auto number = util::string::to_uint32(unquote(value));
+        if (!number || (action == "selected" && *number > 1)) {
+            spdlog::debug("{} is not a valid {}.", value, action);
+            ec = make_rkcfg_patch_error(RKCfgPatchErrorCode::NotANumber);
+            return {};
+        }
+        result.action = action == "selected" ? ItemPatch::SetSelected : ItemPatch::SetAddress;
+        result.value  = *number;
+        return result;
+    }
+    spdlog::debug("unknown action({}).", action);
+    ec = make_rkcfg_patch_error(RKCfgPatchErrorCode::UnknownAction);
+    return {};
+}
+
+void RKCfgFile::patch(
+    const std::string&         path,
+    const ItemPatchCollection& patches,
+    bool                       crash_safe,
+    std::error_code&           ec
+) {
+    std::optional<RKCfgFile> original;
+    {
+        // Unmapped before writing, Windows cannot truncate a mapped file.
+        auto view = RKCfgView::open(path, ec);
+        if (!view) return;
+        // Items are written in place at their v2.86 offsets.
+        if (view->getLayout() != rk_cfg_layout_v286) {
+            ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnsupportedItemSize);
+            return;
+        }
+        original = view->toFile();
+    }
+    const auto& header = original->m_header;
+    const auto& items  = original->m_items;
+
+    std::vector<RKCfgItem> patched;
+    patched.reserve(items.size());
+    size_t first_removed = items.size();
+    for (size_t idx = 0; idx < items.size(); idx++) {
+        auto item = items[idx];
+        if (apply_patches(patches, idx, item)) {
+            first_removed = std::min(first_removed, idx);
+            continue;
+        }
+        patched.push_back(item);
+    }
+
+    bool removed = patched.size() != items.size();
+    if (removed && crash_safe) {
+        replace_file(path, header, patched, ec);
+        return;
+    }
+
+    std::error_code system_ec;
+    auto            file = util::File::open(path, util::File::Existing, system_ec);
+    if (!file) {
+        write_failed(path, system_ec, ec);
+        return;
+    }
+    auto item_offset = [&](size_t idx) { return (uint64_t)header.begin + idx * sizeof(RKCfgItem); };
+    // In front of the first removed item only the bytes that changed are written, one write per item.
+    for (size_t idx = 0; idx < first_removed && !system_ec; idx++) {
+        auto   before = reinterpret_cast<const std::byte*>(&items[idx]);
+        auto   after  = reinterpret_cast<const std::byte*>(&patched[idx]);
+        size_t first  = 0;
+        size_t last   = sizeof(RKCfgItem);
+        while (first < last && before[first] == after[first]) first++;
+        if (first == last) continue;
+        while (before[last - 1] == after[last - 1]) last--;
+        file->write(item_offset(idx) + first, {after + first, last - first}, system_ec);
+    }
+    if (removed && !system_ec) {
+        // Tail compaction: the remaining items move forward in one write, then the header and the size follow.
+        auto    tail   = std::span(patched).subspan(first_removed);
+        uint8_t length = static_cast<uint8_t>(patched.size());
+        file->write(item_offset(first_removed), as_bytes(tail.data(), tail.size_bytes()), system_ec);
+        if (!system_ec) file->write(offsetof(RKCfgHeader, length), as_bytes(&length, sizeof(length)), system_ec);
+        if (!system_ec) file->truncate(sizeof(RKCfgHeader) + patched.size() * sizeof(RKCfgItem), system_ec);
+    }
+    if (crash_safe && !system_ec) file->sync(system_ec);
+    if (system_ec) write_failed(path, system_ec, ec);
+}
+
+void RKCfgFile::applyPatches(const ItemPatchCollection& patches) {
+    size_t kept = 0;
+    for (size_t idx = 0; idx < m_items.size(); idx++) {
+        auto item = m_items[idx];
+        if (apply_patches(patches, idx, item)) continue;
+        m_items[kept++] = item;
+    }
+    m_header.length -= static_cast<uint8_t>(m_items.size() - kept);
+    m_items.resize(kept);
+}
+
+} // namespace rockchip
@@ -0,0 +1,173 @@
+#include "RKCfgView.h"
+#include "RKJsonWriter.h"
+
+#include "util/BulkRead.h"
+#include "util/Profile.h"
+#include "util/String.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+RKCfgView::RKCfgView(const RKCfgFile& file) : m_header(&file.m_header), m_items(file.m_items) {}
+
+std::optional<RKCfgView> RKCfgView::open(const std::string& path, std::error_code& ec) {
+    util::profile::ScopedTimer timer(util::profile::Phase::FromFile);
+    util::profile::count(util::profile::Counter::FsCalls);
+    if (!std::filesystem::exists(path)) {
+        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::FileNotExists);
+        return {};
+    }
+    std::error_code map_ec;
+    auto            mapping = util::MappedFile::open(path, map_ec);
+    if (!mapping) {
+        spdlog::debug("Unable to map {}: {}", path, map_ec.message());
+        ec = make_rkcfg_load_error(RKCfgLoadErrorCode::UnableToOpenFile);
+        return {};
+    }
+    auto result = fromBuffer(mapping->bytes(), ec);
+    if (!result) return {};
+    // The mapped address does not change when the mapping is moved, so the header and items stay valid.
+    result->m_mapping = std::move(*mapping);
+    return result;
+}
+
+std::optional<RKCfgView> RKCfgView::fromBuffer(std::span<const std::byte> buffer, std::error_code& ec) {
+    auto header = check_cfg_header(buffer, ec);
+    if (!header) return {};
+    auto      items = buffer.data() + header->begin;
+    RKCfgView result;
+    // One dispatch per file: v2.86 items are used in place, the others are decoded once into an owned copy.
+    visit_layout(header->item_size, [&]<RKCfgItemLayout Layout>() {
+        result.m_layout = &Layout;
+        if constexpr (RKCfgItemCodec<Layout>::is_native) {
+            result.m_header = header;
+            result.m_items  = {reinterpret_cast<const RKCfgItem*>(items), header->length};
+        } else {
+            auto decoded              = std::make_shared<Decoded>();
+            decoded->header           = *header;
+            decoded->header.begin     = sizeof(RKCfgHeader);
+            decoded->header.item_size = sizeof(RKCfgItem);
+            decoded->items.resize(header->length);
+            for (size_t idx = 0; idx < header->length; idx++)
+                RKCfgItemCodec<Layout>::decode(items + idx * Layout.item_size, decoded->items[idx]);
+            result.m_header  = &decoded->header;
+            result.m_items   = decoded->items;
+            result.m_decoded = std::move(decoded);
+        }
+    });
+    return result;
+}
+
+void RKCfgView::openAll(std::span<const std::string> paths, util::ThreadPool& pool, const OpenCallback& done) {
+    util::read_files(paths, pool, [&](size_t index, std::vector<std::byte>&& buffer, const std::error_code& read_ec) {
+        util::profile::ScopedTimer timer(util::profile::Phase::FromFile);
+        std::error_code            ec;
+        std::optional<RKCfgView>   view;
+        if (read_ec) {
+            spdlog::debug("Unable to read {}: {}", paths[index], read_ec.message());
+            ec = make_rkcfg_load_error(
+                read_ec == std::errc::no_such_file_or_directory ? RKCfgLoadErrorCode::FileNotExists
+                                                                : RKCfgLoadErrorCode::UnableToOpenFile
+            );
+        } else {
+            view = fromBuffer(buffer, ec);
+        }
+        done(index, std::move(buffer), std::move(view), ec);
+    });
+}
+
+RKCfgFile RKCfgView::toFile() const {
+    RKCfgFile result;
+    result.m_header = *m_header;
+    result.m_items.reserve(m_items.size() + 1);
+    result.m_items.assign(m_items.begin(), m_items.end());
+    return result;
+}
+
+void RKCfgView::save(const std::string& path, RKCfgFile::SaveMode mode, std::error_code& ec) const {
+    util::profile::ScopedTimer timer(util::profile::Phase::Save);
+    util::profile::count(util::profile::Counter::FsCalls);
+    // Written next to path, then renamed over it: path may be the very file this view maps, which must not be
+    // truncated under it.
+    auto          temp_path = path + std::string(save_temp_suffix);
+    bool          is_json   = mode == RKCfgFile::JsonMode || mode == RKCfgFile::JsonCompactMode;
+    std::ofstream file(temp_path, is_json ? std::ios::out : std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        ec = make_rkcfg_save_error(RKCfgSaveErrorCode::UnableToOpenFile);
+        return;
+    }
+    if (is_json) {
+        RKJsonWriter writer(
+            [&](std::string_view chunk) {
+                util::profile::count(util::profile::Counter::BytesWritten, chunk.size());
+                file.write(chunk.data(), (std::streamsize)chunk.size());
+            },
+            mode == RKCfgFile::JsonMode
+        );
+        writer.write(*m_header, m_items);
+    } else {
+        file.write(reinterpret_cast<const char*>(m_header), sizeof(RKCfgHeader));
+        file.write(reinterpret_cast<const char*>(m_items.data()), m_items.size_bytes());
+        util::profile::count(util::profile::Counter::BytesWritten, sizeof(RKCfgHeader) + m_items.size_bytes());
+    }
+    file.close();
+    std::error_code system_ec;
+    if (!file) system_ec = std::make_error_code(std::errc::io_error);
+    if (!system_ec) std::filesystem::rename(temp_path, path, system_ec);
+    if (system_ec) {
+        spdlog::debug("Unable to write {}: {}", path, system_ec.message());
+        std::error_code remove_ec;
+        std::filesystem::remove(temp_path, remove_ec);
+        ec = make_rkcfg_save_error(RKCfgSaveErrorCode::UnableToWriteFile);
+    }
+}
+
+nlohmann::json RKCfgView::toJson() const {
+    util::profile::ScopedTimer timer(util::profile::Phase::ToJson);
+    nlohmann::json result;
+    result["header"]["size"]      = m_header->begin;
+    result["header"]["item_size"] = m_header->item_size;
+    for (auto& item : m_items) {
+        result["items"].emplace_back(nlohmann::json{
+            {"is_selected", (bool)item.is_selected                                                       },
+            {"address",     item.address                                                                 },
+            {"name",        util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE)      },
+            {"image_path",  util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE)}
+        });
+    }
+    return result;
+}
+
+RKCfgHeader const& RKCfgView::getHeader() const { return *m_header; }
+
+std::span<const RKCfgItem> RKCfgView::getItems() const { return m_items; }
+
+RKCfgItemLayout const& RKCfgView::getLayout() const { return *m_layout; }
+
+void RKCfgView::printDebugString() const {
+    spdlog::info("{:<12} {:#x}", "Header size:", m_header->begin);
+    spdlog::info("{:<12} {:#x}", "Item size:", m_header->item_size);
+    spdlog::info("Partitions({}): ", m_header->length);
+    spdlog::info("    {:<10} {:10} {}", "Address", "Name", "Path");
+    char name_buffer[RKCfgItem::RK_V286_MAX_NAME_SIZE * 3];
+    char image_path_buffer[RKCfgItem::RK_V286_MAX_PATH_SIZE * 3];
+    for (auto& item : m_items) {
+        auto name       = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE, name_buffer);
+        auto image_path =
+            util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE, image_path_buffer);
+        spdlog::info(
+            "[{}] {:#010x} {:<10} {}",
+            item.is_selected ? "x" : " ",
+            item.address,
+            name.empty() ? "(empty)" : name,
+            image_path.empty() ? "(empty)" : image_path
+        );
+    }
+}
+
+} // namespace rockchip
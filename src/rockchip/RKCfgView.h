@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "util/MappedFile.h"
+#include "util/ThreadPool.h"
+
+#include "RKCfg.h"
+#include "RKCfgLayout.h"
+
+namespace rockchip {
+
+// Read-only view of a cfg file. Items are exposed in place over the mapped file (or over the items of an
+// RKCfgFile), the header is validated once when the view is created and no item is ever copied. Files in another
+// layout than v2.86 (see rk_cfg_layouts) are the exception: their items are decoded once, and the header then says
+// v2.86 as well.
+class RKCfgView {
+public:
+    // Borrows the header and items of an existing file, which must outlive the view.
+    explicit RKCfgView(const RKCfgFile& file);
+
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgView> open(const std::string& path, std::error_code& ec);
+
+    // The buffer is borrowed and must outlive the view.
+    // TODO: Replace with: std::expected
+    static std::optional<RKCfgView> fromBuffer(std::span<const std::byte> buffer, std::error_code& ec);
+
+    using OpenCallback = std::function<void(
+        size_t                     index,
+        std::vector<std::byte>&&   buffer,
+        std::optional<RKCfgView>&& view,
+        const std::error_code&     ec
+    )>;
+
+    // Reads many files at once (see util::read_files, io_uring on Linux) and validates each as open does. done gets
+    // the view of paths[index] along with the buffer it points into, which may be moved but must outlive it, or the
+    // RKCfgLoadErrorCode open would have reported. It runs on the calling thread or on the pool, as util::read_files
+    // says.
+    static void openAll(std::span<const std::string> paths, util::ThreadPool& pool, const OpenCallback& done);
+
+    // Materializes an owning copy, only needed if the items are going to be modified.
+    RKCfgFile toFile() const;
+
+    // Writes a temporary file next to path (path + save_temp_suffix) and renames it over path, so the input itself can
+    // be the output.
+    static constexpr std::string_view save_temp_suffix = ".save.tmp";
+    void save(const std::string& path, RKCfgFile::SaveMode mode, std::error_code& ec) const;
+
+    nlohmann::json toJson() const;
+
+    RKCfgHeader const&         getHeader() const;
+    std::span<const RKCfgItem> getItems() const;
+
+    // Layout of the items in the file.
+    RKCfgItemLayout const& getLayout() const;
+
+    void printDebugString() const;
+
+private:
+    RKCfgView() = default;
+
+    // Header and items decoded from another layout, which m_header and m_items then point into.
+    struct Decoded {
+        RKCfgHeader            header;
+        std::vector<RKCfgItem> items;
+    };
+
+    util::MappedFile           m_mapping;
+    std::shared_ptr<Decoded>   m_decoded;
+    const RKCfgHeader*         m_header{};
+    std::span<const RKCfgItem> m_items;
+    const RKCfgItemLayout*     m_layout{&rk_cfg_layout_v286};
+};
+
+} // namespace rockchip
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <cstddef>
 #include <system_error>
 
 namespace rockchip {
 
+// Where in a text input (json, parameter.txt) an error was detected. Line and column are 1-based, 0 if unknown.
+struct RKErrorLocation {
+    size_t offset{};
+    size_t line{};
+    size_t column{};
+};
+
 // LoadError
 
 enum class RKCfgLoadErrorCode {
@@ -56,7 +64,7 @@ inline std::error_code make_rkcfg_load_error(RKCfgLoadErrorCode ec) {
 
 // SaveError
 
-enum class RKCfgSaveErrorCode { SUCCESS = 0, UnableToOpenFile };
+enum class RKCfgSaveErrorCode { SUCCESS = 0, UnableToOpenFile, UnableToWriteFile };
 
 class RKCfgSaveErrorCategory : public std::error_category {
 public:
@@ -67,6 +75,8 @@ public:
             return "Everything is ok.";
         case RKCfgSaveErrorCode::UnableToOpenFile:
             return "Unable to open file.";
+        case RKCfgSaveErrorCode::UnableToWriteFile:
+            return "Unable to write file.";
         default:
             return {};
         }
@@ -86,7 +96,8 @@ enum class RKConvertParamErrorCode {
     FileNotExists,
     UnableToOpenFile,
     MtdPartsNotFound,
-    IllegalMtdPartFormat
+    IllegalMtdPartFormat,
+    UnableToScanDirectory
 };
 
 class RKConvertParamErrorCategory : public std::error_category {
@@ -104,6 +115,8 @@ public:
             return "Unable to find mtdparts in parameter.";
         case RKConvertParamErrorCode::IllegalMtdPartFormat:
             return "Illegal mtdparts format.";
+        case RKConvertParamErrorCode::UnableToScanDirectory:
+            return "Unable to scan the directory of parameter for images.";
         default:
             return {};
         }
@@ -116,4 +129,230 @@ inline std::error_code make_rkcfg_convert_param_error(RKConvertParamErrorCode ec
     return {static_cast<int>(ec), rkcfg_convert_param_error_category};
 }
 
+// ItemFilterError
+
+enum class RKItemFilterErrorCode { SUCCESS = 0, NotANumber, UnknownFilter };
+
+class RKItemFilterErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "RKItemFilterError"; }
+    std::string message(int ev) const override {
+        switch (static_cast<RKItemFilterErrorCode>(ev)) {
+        case RKItemFilterErrorCode::SUCCESS:
+            return "Everything is ok.";
+        case RKItemFilterErrorCode::NotANumber:
+            return "Syntax error: the value of an address or index filter is not a number.";
+        case RKItemFilterErrorCode::UnknownFilter:
+            return "Syntax error: unknown filter, expected one of address, name, image_path or index.";
+        default:
+            return {};
+        }
+    }
+};
+
+inline const RKItemFilterErrorCategory rkcfg_item_filter_error_category{};
+
+inline std::error_code make_rkcfg_item_filter_error(RKItemFilterErrorCode ec) {
+    return {static_cast<int>(ec), rkcfg_item_filter_error_category};
+}
+
+// PatchError
+
+enum class RKCfgPatchErrorCode { SUCCESS = 0, SyntaxError, UnknownAction, NotANumber, PathTooLong, UnableToWriteFile };
+
+class RKCfgPatchErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "RKCfgPatchError"; }
+    std::string message(int ev) const override {
+        switch (static_cast<RKCfgPatchErrorCode>(ev)) {
+        case RKCfgPatchErrorCode::SUCCESS:
+            return "Everything is ok.";
+        case RKCfgPatchErrorCode::SyntaxError:
+            return "Syntax error: expected '<filters>=<action>'.";
+        case RKCfgPatchErrorCode::UnknownAction:
+            return "Syntax error: unknown action, expected one of selected, address, image_path or remove.";
+        case RKCfgPatchErrorCode::NotANumber:
+            return "Syntax error: the value of a selected or address action is not a number.";
+        case RKCfgPatchErrorCode::PathTooLong:
+            return "The image path is too long for the cfg file.";
+        case RKCfgPatchErrorCode::UnableToWriteFile:
+            return "Unable to write the patched file.";
+        default:
+            return {};
+        }
+    }
+};
+
+inline const RKCfgPatchErrorCategory rkcfg_patch_error_category{};
+
+inline std::error_code make_rkcfg_patch_error(RKCfgPatchErrorCode ec) {
+    return {static_cast<int>(ec), rkcfg_patch_error_category};
+}
+
+// ImageManifestError
+
+enum class RKImageManifestErrorCode {
+    SUCCESS = 0,
+    MalformedManifest,
+    UnableToWriteManifest,
+    ImageNotFound,
+    ImageMismatch
+};
+
+class RKImageManifestErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "RKImageManifestError"; }
+    std::string message(int ev) const override {
+        switch (static_cast<RKImageManifestErrorCode>(ev)) {
+        case RKImageManifestErrorCode::SUCCESS:
+            return "Everything is ok.";
+        case RKImageManifestErrorCode::MalformedManifest:
+            return "The image manifest is malformed.";
+        case RKImageManifestErrorCode::UnableToWriteManifest:
+            return "Unable to write the image manifest.";
+        case RKImageManifestErrorCode::ImageNotFound:
+            return "Some images referenced by the cfg file were not found.";
+        case RKImageManifestErrorCode::ImageMismatch:
+            return "Some images do not match the manifest.";
+        default:
+            return {};
+        }
+    }
+};
+
+inline const RKImageManifestErrorCategory rkcfg_image_manifest_error_category{};
+
+inline std::error_code make_rkcfg_image_manifest_error(RKImageManifestErrorCode ec) {
+    return {static_cast<int>(ec), rkcfg_image_manifest_error_category};
+}
+
+// UpdateImageError
+
+enum class RKUpdateImageErrorCode {
+    SUCCESS = 0,
+    TooManyPartitions,
+    NameTooLong,
+    ImageNotFound,
+    ParameterNotFound,
+    LoaderNotFound,
+    PackageTooLarge,
+    UnableToWriteFile,
+    UnableToOpenFile,
+    MalformedImage,
+    NoParameterEntry,
+    UnableToExtract
+};
+
+class RKUpdateImageErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "RKUpdateImageError"; }
+    std::string message(int ev) const override {
+        switch (static_cast<RKUpdateImageErrorCode>(ev)) {
+        case RKUpdateImageErrorCode::SUCCESS:
+            return "Everything is ok.";
+        case RKUpdateImageErrorCode::TooManyPartitions:
+            return "An update image holds at most 16 partitions.";
+        case RKUpdateImageErrorCode::NameTooLong:
+            return "A partition name or image path is too long for the update image.";
+        case RKUpdateImageErrorCode::ImageNotFound:
+            return "Some images referenced by the cfg file were not found.";
+        case RKUpdateImageErrorCode::ParameterNotFound:
+            return "The cfg file has no selected parameter item.";
+        case RKUpdateImageErrorCode::LoaderNotFound:
+            return "The cfg file has no selected Loader item, which an RKFW package requires.";
+        case RKUpdateImageErrorCode::PackageTooLarge:
+            return "The update image would exceed 4 GiB.";
+        case RKUpdateImageErrorCode::UnableToWriteFile:
+            return "Unable to write the update image.";
+        case RKUpdateImageErrorCode::UnableToOpenFile:
+            return "Unable to open the update image.";
+        case RKUpdateImageErrorCode::MalformedImage:
+            return "The update image is malformed, expected an RKFW or RKAF package.";
+        case RKUpdateImageErrorCode::NoParameterEntry:
+            return "The update image has no valid parameter entry.";
+        case RKUpdateImageErrorCode::UnableToExtract:
+            return "Unable to extract an image from the update image.";
+        default:
+            return {};
+        }
+    }
+};
+
+inline const RKUpdateImageErrorCategory rkcfg_update_image_error_category{};
+
+inline std::error_code make_rkcfg_update_image_error(RKUpdateImageErrorCode ec) {
+    return {static_cast<int>(ec), rkcfg_update_image_error_category};
+}
+
+// CfgIndexError
+
+enum class RKCfgIndexErrorCode {
+    SUCCESS = 0,
+    UnableToListDirectory,
+    UnableToWriteFile,
+    UnableToOpenFile,
+    MalformedIndex,
+};
+
+class RKCfgIndexErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "RKCfgIndexError"; }
+    std::string message(int ev) const override {
+        switch (static_cast<RKCfgIndexErrorCode>(ev)) {
+        case RKCfgIndexErrorCode::SUCCESS:
+            return "Everything is ok.";
+        case RKCfgIndexErrorCode::UnableToListDirectory:
+            return "Unable to list the directory to index.";
+        case RKCfgIndexErrorCode::UnableToWriteFile:
+            return "Unable to write the index.";
+        case RKCfgIndexErrorCode::UnableToOpenFile:
+            return "Unable to open the index.";
+        case RKCfgIndexErrorCode::MalformedIndex:
+            return "The index is malformed or was written by another version.";
+        default:
+            return {};
+        }
+    }
+};
+
+inline const RKCfgIndexErrorCategory rkcfg_index_error_category{};
+
+inline std::error_code make_rkcfg_index_error(RKCfgIndexErrorCode ec) {
+    return {static_cast<int>(ec), rkcfg_index_error_category};
+}
+
+// LayoutCheckError
+
+enum class RKLayoutCheckErrorCode {
+    SUCCESS = 0,
+    NoParameterItem,
+    UnableToOpenParameter,
+    InvalidLayout,
+};
+
+class RKLayoutCheckErrorCategory : public std::error_category {
+public:
+    const char* name() const noexcept override { return "RKLayoutCheckError"; }
+    std::string message(int ev) const override {
+        switch (static_cast<RKLayoutCheckErrorCode>(ev)) {
+        case RKLayoutCheckErrorCode::SUCCESS:
+            return "Everything is ok.";
+        case RKLayoutCheckErrorCode::NoParameterItem:
+            return "The cfg file has no parameter item to check the layout against.";
+        case RKLayoutCheckErrorCode::UnableToOpenParameter:
+            return "Unable to open the parameter file.";
+        case RKLayoutCheckErrorCode::InvalidLayout:
+            return "The partition layout is invalid.";
+        default:
+            return {};
+        }
+    }
+};
+
+inline const RKLayoutCheckErrorCategory rkcfg_layout_check_error_category{};
+
+inline std::error_code make_rkcfg_layout_check_error(RKLayoutCheckErrorCode ec) {
+    return {static_cast<int>(ec), rkcfg_layout_check_error_category};
+}
+
 } // namespace rockchip
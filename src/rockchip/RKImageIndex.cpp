@@ -0,0 +1,90 @@
+#include "RKImageIndex.h"
+
+#include "util/Profile.h"
+
+#include <algorithm>
+
+namespace rockchip {
+
+std::shared_ptr<const RKImageIndex>
+RKImageIndex::scan(const std::filesystem::path& directory, std::error_code& ec, bool with_info) {
+    util::profile::count(util::profile::Counter::FsCalls);
+    auto iterator = std::filesystem::directory_iterator(directory, ec);
+    if (ec) return {};
+    auto result         = std::make_shared<RKImageIndex>();
+    result->m_directory = directory;
+    std::vector<std::pair<std::string, FileInfo>> entries;
+    for (auto& entry : iterator) {
+        std::error_code entry_ec;
+        if (!entry.is_regular_file(entry_ec)) continue;
+        FileInfo info;
+        if (with_info) {
+            util::profile::count(util::profile::Counter::FsCalls);
+            info.size  = entry.file_size(entry_ec);
+            info.mtime = entry.last_write_time(entry_ec).time_since_epoch().count();
+        }
+        // msvc on windows can only implicitly convert std::filesystem::path to std::wstring.
+        entries.emplace_back(entry.path().filename().string(), info);
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    result->m_files.reserve(entries.size());
+    if (with_info) result->m_info.reserve(entries.size());
+    for (auto& [name, info] : entries) {
+        result->m_files.emplace_back(std::move(name));
+        if (with_info) result->m_info.push_back(info);
+    }
+    return result;
+}
+
+std::filesystem::path const& RKImageIndex::getDirectory() const { return m_directory; }
+
+bool RKImageIndex::contains(std::string_view filename) const {
+    return std::binary_search(m_files.begin(), m_files.end(), filename);
+}
+
+std::optional<std::string_view> RKImageIndex::findImage(std::string_view partition_name) const {
+    if (auto image = findByPrefix(partition_name)) return image;
+    auto stripped = partition_name;
+    if (stripped.ends_with("_a")) stripped.remove_suffix(2);
+    if (stripped.ends_with("_b")) stripped.remove_suffix(2);
+    if (stripped.size() == partition_name.size()) return {};
+    return findByPrefix(stripped);
+}
+
+std::shared_ptr<const RKImageIndex>
+RKImageIndex::withChanges(std::span<const std::string> added, std::span<const std::string> removed) const {
+    auto  result = std::make_shared<RKImageIndex>(*this);
+    auto& files  = result->m_files;
+    auto& info   = result->m_info;
+    for (const auto& file : removed) {
+        auto it = std::lower_bound(files.begin(), files.end(), file);
+        if (it == files.end() || *it != file) continue;
+        if (!info.empty()) info.erase(info.begin() + (it - files.begin()));
+        files.erase(it);
+    }
+    for (const auto& file : added) {
+        auto it = std::lower_bound(files.begin(), files.end(), file);
+        if (it != files.end() && *it == file) continue;
+        if (!info.empty()) info.insert(info.begin() + (it - files.begin()), FileInfo{});
+        files.insert(it, file);
+    }
+    return result;
+}
+
+std::vector<std::string> const& RKImageIndex::getFiles() const { return m_files; }
+
+std::vector<RKImageIndex::FileInfo> const& RKImageIndex::getFileInfo() const { return m_info; }
+
+std::optional<std::string_view> RKImageIndex::findByPrefix(std::string_view prefix) const {
+    // All names starting with prefix are adjacent in sorted order.
+    auto first = std::lower_bound(m_files.begin(), m_files.end(), prefix);
+    auto last  = first;
+    while (last != m_files.end() && last->starts_with(prefix)) last++;
+    if (first == last) return {};
+    for (auto it = first; it != last; it++) {
+        if (it->size() == prefix.size() || (*it)[prefix.size()] == '.') return *it;
+    }
+    return *first;
+}
+
+} // namespace rockchip
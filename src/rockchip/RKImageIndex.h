@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace rockchip {
+
+// Snapshot of the regular files of an image directory, listed once and kept sorted so that every partition
+// lookup is a binary search instead of another directory scan. Immutable, can be shared between threads and
+// between several parameter files living in the same directory.
+class RKImageIndex {
+public:
+    struct FileInfo {
+        uint64_t size{};
+        int64_t  mtime{}; // std::filesystem::file_time_type ticks
+    };
+
+    // With with_info, the size and modification time of every file are recorded too (one more stat per file on
+    // some platforms).
+    // TODO: Replace with: std::expected
+    static std::shared_ptr<const RKImageIndex>
+    scan(const std::filesystem::path& directory, std::error_code& ec, bool with_info = false);
+
+    std::filesystem::path const& getDirectory() const;
+
+    bool contains(std::string_view filename) const;
+
+    // Picks the image of a partition: a file named like the partition (e.g. "boot.img" for "boot") is preferred
+    // over any other file starting with its name. If nothing matches, the A/B suffix ("_a", "_b") is stripped and
+    // the lookup is repeated.
+    std::optional<std::string_view> findImage(std::string_view partition_name) const;
+
+    // Copy of the index with files added and removed (e.g. as reported by filesystem notifications), without listing
+    // the directory again. Added files get a zero size and modification time.
+    std::shared_ptr<const RKImageIndex>
+    withChanges(std::span<const std::string> added, std::span<const std::string> removed) const;
+
+    std::vector<std::string> const& getFiles() const;
+
+    // Parallel to getFiles(), empty unless the index was scanned with_info.
+    std::vector<FileInfo> const& getFileInfo() const;
+
+private:
+    std::optional<std::string_view> findByPrefix(std::string_view prefix) const;
+
+    std::filesystem::path    m_directory;
+    std::vector<std::string> m_files;
+    std::vector<FileInfo>    m_info;
+};
+
+} // namespace rockchip
@@ -0,0 +1,209 @@
+#include "RKImageManifest.h"
+#include "RKCfg.h"
+#include "RKError.h"
+
+#include "util/Hash.h"
+#include "util/MappedFile.h"
+#include "util/String.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+namespace {
+
+// Large enough that the CRC of a chunk dwarfs the cost of a task, small enough to spread a multi-GB image over
+// every worker.
+constexpr size_t crc_chunk_size = 32 << 20;
+
+// One image file, shared by all the items using it.
+struct Image {
+    std::string                     path;
+    uint64_t                        size{};
+    int64_t                         mtime{};
+    bool                            missing{};
+    const RKImageRecord*            previous{};
+    std::optional<util::MappedFile> mapping;
+    std::vector<uint32_t>           chunk_crcs;
+    uint32_t                        crc32{};
+    std::string                     sha256;
+};
+
+} // namespace
+
+std::string RKImageManifest::pathOf(const std::string& cfg_path) { return cfg_path + ".manifest.json"; }
+
+std::optional<RKImageManifest> RKImageManifest::load(const std::string& path, std::error_code& ec) {
+    auto mapping = util::MappedFile::open(path, ec);
+    if (!mapping) return {};
+    auto data = nlohmann::json::parse(
+        reinterpret_cast<const char*>(mapping->data()),
+        reinterpret_cast<const char*>(mapping->data()) + mapping->size(),
+        nullptr,
+        false
+    );
+    RKImageManifest result;
+    try {
+        for (const auto& image : data.at("images")) {
+            RKImageRecord record;
+            record.partition  = image.at("partition").get<std::string>();
+            record.image_path = image.at("image_path").get<std::string>();
+            record.path       = image.at("path").get<std::string>();
+            record.size       = image.at("size").get<uint64_t>();
+            record.mtime      = image.at("mtime").get<int64_t>();
+            record.sha256     = image.at("sha256").get<std::string>();
+            auto crc32        = image.at("crc32").get<std::string>();
+            auto [end, error] = std::from_chars(crc32.data(), crc32.data() + crc32.size(), record.crc32, 16);
+            if (error != std::errc() || end != crc32.data() + crc32.size()) throw std::invalid_argument(crc32);
+            result.m_records.emplace_back(std::move(record));
+        }
+    } catch (const std::exception& e) {
+        spdlog::debug("{}: {}", path, e.what());
+        ec = make_rkcfg_image_manifest_error(RKImageManifestErrorCode::MalformedManifest);
+        return {};
+    }
+    return result;
+}
+
+RKImageManifest RKImageManifest::build(
+    const std::string&         cfg_path,
+    std::span<const RKCfgItem> items,
+    const RKImageManifest*     previous,
+    util::ThreadPool&          pool,
+    std::vector<std::string>&  missing
+) {
+    RKImageManifest                         result;
+    std::vector<Image>                      images;
+    std::vector<size_t>                     image_of_record;
+    std::unordered_map<std::string, size_t> image_indexes;
+    for (const auto& item : items) {
+        auto image_path = util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+        if (image_path.empty()) continue;
+        RKImageRecord record;
+        record.partition  = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+        record.image_path = std::move(image_path);
+        record.path       = RKCfgFile::resolveImagePath(cfg_path, item);
+        auto [it, is_new] = image_indexes.try_emplace(record.path, images.size());
+        if (is_new) images.emplace_back().path = record.path;
+        image_of_record.push_back(it->second);
+        result.m_records.emplace_back(std::move(record));
+    }
+
+    // CRC chunks first, so that the SHA-256 passes, which cannot be split, are picked up first by the workers
+    // popping from the back of their queue.
+    std::vector<std::function<void()>> tasks;
+    std::vector<std::function<void()>> sha_tasks;
+    for (auto& image : images) {
+        std::error_code ec;
+        image.size = std::filesystem::file_size(image.path, ec);
+        if (!ec) image.mtime = std::filesystem::last_write_time(image.path, ec).time_since_epoch().count();
+        if (!ec && previous) {
+            auto record = previous->find(image.path);
+            if (record && record->size == image.size && record->mtime == image.mtime) {
+                image.previous = record;
+                continue;
+            }
+        }
+        if (!ec) image.mapping = util::MappedFile::open(image.path, ec);
+        if (ec) {
+            spdlog::debug("Unable to read {}: {}", image.path, ec.message());
+            image.missing = true;
+            missing.push_back(image.path);
+            continue;
+        }
+        // The mapping is what gets hashed, even if the file changed since it was stat'ed.
+        auto bytes             = image.mapping->bytes();
+        image.size             = bytes.size();
+        result.m_hashed_bytes += image.size;
+        result.m_hashed_images++;
+        image.chunk_crcs.resize(std::max<size_t>(1, (bytes.size() + crc_chunk_size - 1) / crc_chunk_size));
+        for (size_t chunk = 0; chunk < image.chunk_crcs.size(); chunk++) {
+            tasks.emplace_back([&image, bytes, chunk] {
+                auto        offset = chunk * crc_chunk_size;
+                util::Crc32 crc;
+                crc.update(bytes.subspan(offset, std::min(crc_chunk_size, bytes.size() - offset)));
+                image.chunk_crcs[chunk] = crc.value();
+            });
+        }
+        sha_tasks.emplace_back([&image, bytes] {
+            util::Sha256 sha;
+            sha.update(bytes);
+            image.sha256 = util::Sha256::toHex(sha.finish());
+        });
+    }
+    tasks.insert(tasks.end(), sha_tasks.begin(), sha_tasks.end());
+    pool.parallelFor(tasks.size(), [&](size_t idx) { tasks[idx](); });
+
+    for (auto& image : images) {
+        if (image.missing || image.previous) continue;
+        image.crc32 = image.chunk_crcs[0];
+        for (size_t chunk = 1; chunk < image.chunk_crcs.size(); chunk++) {
+            auto length = std::min<uint64_t>(crc_chunk_size, image.size - chunk * crc_chunk_size);
+            image.crc32 = util::Crc32::combine(image.crc32, image.chunk_crcs[chunk], length);
+        }
+        image.mapping.reset();
+    }
+
+    std::vector<RKImageRecord> records;
+    records.reserve(result.m_records.size());
+    for (size_t idx = 0; idx < result.m_records.size(); idx++) {
+        const auto& image = images[image_of_record[idx]];
+        if (image.missing) continue;
+        auto& record = result.m_records[idx];
+        if (image.previous) {
+            record.size   = image.previous->size;
+            record.mtime  = image.previous->mtime;
+            record.crc32  = image.previous->crc32;
+            record.sha256 = image.previous->sha256;
+        } else {
+            record.size   = image.size;
+            record.mtime  = image.mtime;
+            record.crc32  = image.crc32;
+            record.sha256 = image.sha256;
+        }
+        records.emplace_back(std::move(record));
+    }
+    result.m_records = std::move(records);
+    return result;
+}
+
+void RKImageManifest::save(const std::string& path, std::error_code& ec) const {
+    nlohmann::json images = nlohmann::json::array();
+    for (const auto& record : m_records) {
+        images.push_back({
+            {"partition",  record.partition                   },
+            {"image_path", record.image_path                  },
+            {"path",       record.path                        },
+            {"size",       record.size                        },
+            {"mtime",      record.mtime                       },
+            {"crc32",      fmt::format("{:08x}", record.crc32)},
+            {"sha256",     record.sha256                      }
+        });
+    }
+    std::ofstream file(path);
+    if (file.is_open()) file << nlohmann::json{{"images", std::move(images)}}.dump(4) << '\n';
+    if (!file.is_open() || !file)
+        ec = make_rkcfg_image_manifest_error(RKImageManifestErrorCode::UnableToWriteManifest);
+}
+
+const RKImageRecord* RKImageManifest::find(const std::string& path) const {
+    auto it = std::find_if(m_records.begin(), m_records.end(), [&](const auto& record) { return record.path == path; });
+    return it == m_records.end() ? nullptr : &*it;
+}
+
+std::vector<RKImageRecord> const& RKImageManifest::getRecords() const { return m_records; }
+
+size_t RKImageManifest::getHashedImages() const { return m_hashed_images; }
+
+uint64_t RKImageManifest::getHashedBytes() const { return m_hashed_bytes; }
+
+} // namespace rockchip
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "RKPreDefines.h"
+
+#include "util/ThreadPool.h"
+
+namespace rockchip {
+
+struct RKImageRecord {
+    std::string partition;
+    std::string image_path; // as written in the cfg file
+    std::string path;       // resolved against the directory of the cfg file
+    uint64_t    size{};
+    int64_t     mtime{}; // std::filesystem::file_time_type ticks
+    uint32_t    crc32{};
+    std::string sha256;
+};
+
+// CRC-32 and SHA-256 of every image referenced by a cfg file, saved as "<cfg>.manifest.json" next to it.
+class RKImageManifest {
+public:
+    static std::string pathOf(const std::string& cfg_path);
+
+    // TODO: Replace with: std::expected
+    static std::optional<RKImageManifest> load(const std::string& path, std::error_code& ec);
+
+    // Hashes the images of every item with an image path. Each image is mapped and hashed once, even if several
+    // items use it: the CRC-32 in chunks on every worker (then combined), the SHA-256 in one pass per image.
+    // Images whose size and mtime match their record in previous are not read again. Images that do not exist
+    // are listed in missing (by resolved path) and left out of the manifest.
+    static RKImageManifest build(
+        const std::string&         cfg_path,
+        std::span<const RKCfgItem> items,
+        const RKImageManifest*     previous,
+        util::ThreadPool&          pool,
+        std::vector<std::string>&  missing
+    );
+
+    void save(const std::string& path, std::error_code& ec) const;
+
+    // First record of an image, by resolved path.
+    const RKImageRecord* find(const std::string& path) const;
+
+    std::vector<RKImageRecord> const& getRecords() const;
+
+    // Images read by build (the others were taken from the previous manifest) and their total size.
+    size_t   getHashedImages() const;
+    uint64_t getHashedBytes() const;
+
+private:
+    std::vector<RKImageRecord> m_records;
+    size_t                     m_hashed_images{};
+    uint64_t                   m_hashed_bytes{};
+};
+
+} // namespace rockchip
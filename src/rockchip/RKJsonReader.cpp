@@ -0,0 +1,291 @@
+#include "RKJsonReader.h"
+
+#include "util/String.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+namespace {
+
+using json = nlohmann::json;
+
+// Input iterator that publishes how far the parser has read, so that errors found in the SAX callbacks
+// (which nlohmann does not give a position for) can be located as well.
+struct TrackingIterator {
+    using iterator_category = std::input_iterator_tag;
+    using value_type        = char;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const char*;
+    using reference         = const char&;
+
+    const char*  current;
+    const char** furthest;
+
+    reference         operator*() const { return *current; }
+    TrackingIterator& operator++() {
+        *furthest = ++current;
+        return *this;
+    }
+    TrackingIterator operator++(int) {
+        auto result = *this;
+        ++*this;
+        return result;
+    }
+    bool operator==(const TrackingIterator& other) const { return current == other.current; }
+};
+
+class Handler {
+public:
+    Handler(std::vector<RKCfgItem>& items, const char* begin, const char*& furthest)
+    : m_items(items),
+      m_begin(begin),
+      m_furthest(furthest),
+      m_scopes{Scope::Document} {}
+
+    bool null() {
+        if (skipValue()) return true;
+        // "items": null is an empty file.
+        if (m_scopes.back() == Scope::Root && m_field == Field::Items) return true;
+        return checkHeader(false) && fail(RKCfgLoadErrorCode::JsonParseError);
+    }
+
+    bool boolean(bool value) {
+        if (skipValue()) return true;
+        return number(value, value);
+    }
+
+    bool number_integer(json::number_integer_t value) {
+        if (skipValue()) return true;
+        return number(static_cast<uint64_t>(value), static_cast<double>(value));
+    }
+
+    bool number_unsigned(json::number_unsigned_t value) {
+        if (skipValue()) return true;
+        return number(value, static_cast<double>(value));
+    }
+
+    bool number_float(json::number_float_t value, const json::string_t&) {
+        if (skipValue()) return true;
+        return number(static_cast<uint64_t>(value), value);
+    }
+
+    bool string(json::string_t& value) {
+        if (skipValue()) return true;
+        if (m_scopes.back() == Scope::Item) {
+            auto& item = m_items.back();
+            if (m_field == Field::Name) {
+                util::string::to_char16(value, item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+                return true;
+            }
+            if (m_field == Field::ImagePath) {
+                util::string::to_char16(value, item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+                return true;
+            }
+        }
+        return checkHeader(false) && fail(RKCfgLoadErrorCode::JsonParseError);
+    }
+
+    bool binary(json::binary_t&) {
+        if (skipValue()) return true;
+        return fail(RKCfgLoadErrorCode::JsonParseError);
+    }
+
+    bool start_object(size_t) {
+        if (skipContainer()) return true;
+        if (m_scopes.back() == Scope::Document) {
+            m_scopes.push_back(Scope::Root);
+            return true;
+        }
+        if (m_scopes.back() == Scope::Root && m_field == Field::Header) {
+            m_scopes.push_back(Scope::Header);
+            return true;
+        }
+        if (m_scopes.back() == Scope::Items) {
+            m_items.emplace_back();
+            m_scopes.push_back(Scope::Item);
+            return true;
+        }
+        return fail(RKCfgLoadErrorCode::JsonParseError);
+    }
+
+    bool key(json::string_t& key) {
+        if (m_skip_depth) return true;
+        m_field = Field::None;
+        switch (m_scopes.back()) {
+        case Scope::Root:
+            if (key == "header") m_field = Field::Header;
+            else if (key == "items") m_field = Field::Items;
+            break;
+        case Scope::Header:
+            if (key == "size") m_field = Field::Size;
+            else if (key == "item_size") m_field = Field::ItemSize;
+            break;
+        case Scope::Item:
+            if (key == "name") m_field = Field::Name;
+            else if (key == "image_path") m_field = Field::ImagePath;
+            else if (key == "address") m_field = Field::Address;
+            else if (key == "is_selected") m_field = Field::IsSelected;
+            break;
+        default:
+            break;
+        }
+        // Unknown keys are ignored together with their value.
+        m_skip_next = m_field == Field::None;
+        return true;
+    }
+
+    bool end_object() {
+        if (m_skip_depth) {
+            m_skip_depth--;
+            return true;
+        }
+        auto scope = m_scopes.back();
+        m_scopes.pop_back();
+        m_field = Field::None;
+        if (scope == Scope::Header && !(m_has_size && m_has_item_size))
+            return fail(RKCfgLoadErrorCode::JsonParseError);
+        if (scope == Scope::Root && !m_has_header) return fail(RKCfgLoadErrorCode::JsonParseError);
+        if (scope == Scope::Header) m_has_header = true;
+        return true;
+    }
+
+    bool start_array(size_t) {
+        if (skipContainer()) return true;
+        if (m_scopes.back() == Scope::Root && m_field == Field::Items) {
+            m_scopes.push_back(Scope::Items);
+            return true;
+        }
+        return fail(RKCfgLoadErrorCode::JsonParseError);
+    }
+
+    bool end_array() {
+        if (m_skip_depth) {
+            m_skip_depth--;
+            return true;
+        }
+        m_scopes.pop_back();
+        m_field = Field::None;
+        return true;
+    }
+
+    bool parse_error(size_t position, const std::string&, const nlohmann::detail::exception& ex) {
+        spdlog::debug("{}", ex.what());
+        m_error_position = position;
+        m_error          = make_rkcfg_load_error(RKCfgLoadErrorCode::JsonParseError);
+        return false;
+    }
+
+    std::error_code error() const { return m_error; }
+
+    // Number of characters read when the error was detected.
+    size_t errorPosition() const { return m_error_position; }
+
+private:
+    // Document is the level above the root object, any value found there is an error.
+    enum class Scope { Document, Root, Header, Items, Item };
+    enum class Field { None, Header, Items, Size, ItemSize, Name, ImagePath, Address, IsSelected };
+
+    // Returns true if the value belongs to an ignored key.
+    bool skipValue() {
+        if (m_skip_depth) return true;
+        if (m_skip_next) {
+            m_skip_next = false;
+            return true;
+        }
+        return false;
+    }
+
+    bool skipContainer() {
+        if (m_skip_depth) {
+            m_skip_depth++;
+            return true;
+        }
+        if (m_skip_next) {
+            m_skip_next  = false;
+            m_skip_depth = 1;
+            return true;
+        }
+        return false;
+    }
+
+    // Any value other than the expected number makes the header unsupported, like a failed comparison would.
+    bool checkHeader(bool matches) {
+        if (m_scopes.back() != Scope::Header || matches) return true;
+        return fail(
+            m_field == Field::Size ? RKCfgLoadErrorCode::UnsupportedHeaderSize : RKCfgLoadErrorCode::UnsupportedItemSize
+        );
+    }
+
+    bool number(uint64_t value, double exact) {
+        switch (m_scopes.back()) {
+        case Scope::Header:
+            if (m_field == Field::Size) {
+                m_has_size = true;
+                return checkHeader(exact == RKCfgHeader::RK_V286_HEADER_SIZE);
+            }
+            m_has_item_size = true;
+            return checkHeader(exact == RKCfgHeader::RK_V286_ITEM_SIZE);
+        case Scope::Item:
+            if (m_field == Field::Address) {
+                m_items.back().address = static_cast<uint32_t>(value);
+                return true;
+            }
+            if (m_field == Field::IsSelected) {
+                m_items.back().is_selected = static_cast<uint8_t>(value);
+                return true;
+            }
+            return fail(RKCfgLoadErrorCode::JsonParseError);
+        default:
+            return fail(RKCfgLoadErrorCode::JsonParseError);
+        }
+    }
+
+    bool fail(RKCfgLoadErrorCode code) {
+        m_error          = make_rkcfg_load_error(code);
+        m_error_position = m_furthest - m_begin;
+        return false;
+    }
+
+    std::vector<RKCfgItem>& m_items;
+    const char*             m_begin;
+    const char*&            m_furthest;
+    std::vector<Scope>      m_scopes;
+    Field                   m_field{};
+    bool                    m_skip_next{};
+    size_t                  m_skip_depth{};
+    bool                    m_has_header{};
+    bool                    m_has_size{};
+    bool                    m_has_item_size{};
+    std::error_code         m_error;
+    size_t                  m_error_position{};
+};
+
+} // namespace
+
+bool RKJsonReader::read(
+    std::string_view        json,
+    std::vector<RKCfgItem>& items,
+    std::error_code&        ec,
+    RKErrorLocation&        location
+) {
+    const char* furthest = json.data();
+    Handler     handler(items, json.data(), furthest);
+    TrackingIterator first{json.data(), &furthest};
+    TrackingIterator last{json.data() + json.size(), &furthest};
+    if (json::sax_parse(first, last, &handler)) return true;
+    ec = handler.error();
+    // Point at the last character read (the parser stops right after the offending token).
+    location.offset = std::min(handler.errorPosition() ? handler.errorPosition() - 1 : 0, json.size());
+    auto consumed   = json.substr(0, location.offset);
+    location.line   = std::count(consumed.begin(), consumed.end(), '\n') + 1;
+    auto line_begin = consumed.rfind('\n');
+    location.column = line_begin == std::string_view::npos ? location.offset + 1 : location.offset - line_begin;
+    return false;
+}
+
+} // namespace rockchip
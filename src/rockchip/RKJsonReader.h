@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "RKError.h"
+#include "RKPreDefines.h"
+
+namespace rockchip {
+
+// Event-driven (SAX) reader for the json written by RKJsonWriter. Items are decoded straight into RKCfgItem as
+// the tokens arrive (names and paths directly into the fixed UTF-16 arrays), no json DOM is built.
+class RKJsonReader {
+public:
+    // Validates the header against the v2.86 layout and appends the items. On failure ec is set to an
+    // RKCfgLoadErrorCode and location points at the last character read before the error was detected.
+    static bool
+    read(std::string_view json, std::vector<RKCfgItem>& items, std::error_code& ec, RKErrorLocation& location);
+};
+
+} // namespace rockchip
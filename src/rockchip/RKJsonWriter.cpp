@@ -0,0 +1,122 @@
+#include "RKJsonWriter.h"
+
+#include "util/String.h"
+
+namespace rockchip {
+
+namespace {
+
+// Hand the buffer to the sink once it holds this much, so memory use does not grow with the number of items.
+constexpr size_t flush_threshold = 64 * 1024;
+
+} // namespace
+
+RKJsonWriter::RKJsonWriter(Sink sink, bool pretty) : m_sink(std::move(sink)), m_pretty(pretty) {}
+
+void RKJsonWriter::write(const RKCfgHeader& header, std::span<const RKCfgItem> items) {
+    auto out = std::back_inserter(m_buffer);
+    // Keys are written in the (sorted) order nlohmann::json uses.
+    m_buffer.push_back('{');
+    writeKey(1, "header");
+    m_buffer.push_back('{');
+    writeKey(2, "item_size");
+    fmt::format_to(out, "{}", header.item_size);
+    m_buffer.push_back(',');
+    writeKey(2, "size");
+    fmt::format_to(out, "{}", header.begin);
+    writeNewLine(1);
+    m_buffer.push_back('}');
+    // toJson() only creates "items" when there is at least one.
+    if (!items.empty()) {
+        m_buffer.push_back(',');
+        writeKey(1, "items");
+        m_buffer.push_back('[');
+        char name_buffer[RKCfgItem::RK_V286_MAX_NAME_SIZE * 3];
+        char image_path_buffer[RKCfgItem::RK_V286_MAX_PATH_SIZE * 3];
+        for (size_t idx = 0; idx < items.size(); idx++) {
+            auto& item = items[idx];
+            if (idx) m_buffer.push_back(',');
+            writeNewLine(2);
+            m_buffer.push_back('{');
+            writeKey(3, "address");
+            fmt::format_to(out, "{}", item.address);
+            m_buffer.push_back(',');
+            writeKey(3, "image_path");
+            writeString(
+                util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE, image_path_buffer)
+            );
+            m_buffer.push_back(',');
+            writeKey(3, "is_selected");
+            fmt::format_to(out, "{}", item.is_selected ? "true" : "false");
+            m_buffer.push_back(',');
+            writeKey(3, "name");
+            writeString(util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE, name_buffer));
+            writeNewLine(2);
+            m_buffer.push_back('}');
+            flushIfFull();
+        }
+        writeNewLine(1);
+        m_buffer.push_back(']');
+    }
+    writeNewLine(0);
+    m_buffer.push_back('}');
+    m_sink({m_buffer.data(), m_buffer.size()});
+    m_buffer.clear();
+}
+
+void RKJsonWriter::writeString(std::string_view str) { writeString(str, m_buffer); }
+
+void RKJsonWriter::writeString(std::string_view str, fmt::memory_buffer& out) {
+    out.push_back('"');
+    for (auto chr : str) {
+        switch (chr) {
+        case '"':
+            out.append(std::string_view("\\\""));
+            break;
+        case '\\':
+            out.append(std::string_view("\\\\"));
+            break;
+        case '\b':
+            out.append(std::string_view("\\b"));
+            break;
+        case '\f':
+            out.append(std::string_view("\\f"));
+            break;
+        case '\n':
+            out.append(std::string_view("\\n"));
+            break;
+        case '\r':
+            out.append(std::string_view("\\r"));
+            break;
+        case '\t':
+            out.append(std::string_view("\\t"));
+            break;
+        default:
+            if ((unsigned char)chr < 0x20) fmt::format_to(std::back_inserter(out), "\\u{:04x}", (int)chr);
+            else out.push_back(chr);
+            break;
+        }
+    }
+    out.push_back('"');
+}
+
+void RKJsonWriter::writeKey(int depth, std::string_view key) {
+    writeNewLine(depth);
+    m_buffer.push_back('"');
+    m_buffer.append(key);
+    m_buffer.append(std::string_view(m_pretty ? "\": " : "\":"));
+}
+
+void RKJsonWriter::writeNewLine(int depth) {
+    if (!m_pretty) return;
+    m_buffer.push_back('\n');
+    for (int idx = 0; idx < depth * 4; idx++) m_buffer.push_back(' ');
+}
+
+void RKJsonWriter::flushIfFull() {
+    if (m_buffer.size() < flush_threshold) return;
+    m_sink({m_buffer.data(), m_buffer.size()});
+    m_buffer.clear();
+}
+
+} // namespace rockchip
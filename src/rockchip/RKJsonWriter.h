@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <string_view>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "RKPreDefines.h"
+
+namespace rockchip {
+
+// Serializes a cfg straight into a fixed-size buffer that is handed to a sink whenever it fills up, without
+// building a json DOM. The output is byte-identical to RKCfgFile::toJson().dump(4) (pretty) or dump() (compact).
+class RKJsonWriter {
+public:
+    using Sink = std::function<void(std::string_view)>;
+
+    RKJsonWriter(Sink sink, bool pretty);
+
+    void write(const RKCfgHeader& header, std::span<const RKCfgItem> items);
+
+    // Appends str as a quoted json string, escaped as nlohmann::json does.
+    static void writeString(std::string_view str, fmt::memory_buffer& out);
+
+private:
+    void writeString(std::string_view str);
+    void writeKey(int depth, std::string_view key);
+    void writeNewLine(int depth);
+    void flushIfFull();
+
+    Sink               m_sink;
+    bool               m_pretty;
+    fmt::memory_buffer m_buffer;
+};
+
+} // namespace rockchip
@@ -0,0 +1,193 @@
+#include "RKLayoutCheck.h"
+#include "RKCfg.h"
+#include "RKUpdateImage.h"
+
+#include "util/MappedFile.h"
+#include "util/Profile.h"
+#include "util/String.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <unordered_map>
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+namespace {
+
+constexpr uint64_t sector_size = 512;
+
+// Past the last sector of the partition, the end of the device for the growing one.
+uint64_t end_of(const RKMtdPart& part) { return part.size ? uint64_t(part.address) + *part.size : UINT64_MAX; }
+
+std::string describe_end(uint64_t end) {
+    return end == UINT64_MAX ? "the end of the device" : fmt::format("{:#010x}", end);
+}
+
+} // namespace
+
+std::vector<RKLayoutCheck::Diagnostic>
+RKLayoutCheck::check(std::span<const RKMtdPart> parts, const ImageSizeOf& image_size_of, const Options& options) {
+    std::vector<Diagnostic> result;
+    auto add = [&](Severity severity, Code code, const RKMtdPart& part, const RKMtdPart* other, std::string message) {
+        auto other_name = other ? std::string(other->name) : std::string();
+        result.push_back({severity, code, std::string(part.name), std::move(other_name), std::move(message)});
+    };
+
+    // Addresses start over on every device, which are kept in the order they are defined in.
+    std::unordered_map<std::string_view, size_t> device_indexes;
+    std::vector<size_t>                          device_of(parts.size());
+    for (size_t idx = 0; idx < parts.size(); idx++)
+        device_of[idx] = device_indexes.try_emplace(parts[idx].device, device_indexes.size()).first->second;
+
+    std::vector<size_t> order(parts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        if (device_of[lhs] != device_of[rhs]) return device_of[lhs] < device_of[rhs];
+        return parts[lhs].address < parts[rhs].address;
+    });
+
+    // The partition of the device reaching furthest so far: anything starting before its end overlaps it, anything
+    // starting after leaves the sectors between unused.
+    const RKMtdPart* last{};
+    uint64_t         end{};
+    for (auto idx : order) {
+        const auto& part = parts[idx];
+        if (last && last->device != part.device) last = nullptr;
+        if (options.alignment > 1 && part.address % options.alignment != 0) {
+            auto message = fmt::format(
+                "address {:#010x} is not a multiple of {:#x} sectors",
+                part.address,
+                options.alignment
+            );
+            add(Error, Misaligned, part, nullptr, std::move(message));
+        }
+        if (last && part.address < end) {
+            auto message = fmt::format(
+                "starts at {:#010x}, before {} ends at {}",
+                part.address,
+                last->name,
+                describe_end(end)
+            );
+            add(Error, Overlap, part, last, std::move(message));
+        } else if (last && part.address > end) {
+            auto message = fmt::format("{:#x} sectors unused after {}", part.address - end, last->name);
+            add(Warning, Gap, part, last, std::move(message));
+        }
+        if (!last || end_of(part) > end) {
+            last = &part;
+            end  = end_of(part);
+        }
+
+        if (!part.size) continue;
+        auto image_size = image_size_of(part);
+        if (image_size && *image_size > *part.size * sector_size) {
+            auto message = fmt::format(
+                "image of {} bytes does not fit in {:#x} sectors ({} bytes)",
+                *image_size,
+                *part.size,
+                *part.size * sector_size
+            );
+            add(Error, ImageTooLarge, part, nullptr, std::move(message));
+        }
+    }
+    return result;
+}
+
+std::optional<std::vector<RKLayoutCheck::Diagnostic>> RKLayoutCheck::checkParameter(
+    const std::string&         parameter_path,
+    const std::string&         cfg_path,
+    std::span<const RKCfgItem> items,
+    const Options&             options,
+    std::error_code&           ec,
+    RKErrorLocation&           location
+) {
+    util::profile::count(util::profile::Counter::FsCalls);
+    std::error_code map_ec;
+    auto            mapping = util::MappedFile::open(parameter_path, map_ec);
+    if (!mapping) {
+        spdlog::debug("Unable to map {}: {}", parameter_path, map_ec.message());
+        ec = make_rkcfg_layout_check_error(RKLayoutCheckErrorCode::UnableToOpenParameter);
+        return {};
+    }
+    std::vector<RKMtdPart> parts;
+    {
+        util::profile::ScopedTimer phase(util::profile::Phase::ParameterParse);
+        std::string_view           text(reinterpret_cast<const char*>(mapping->data()), mapping->size());
+        if (!RKParameterParser::parse(text, nullptr, parts, ec, location)) return {};
+    }
+
+    // First item of each name, as the images are resolved once per partition.
+    std::unordered_map<std::string, const RKCfgItem*> items_by_name;
+    for (const auto& item : items)
+        items_by_name.try_emplace(util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE), &item);
+
+    return check(
+        parts,
+        [&](const RKMtdPart& part) -> std::optional<uint64_t> {
+            auto it = items_by_name.find(std::string(part.name));
+            if (it == items_by_name.end() || !it->second->image_path[0]) return {};
+            util::profile::count(util::profile::Counter::FsCalls);
+            auto            path = RKCfgFile::resolveImagePath(cfg_path, *it->second);
+            std::error_code size_ec;
+            auto            size = std::filesystem::file_size(path, size_ec);
+            if (size_ec) return {};
+            return size;
+        },
+        options
+    );
+}
+
+std::optional<std::vector<RKLayoutCheck::Diagnostic>> RKLayoutCheck::checkUpdateImage(
+    const RKUpdateImage& image,
+    const Options&       options,
+    std::error_code&     ec,
+    RKErrorLocation&     location
+) {
+    std::vector<RKMtdPart> parts;
+    {
+        util::profile::ScopedTimer phase(util::profile::Phase::ParameterParse);
+        if (!RKParameterParser::parse(image.getParameter(), nullptr, parts, ec, location)) return {};
+    }
+    return check(
+        parts,
+        [&](const RKMtdPart& part) -> std::optional<uint64_t> {
+            auto entry = image.findPart(part.name);
+            if (!entry) return {};
+            return entry->size;
+        },
+        options
+    );
+}
+
+std::optional<std::string>
+RKLayoutCheck::findParameter(const std::string& cfg_path, std::span<const RKCfgItem> items, std::error_code& ec) {
+    for (const auto& item : items) {
+        auto name = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+        if (util::string::equals_ignore_case(name, "parameter") && item.image_path[0])
+            return RKCfgFile::resolveImagePath(cfg_path, item);
+    }
+    ec = make_rkcfg_layout_check_error(RKLayoutCheckErrorCode::NoParameterItem);
+    return {};
+}
+
+std::string_view RKLayoutCheck::severityName(Severity severity) { return severity == Error ? "error" : "warning"; }
+
+std::string_view RKLayoutCheck::codeName(Code code) {
+    switch (code) {
+    case Overlap:
+        return "overlap";
+    case Gap:
+        return "gap";
+    case Misaligned:
+        return "misaligned";
+    case ImageTooLarge:
+        return "image_too_large";
+    }
+    return {};
+}
+
+} // namespace rockchip
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "RKError.h"
+#include "RKParameter.h"
+#include "RKPreDefines.h"
+
+namespace rockchip {
+
+class RKUpdateImage;
+
+// Checks of the partition layout of a parameter file, with the sizes conversions to cfg drop: partitions overlapping
+// or leaving sectors unused (found in one sweep per device over its partitions sorted by address), addresses off the
+// alignment, and images larger than their partition.
+class RKLayoutCheck {
+public:
+    enum Severity : uint8_t { Warning, Error };
+
+    enum Code : uint8_t { Overlap, Gap, Misaligned, ImageTooLarge };
+
+    struct Diagnostic {
+        Severity    severity;
+        Code        code;
+        std::string partition;
+        // The partition before it (by address, on the same device) for overlaps and gaps, empty otherwise.
+        std::string other;
+        std::string message;
+    };
+
+    struct Options {
+        // Sectors every address must be a multiple of, 0 or 1 to skip the check. 1 MiB by default.
+        uint32_t alignment = 0x800;
+    };
+
+    // Size in bytes of the image of a partition, empty if it has none (or it cannot be found).
+    using ImageSizeOf = std::function<std::optional<uint64_t>(const RKMtdPart& part)>;
+
+    // Diagnostics of parts (as parsed by RKParameterParser), sorted by device and address.
+    static std::vector<Diagnostic>
+    check(std::span<const RKMtdPart> parts, const ImageSizeOf& image_size_of, const Options& options);
+
+    // Layout of the parameter file at parameter_path, the images being those of the items of the same name, resolved
+    // against cfg_path. On failure ec is an RKLayoutCheckErrorCode or an RKConvertParamErrorCode, location pointing at
+    // the malformed mtdparts entry.
+    // TODO: Replace with: std::expected
+    static std::optional<std::vector<Diagnostic>> checkParameter(
+        const std::string&         parameter_path,
+        const std::string&         cfg_path,
+        std::span<const RKCfgItem> items,
+        const Options&             options,
+        std::error_code&           ec,
+        RKErrorLocation&           location
+    );
+
+    // Layout of the parameter file of an update image, the images being its entries.
+    // TODO: Replace with: std::expected
+    static std::optional<std::vector<Diagnostic>> checkUpdateImage(
+        const RKUpdateImage& image,
+        const Options&       options,
+        std::error_code&     ec,
+        RKErrorLocation&     location
+    );
+
+    // Parameter file of a cfg file: its "parameter" item (ignoring case), resolved against cfg_path. ec is
+    // RKLayoutCheckErrorCode::NoParameterItem if there is none.
+    // TODO: Replace with: std::expected
+    static std::optional<std::string>
+    findParameter(const std::string& cfg_path, std::span<const RKCfgItem> items, std::error_code& ec);
+
+    static std::string_view severityName(Severity severity);
+    static std::string_view codeName(Code code);
+};
+
+} // namespace rockchip
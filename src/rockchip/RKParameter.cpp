@@ -0,0 +1,157 @@
+#include "RKParameter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+namespace {
+
+constexpr std::string_view mtdparts_key = "mtdparts=";
+
+bool is_space(char chr) { return chr == ' ' || chr == '\t' || chr == '\r' || chr == '\n'; }
+
+std::string_view trim(std::string_view str) {
+    while (!str.empty() && is_space(str.front())) str.remove_prefix(1);
+    while (!str.empty() && is_space(str.back())) str.remove_suffix(1);
+    return str;
+}
+
+// Parses the whole token like strtoul(base 0): "0x" prefix is hex, a leading '0' is octal, otherwise decimal.
+std::optional<uint32_t> parse_number(std::string_view str) {
+    int base = 10;
+    if (str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        base = 16;
+        str.remove_prefix(2);
+    } else if (str.size() > 1 && str[0] == '0') {
+        base = 8;
+        str.remove_prefix(1);
+    }
+    uint32_t value{};
+    auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value, base);
+    if (str.empty() || ec != std::errc{} || end != str.data() + str.size()) return {};
+    return value;
+}
+
+// Finds "mtdparts=" at the start of a whitespace-separated token, returns the token.
+std::string_view find_mtdparts(std::string_view str) {
+    for (size_t pos = str.find(mtdparts_key); pos != std::string_view::npos; pos = str.find(mtdparts_key, pos + 1)) {
+        if (pos != 0 && !is_space(str[pos - 1])) continue;
+        auto end = std::find_if(str.begin() + pos, str.end(), is_space);
+        return str.substr(pos, end - (str.begin() + pos));
+    }
+    return {};
+}
+
+void locate(std::string_view text, size_t offset, RKErrorLocation& location) {
+    auto consumed   = text.substr(0, offset);
+    auto line_begin = consumed.rfind('\n');
+    location.offset = offset;
+    location.line   = std::count(consumed.begin(), consumed.end(), '\n') + 1;
+    location.column = line_begin == std::string_view::npos ? offset + 1 : offset - line_begin;
+}
+
+} // namespace
+
+bool RKParameterParser::parse(
+    std::string_view        text,
+    RKParameter*            headers,
+    std::vector<RKMtdPart>& parts,
+    std::error_code&        ec,
+    RKErrorLocation&        location
+) {
+    parts.clear();
+
+    // "mtdparts=rk29xxnand:0x00002000@0x00004000(uboot),...,-@0x0123a000(userdisk:grow)"
+    std::string_view mtdparts;
+    for (size_t line_begin = 0; line_begin < text.size();) {
+        auto line_end = std::min(text.find('\n', line_begin), text.size());
+        auto line     = trim(text.substr(line_begin, line_end - line_begin));
+        line_begin    = line_end + 1;
+        if (line.empty() || line.starts_with('#')) continue;
+        if (line.starts_with(mtdparts_key)) {
+            if (mtdparts.empty()) mtdparts = find_mtdparts(line);
+            continue;
+        }
+        // "KEY: value", "uuid:rootfs=..."
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        auto key   = trim(line.substr(0, colon));
+        auto value = trim(line.substr(colon + 1));
+        if (headers) (*headers)[std::string(key)] = value;
+        if (key == "CMDLINE" && mtdparts.empty()) mtdparts = find_mtdparts(value);
+    }
+    spdlog::debug("mtdparts: {}", mtdparts);
+    if (mtdparts.empty()) {
+        ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::MtdPartsNotFound);
+        return false;
+    }
+
+    auto definition = mtdparts.substr(mtdparts_key.size());
+    auto fail       = [&](size_t pos, std::string_view reason) {
+        spdlog::debug("Illegal mtdparts: {}", reason);
+        ec = make_rkcfg_convert_param_error(RKConvertParamErrorCode::IllegalMtdPartFormat);
+        locate(text, definition.data() - text.data() + pos, location);
+        return false;
+    };
+    auto token_end = [&](size_t pos) {
+        while (pos < definition.size() && std::isalnum((unsigned char)definition[pos])) pos++;
+        return pos;
+    };
+
+    size_t pos = 0;
+    // "<mtd-id>:<part>,<part>;<mtd-id>:<part>..."
+    while (pos < definition.size()) {
+        auto colon = definition.find(':', pos);
+        if (colon == std::string_view::npos) return fail(pos, "missing mtd-id.");
+        auto device = definition.substr(pos, colon - pos);
+        pos         = colon + 1;
+        // "<size|->@<address>(<name>[:<flags>])"
+        while (pos < definition.size()) {
+            RKMtdPart part;
+            part.device = device;
+            if (definition[pos] == '-') {
+                part.grow = true;
+                pos++;
+            } else {
+                auto end  = token_end(pos);
+                part.size = parse_number(definition.substr(pos, end - pos));
+                if (!part.size) return fail(pos, "invalid size.");
+                pos = end;
+            }
+            if (pos >= definition.size() || definition[pos] != '@') return fail(pos, "expected '@'.");
+            pos++;
+            auto end       = token_end(pos);
+            auto address   = parse_number(definition.substr(pos, end - pos));
+            if (!address) return fail(pos, "invalid address.");
+            part.address = *address;
+            pos          = end;
+            if (pos >= definition.size() || definition[pos] != '(') return fail(pos, "expected '('.");
+            auto right_quotation_mark_pos = definition.find(')', pos);
+            if (right_quotation_mark_pos == std::string_view::npos) return fail(pos, "missing ')'.");
+            auto name = definition.substr(pos + 1, right_quotation_mark_pos - pos - 1);
+            if (auto flags_pos = name.find(':'); flags_pos != std::string_view::npos) {
+                part.flags = name.substr(flags_pos + 1);
+                name       = name.substr(0, flags_pos);
+            }
+            part.name  = name;
+            part.grow |= part.flags == "grow";
+            // Linux style flags after the name ("ro", "lk") carry no meaning for rkcfg.
+            pos = token_end(right_quotation_mark_pos + 1);
+            parts.emplace_back(part);
+            if (pos >= definition.size()) break;
+            if (definition[pos] == ';') {
+                pos++;
+                break;
+            }
+            if (definition[pos] != ',') return fail(pos, "expected ',' or ';'.");
+            pos++;
+        }
+    }
+    return true;
+}
+
+} // namespace rockchip
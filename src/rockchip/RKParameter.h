@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "RKError.h"
+
+namespace rockchip {
+
+using RKParameter = std::unordered_map<std::string, std::string>;
+
+// One entry of mtdparts, e.g. "0x00002000@0x00004000(uboot)" or "-@0x0123a000(userdisk:grow)".
+// Views point into the parsed text. Sizes and addresses are in 512-byte sectors.
+struct RKMtdPart {
+    std::string_view        device; // mtd-id, e.g. "rk29xxnand", addresses start over on every device
+    std::string_view        name;
+    std::string_view        flags; // text after ':' inside the parentheses
+    std::optional<uint32_t> size;  // empty for '-' (grows to the end of the device)
+    uint32_t                address{};
+    bool                    grow{};
+};
+
+// Single-pass tokenizer for parameter.txt. Works on string_views over the whole text and does not allocate
+// per token; only the optional header map and the (reusable) parts vector own memory.
+class RKParameterParser {
+public:
+    // Every "KEY: value" line is stored into headers (if given), the first mtdparts definition (standalone or inside
+    // CMDLINE) is split into parts. On failure ec is an RKConvertParamErrorCode and location points at the problem.
+    static bool parse(
+        std::string_view        text,
+        RKParameter*            headers,
+        std::vector<RKMtdPart>& parts,
+        std::error_code&        ec,
+        RKErrorLocation&        location
+    );
+};
+
+} // namespace rockchip
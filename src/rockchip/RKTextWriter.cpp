@@ -0,0 +1,138 @@
+#include "RKTextWriter.h"
+#include "RKJsonWriter.h"
+
+#include "util/String.h"
+
+#include <iterator>
+
+namespace rockchip {
+
+namespace {
+
+// RFC 4180: fields holding a separator, a quote or a line break are quoted, quotes are doubled.
+void write_csv_field(std::string_view field, fmt::memory_buffer& out) {
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(field);
+        return;
+    }
+    out.push_back('"');
+    for (auto chr : field) {
+        if (chr == '"') out.push_back('"');
+        out.push_back(chr);
+    }
+    out.push_back('"');
+}
+
+// Tabs and line breaks cannot be quoted in tsv, they are escaped as in the text format of PostgreSQL.
+void write_tsv_field(std::string_view field, fmt::memory_buffer& out) {
+    for (auto chr : field) {
+        switch (chr) {
+        case '\\':
+            out.append(std::string_view("\\\\"));
+            break;
+        case '\t':
+            out.append(std::string_view("\\t"));
+            break;
+        case '\n':
+            out.append(std::string_view("\\n"));
+            break;
+        case '\r':
+            out.append(std::string_view("\\r"));
+            break;
+        default:
+            out.push_back(chr);
+            break;
+        }
+    }
+}
+
+} // namespace
+
+std::optional<RKTextWriter::Format> RKTextWriter::parseFormat(std::string_view name) {
+    if (name == "table") return Table;
+    if (name == "ndjson") return Ndjson;
+    if (name == "csv") return Csv;
+    if (name == "tsv") return Tsv;
+    return {};
+}
+
+void RKTextWriter::writeHeader(Format format, fmt::memory_buffer& out) {
+    if (format == Csv) out.append(std::string_view("source,index,selected,address,name,image_path\n"));
+    if (format == Tsv) out.append(std::string_view("source\tindex\tselected\taddress\tname\timage_path\n"));
+}
+
+void RKTextWriter::write(
+    Format                     format,
+    std::string_view           source,
+    const RKCfgHeader&         header,
+    std::span<const RKCfgItem> items,
+    fmt::memory_buffer&        out
+) {
+    auto it = std::back_inserter(out);
+    if (format == Table) {
+        fmt::format_to(
+            it,
+            "{}: {} partitions, header size {:#x}, item size {:#x}\n    {:<10} {:10} {}\n",
+            source,
+            items.size(),
+            header.begin,
+            header.item_size,
+            "Address",
+            "Name",
+            "Path"
+        );
+    }
+    char name_buffer[RKCfgItem::RK_V286_MAX_NAME_SIZE * 3];
+    char image_path_buffer[RKCfgItem::RK_V286_MAX_PATH_SIZE * 3];
+    for (size_t idx = 0; idx < items.size(); idx++) {
+        const auto& item = items[idx];
+        auto        name = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE, name_buffer);
+        auto        image_path =
+            util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE, image_path_buffer);
+        switch (format) {
+        case Table:
+            fmt::format_to(
+                it,
+                "[{}] {:#010x} {:<10} {}\n",
+                item.is_selected ? "x" : " ",
+                item.address,
+                name.empty() ? "(empty)" : name,
+                image_path.empty() ? "(empty)" : image_path
+            );
+            break;
+        case Ndjson:
+            out.append(std::string_view("{\"source\":"));
+            RKJsonWriter::writeString(source, out);
+            fmt::format_to(
+                it,
+                ",\"index\":{},\"selected\":{},\"address\":{},\"name\":",
+                idx,
+                item.is_selected ? "true" : "false",
+                item.address
+            );
+            RKJsonWriter::writeString(name, out);
+            out.append(std::string_view(",\"image_path\":"));
+            RKJsonWriter::writeString(image_path, out);
+            out.append(std::string_view("}\n"));
+            break;
+        case Csv:
+            write_csv_field(source, out);
+            fmt::format_to(it, ",{},{},{:#010x},", idx, item.is_selected ? 1 : 0, item.address);
+            write_csv_field(name, out);
+            out.push_back(',');
+            write_csv_field(image_path, out);
+            out.push_back('\n');
+            break;
+        case Tsv:
+            write_tsv_field(source, out);
+            fmt::format_to(it, "\t{}\t{}\t{:#010x}\t", idx, item.is_selected ? 1 : 0, item.address);
+            write_tsv_field(name, out);
+            out.push_back('\t');
+            write_tsv_field(image_path, out);
+            out.push_back('\n');
+            break;
+        }
+    }
+}
+
+} // namespace rockchip
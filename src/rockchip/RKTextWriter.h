@@ -0,0 +1,36 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <spdlog/fmt/fmt.h>
+
+#include "RKPreDefines.h"
+
+namespace rockchip {
+
+// Renders the items of a cfg for '--show --format' into a caller-owned buffer, which is meant to be reused from file
+// to file and written out once per file, without going through the logger. Every row carries the source file, so
+// that the rows of many files can be concatenated into one stream.
+class RKTextWriter {
+public:
+    enum Format { Table, Ndjson, Csv, Tsv };
+
+    // "table", "ndjson", "csv" or "tsv".
+    static std::optional<Format> parseFormat(std::string_view name);
+
+    // Column names for csv and tsv, nothing for the others: to be written once at the top of the stream.
+    static void writeHeader(Format format, fmt::memory_buffer& out);
+
+    // Appends one row per item (tables get a line naming the file and a header line first).
+    static void write(
+        Format                     format,
+        std::string_view           source,
+        const RKCfgHeader&         header,
+        std::span<const RKCfgItem> items,
+        fmt::memory_buffer&        out
+    );
+};
+
+} // namespace rockchip
@@ -0,0 +1,560 @@
+#include "RKUpdateImage.h"
+#include "RKCfg.h"
+#include "RKError.h"
+#include "RKParameter.h"
+
+#include "util/File.h"
+#include "util/Hash.h"
+#include "util/MappedFile.h"
+#include "util/Profile.h"
+#include "util/String.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace rockchip {
+
+namespace {
+
+using util::string::equals_ignore_case;
+
+// Copied by the kernel while the pool hashes it from the mapping: large enough to keep both busy, small enough
+// that the hashers read pages the copy just brought into the page cache.
+constexpr size_t copy_chunk_size = 32 << 20;
+
+constexpr uint32_t bootloader_nand_addr = 0xFFFFFFFF;
+
+// A piece of the package: bytes built in memory (headers, the wrapped parameter file) or an image, followed by
+// zeros up to padded_size.
+struct Segment {
+    std::vector<std::byte>          data;
+    std::optional<util::File>       file;
+    std::optional<util::MappedFile> mapping;
+    uint64_t                        offset{}; // in the output
+    uint64_t                        padded_size{};
+    bool                            in_rkaf{}; // covered by the RK CRC
+
+    std::span<const std::byte> bytes() const { return mapping ? mapping->bytes() : std::span(data); }
+};
+
+uint64_t align(uint64_t size) {
+    return (size + RKAFHeader::RK_AF_ALIGNMENT - 1) / RKAFHeader::RK_AF_ALIGNMENT * RKAFHeader::RK_AF_ALIGNMENT;
+}
+
+// Copies text into a fixed-size field, keeping a terminating NUL.
+template <size_t N>
+bool copy_field(char (&field)[N], std::string_view text) {
+    if (text.size() >= N) return false;
+    std::memcpy(field, text.data(), text.size());
+    return true;
+}
+
+// "8.1" or "8.1.12" as afptool encodes it: major << 24 | minor << 16 | build.
+uint32_t parse_version(std::string_view text) {
+    std::array<uint32_t, 3> numbers{};
+    for (auto& number : numbers) {
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+        if (error != std::errc()) break;
+        text.remove_prefix(end - text.data());
+        if (!text.starts_with('.')) break;
+        text.remove_prefix(1);
+    }
+    return (numbers[0] & 0xFF) << 24 | (numbers[1] & 0xFF) << 16 | (numbers[2] & 0xFFFF);
+}
+
+// Text of a fixed-size field, which is not terminated if full.
+template <size_t N>
+std::string_view field(const char (&text)[N]) {
+    return {text, static_cast<size_t>(std::find(text, text + N, '\0') - text)};
+}
+
+void append(std::vector<std::byte>& data, std::span<const std::byte> bytes) {
+    data.insert(data.end(), bytes.begin(), bytes.end());
+}
+
+template <typename T>
+void append(std::vector<std::byte>& data, const T& value) {
+    append(data, std::as_bytes(std::span(&value, 1)));
+}
+
+// Writes the segments in order, every chunk being written and fed to the hashers at the same time.
+class Writer {
+public:
+    Writer(util::File& output, util::ThreadPool& pool, bool with_md5) : m_output(output), m_pool(pool) {
+        if (with_md5) m_md5.emplace();
+    }
+
+    void write(const Segment& segment, std::error_code& ec) {
+        auto bytes = segment.bytes();
+        for (uint64_t position = 0; position < bytes.size(); position += copy_chunk_size) {
+            auto chunk  = bytes.subspan(position, std::min<uint64_t>(copy_chunk_size, bytes.size() - position));
+            auto offset = segment.offset + position;
+            std::error_code                      copy_ec;
+            std::array<std::function<void()>, 3> tasks{
+                [&] {
+                    if (segment.file) m_output.copyFrom(*segment.file, position, offset, chunk.size(), copy_ec);
+                    else m_output.write(offset, chunk, copy_ec);
+                },
+                [&] {
+                    if (segment.in_rkaf) m_crc.update(chunk);
+                },
+                [&] { m_md5->update(chunk); }
+            };
+            m_pool.parallelFor(m_md5 ? 3 : 2, [&](size_t idx) { tasks[idx](); });
+            if (copy_ec) {
+                ec = copy_ec;
+                return;
+            }
+        }
+        static const std::array<std::byte, RKAFHeader::RK_AF_ALIGNMENT> zeros{};
+        if (segment.padded_size > bytes.size()) {
+            auto padding = std::span(zeros).first(segment.padded_size - bytes.size());
+            hashAndWrite(segment.offset + bytes.size(), padding, segment.in_rkaf, ec);
+        }
+    }
+
+    void hashAndWrite(uint64_t offset, std::span<const std::byte> data, bool in_rkaf, std::error_code& ec) {
+        if (in_rkaf) m_crc.update(data);
+        if (m_md5) m_md5->update(data);
+        m_output.write(offset, data, ec);
+    }
+
+    uint32_t crc() const { return m_crc.value(); }
+
+    util::Md5::Digest md5() { return m_md5->finish(); }
+
+private:
+    util::File&              m_output;
+    util::ThreadPool&        m_pool;
+    util::RkCrc32            m_crc;
+    std::optional<util::Md5> m_md5;
+};
+
+// Opens an image for both the copy and the hashers.
+bool open_image(Segment& segment, const std::string& path, std::error_code& ec) {
+    segment.file = util::File::open(path, util::File::ReadOnly, ec);
+    if (segment.file) segment.mapping = util::MappedFile::open(path, ec);
+    return !ec;
+}
+
+// Sets created once output has been created (and so has to be removed on failure).
+void build(
+    const std::string&                cfg_path,
+    std::span<const RKCfgItem>        items,
+    const std::string&                output,
+    const RKUpdateImage::PackOptions& options,
+    util::ThreadPool&                 pool,
+    bool&                             created,
+    std::error_code&                  ec
+) {
+    const RKCfgItem*              parameter_item{};
+    const RKCfgItem*              loader_item{};
+    std::vector<const RKCfgItem*> packed;
+    for (const auto& item : items) {
+        if (!item.is_selected || !item.image_path[0]) continue;
+        auto name = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+        if (equals_ignore_case(name, "parameter") && !parameter_item) parameter_item = &item;
+        if (equals_ignore_case(name, "loader") && !loader_item) loader_item = &item;
+        packed.push_back(&item);
+    }
+    if (!parameter_item) {
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::ParameterNotFound);
+        return;
+    }
+    if (options.chip && !loader_item) {
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::LoaderNotFound);
+        return;
+    }
+    if (packed.size() > RKAFHeader::RK_AF_MAX_PARTS) {
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::TooManyPartitions);
+        return;
+    }
+
+    // The parameter file is both parsed and packed, wrapped as afptool does: "PARM", length, text, RK CRC.
+    auto parameter_path = RKCfgFile::resolveImagePath(cfg_path, *parameter_item);
+    auto parameter_file = util::MappedFile::open(parameter_path, ec);
+    if (!parameter_file) {
+        spdlog::error("{}: parameter file {} not found.", cfg_path, parameter_path);
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::ImageNotFound);
+        return;
+    }
+    RKParameter            headers;
+    std::vector<RKMtdPart> mtd_parts;
+    RKErrorLocation        location;
+    std::string_view       text(reinterpret_cast<const char*>(parameter_file->data()), parameter_file->size());
+    if (!RKParameterParser::parse(text, &headers, mtd_parts, ec, location)) {
+        spdlog::debug("{}: line {}, column {}", parameter_path, location.line, location.column);
+        return;
+    }
+
+    RKAFHeader rkaf;
+    auto       header_field = [&](const char* key) -> std::string_view {
+        auto it = headers.find(key);
+        return it == headers.end() ? std::string_view() : std::string_view(it->second);
+    };
+    if (!copy_field(rkaf.model, header_field("MACHINE_MODEL")) || !copy_field(rkaf.id, header_field("MACHINE_ID")) ||
+        !copy_field(rkaf.manufacturer, header_field("MANUFACTURER"))) {
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::NameTooLong);
+        return;
+    }
+    rkaf.version   = parse_version(header_field("FIRMWARE_VER"));
+    rkaf.num_parts = static_cast<uint32_t>(packed.size());
+
+    // Segments in output order: [RKFW header, loader,] RKAF header, parts.
+    std::vector<Segment> segments;
+    uint64_t             rkaf_offset{};
+    if (options.chip) {
+        auto& header  = segments.emplace_back();
+        header.offset = 0;
+        header.data.resize(RKFWHeader::RK_FW_HEADER_SIZE);
+        auto& loader  = segments.emplace_back();
+        loader.offset = RKFWHeader::RK_FW_HEADER_SIZE;
+        auto path     = RKCfgFile::resolveImagePath(cfg_path, *loader_item);
+        if (!open_image(loader, path, ec)) {
+            spdlog::error("{}: image {} not found.", cfg_path, path);
+            ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::ImageNotFound);
+            return;
+        }
+        loader.padded_size = loader.bytes().size();
+        rkaf_offset        = loader.offset + loader.padded_size;
+    }
+    auto  rkaf_header_index = segments.size();
+    auto& rkaf_header       = segments.emplace_back();
+    rkaf_header.offset      = rkaf_offset;
+    rkaf_header.in_rkaf     = true;
+
+    uint64_t position = RKAFHeader::RK_AF_HEADER_SIZE;
+    size_t   missing{};
+    for (size_t idx = 0; idx < packed.size(); idx++) {
+        const auto& item = *packed[idx];
+        auto&       part = rkaf.parts[idx];
+        auto        name = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+        auto        file = util::string::from_char16(item.image_path, RKCfgItem::RK_V286_MAX_PATH_SIZE);
+        std::replace(file.begin(), file.end(), '\\', '/');
+        if (file.size() >= sizeof(part.file)) file = "Image/" + std::filesystem::path(file).filename().string();
+        if (&item == loader_item) name = "bootloader";
+        if (&item == parameter_item) name = "parameter";
+        if (!copy_field(part.name, name) || !copy_field(part.file, file)) {
+            spdlog::error("{}: {} does not fit in the partition table.", cfg_path, name);
+            ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::NameTooLong);
+            return;
+        }
+
+        auto& segment   = segments.emplace_back();
+        segment.offset  = rkaf_offset + position;
+        segment.in_rkaf = true;
+        if (&item == parameter_item) {
+            auto          length = static_cast<uint32_t>(text.size());
+            util::RkCrc32 crc;
+            crc.update(parameter_file->bytes());
+            auto value = crc.value();
+            append(segment.data, std::as_bytes(std::span("PARM", 4)));
+            append(segment.data, length);
+            append(segment.data, parameter_file->bytes());
+            append(segment.data, value);
+        } else {
+            auto path = RKCfgFile::resolveImagePath(cfg_path, item);
+            if (!open_image(segment, path, ec)) {
+                spdlog::error("{}: image {} not found.", cfg_path, path);
+                ec.clear();
+                missing++;
+                continue;
+            }
+        }
+        segment.padded_size = align(segment.bytes().size());
+
+        part.pos         = static_cast<uint32_t>(position);
+        part.size        = static_cast<uint32_t>(segment.bytes().size());
+        part.padded_size = static_cast<uint32_t>(segment.padded_size);
+        if (&item == loader_item) {
+            part.nand_addr = bootloader_nand_addr;
+        } else {
+            part.nand_addr = item.address;
+            auto mtd_part  = std::find_if(mtd_parts.begin(), mtd_parts.end(), [&](const auto& mtd_part) {
+                return equals_ignore_case(mtd_part.name, name);
+            });
+            if (mtd_part != mtd_parts.end()) part.nand_size = mtd_part->size.value_or(0);
+        }
+        position += segment.padded_size;
+        if (position > std::numeric_limits<uint32_t>::max()) {
+            ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::PackageTooLarge);
+            return;
+        }
+    }
+    if (missing) {
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::ImageNotFound);
+        return;
+    }
+    // The trailing RK CRC (and the RKFW MD5) must fit as well.
+    auto rkaf_length = position;
+    if (rkaf_offset + rkaf_length + sizeof(uint32_t) > std::numeric_limits<uint32_t>::max()) {
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::PackageTooLarge);
+        return;
+    }
+    rkaf.length = static_cast<uint32_t>(rkaf_length);
+    append(segments[rkaf_header_index].data, rkaf);
+    segments[rkaf_header_index].padded_size = RKAFHeader::RK_AF_HEADER_SIZE;
+
+    if (options.chip) {
+        RKFWHeader                  rkfw;
+        auto                        now  = std::chrono::system_clock::now();
+        auto                        days = std::chrono::floor<std::chrono::days>(now);
+        std::chrono::year_month_day date(days);
+        std::chrono::hh_mm_ss       time(std::chrono::floor<std::chrono::seconds>(now - days));
+        rkfw.version       = rkaf.version;
+        rkfw.code          = rkaf.version;
+        rkfw.year          = static_cast<uint16_t>(static_cast<int>(date.year()));
+        rkfw.month         = static_cast<uint8_t>(static_cast<unsigned>(date.month()));
+        rkfw.day           = static_cast<uint8_t>(static_cast<unsigned>(date.day()));
+        rkfw.hour          = static_cast<uint8_t>(time.hours().count());
+        rkfw.minute        = static_cast<uint8_t>(time.minutes().count());
+        rkfw.second        = static_cast<uint8_t>(time.seconds().count());
+        rkfw.chip          = *options.chip;
+        rkfw.loader_offset = static_cast<uint32_t>(segments[1].offset);
+        rkfw.loader_length = static_cast<uint32_t>(segments[1].padded_size);
+        rkfw.image_offset  = static_cast<uint32_t>(rkaf_offset);
+        rkfw.image_length  = static_cast<uint32_t>(rkaf_length + sizeof(uint32_t));
+        std::memcpy(segments[0].data.data(), &rkfw, sizeof(rkfw));
+        segments[0].padded_size = RKFWHeader::RK_FW_HEADER_SIZE;
+    }
+
+    auto file = util::File::open(output, util::File::Create, ec);
+    if (!file) return;
+    created = true;
+    Writer writer(*file, pool, options.chip.has_value());
+    for (const auto& segment : segments) {
+        writer.write(segment, ec);
+        if (ec) return;
+    }
+    auto crc = writer.crc();
+    writer.hashAndWrite(rkaf_offset + rkaf_length, std::as_bytes(std::span(&crc, 1)), false, ec);
+    if (ec || !options.chip) return;
+    auto md5 = util::Md5::toHex(writer.md5());
+    file->write(rkaf_offset + rkaf_length + sizeof(crc), std::as_bytes(std::span(md5.data(), md5.size())), ec);
+}
+
+} // namespace
+
+void RKUpdateImage::pack(
+    const std::string&         cfg_path,
+    std::span<const RKCfgItem> items,
+    const std::string&         output,
+    const PackOptions&         options,
+    util::ThreadPool&          pool,
+    std::error_code&           ec
+) {
+    util::profile::ScopedTimer phase(util::profile::Phase::PackUpdate);
+    bool created{};
+    build(cfg_path, items, output, options, pool, created, ec);
+    if (!ec) return;
+    if (ec.category() == std::system_category()) {
+        spdlog::debug("Unable to write {}: {}", output, ec.message());
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::UnableToWriteFile);
+    }
+    std::error_code remove_ec;
+    if (created) std::filesystem::remove(output, remove_ec);
+}
+
+std::optional<RKUpdateImage> RKUpdateImage::open(const std::string& path, std::error_code& ec) {
+    std::error_code map_ec;
+    auto            mapping = util::MappedFile::open(path, map_ec);
+    if (!mapping) {
+        spdlog::debug("Unable to map {}: {}", path, map_ec.message());
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::UnableToOpenFile);
+        return {};
+    }
+    auto malformed = [&](std::string_view reason) -> std::optional<RKUpdateImage> {
+        spdlog::debug("{}: {}", path, reason);
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::MalformedImage);
+        return {};
+    };
+
+    RKUpdateImage result;
+    auto          bytes = mapping->bytes();
+    auto          size  = bytes.size();
+    if (size >= RKFWHeader::RK_FW_HEADER_SIZE && !std::memcmp(bytes.data(), "RKFW", 4)) {
+        RKFWHeader rkfw;
+        std::memcpy(&rkfw, bytes.data(), sizeof(rkfw));
+        if (uint64_t(rkfw.image_offset) + rkfw.image_length > size) return malformed("RKAF package out of bounds");
+        result.m_rkaf_offset = rkfw.image_offset;
+        size                 = rkfw.image_length;
+    }
+    if (size < RKAFHeader::RK_AF_HEADER_SIZE || std::memcmp(bytes.data() + result.m_rkaf_offset, "RKAF", 4))
+        return malformed("no RKAF header");
+    auto header = reinterpret_cast<const RKAFHeader*>(bytes.data() + result.m_rkaf_offset);
+    if (header->length > size) return malformed("RKAF length out of bounds");
+    if (header->num_parts > RKAFHeader::RK_AF_MAX_PARTS) return malformed("too many parts");
+    for (uint32_t idx = 0; idx < header->num_parts; idx++) {
+        const auto& part = header->parts[idx];
+        if (uint64_t(part.pos) + part.size > header->length) return malformed(field(part.name));
+    }
+    result.m_path    = path;
+    result.m_mapping = std::move(*mapping);
+    result.m_header  = header;
+
+    auto parameter = result.findPart("parameter");
+    if (!parameter) {
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::NoParameterEntry);
+        return {};
+    }
+    auto     contents = bytes.subspan(result.m_rkaf_offset + parameter->pos, parameter->size);
+    uint32_t length{};
+    uint32_t crc{};
+    if (contents.size() >= 12) std::memcpy(&length, contents.data() + 4, sizeof(length));
+    if (contents.size() < 12 || std::memcmp(contents.data(), "PARM", 4) || length > contents.size() - 12) {
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::NoParameterEntry);
+        return {};
+    }
+    std::memcpy(&crc, contents.data() + 8 + length, sizeof(crc));
+    util::RkCrc32 actual;
+    actual.update(contents.subspan(8, length));
+    if (actual.value() != crc) {
+        spdlog::debug("{}: parameter CRC {:08x}, expected {:08x}", path, actual.value(), crc);
+        ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::NoParameterEntry);
+        return {};
+    }
+    result.m_parameter = {reinterpret_cast<const char*>(contents.data()) + 8, length};
+    return result;
+}
+
+RKAFHeader const& RKUpdateImage::getHeader() const { return *m_header; }
+
+const RKAFPart* RKUpdateImage::findPart(std::string_view item_name) const {
+    if (equals_ignore_case(item_name, "loader")) item_name = "bootloader";
+    for (uint32_t idx = 0; idx < m_header->num_parts; idx++) {
+        if (equals_ignore_case(field(m_header->parts[idx].name), item_name)) return &m_header->parts[idx];
+    }
+    return nullptr;
+}
+
+std::span<const std::byte> RKUpdateImage::getContents(const RKAFPart& part) const {
+    if (equals_ignore_case(field(part.name), "parameter")) return std::as_bytes(std::span(m_parameter));
+    return m_mapping.bytes().subspan(m_rkaf_offset + part.pos, part.size);
+}
+
+std::string_view RKUpdateImage::getParameter() const { return m_parameter; }
+
+size_t RKUpdateImage::extract(
+    const std::string&         cfg_path,
+    std::span<const RKCfgItem> items,
+    util::ThreadPool&          pool,
+    std::error_code&           ec
+) const {
+    util::profile::ScopedTimer phase(util::profile::Phase::Extract);
+    std::error_code            stat_ec;
+    auto                       package_mtime = std::filesystem::last_write_time(m_path, stat_ec);
+
+    struct Extraction {
+        const RKAFPart* part;
+        std::string     path;
+        std::error_code ec;
+    };
+    std::vector<Extraction> extractions;
+    for (const auto& item : items) {
+        if (!item.is_selected || !item.image_path[0]) continue;
+        auto name = util::string::from_char16(item.name, RKCfgItem::RK_V286_MAX_NAME_SIZE);
+        auto part = findPart(name);
+        if (!part) continue;
+        auto path = RKCfgFile::resolveImagePath(cfg_path, item);
+        auto size = getContents(*part).size();
+        util::profile::count(util::profile::Counter::FsCalls);
+        std::error_code exists_ec;
+        if (std::filesystem::file_size(path, exists_ec) == size && !exists_ec && !stat_ec &&
+            std::filesystem::last_write_time(path, exists_ec) >= package_mtime && !exists_ec) {
+            spdlog::debug("{} is up to date.", path);
+            continue;
+        }
+        extractions.push_back({part, std::move(path), {}});
+    }
+    if (extractions.empty()) return 0;
+
+    auto package = util::File::open(m_path, util::File::ReadOnly, ec);
+    if (!package) return 0;
+    pool.parallelFor(extractions.size(), [&](size_t idx) {
+        auto& extraction = extractions[idx];
+        auto  temp_path  = extraction.path + ".tmp";
+        auto  parent     = std::filesystem::path(extraction.path).parent_path();
+        if (!parent.empty()) std::filesystem::create_directories(parent, extraction.ec);
+        if (extraction.ec) return;
+        {
+            auto file = util::File::open(temp_path, util::File::Create, extraction.ec);
+            if (!file) return;
+            // The parameter entry is unwrapped, the others are copied as they are.
+            if (equals_ignore_case(field(extraction.part->name), "parameter")) {
+                file->write(0, std::as_bytes(std::span(m_parameter)), extraction.ec);
+            } else {
+                auto offset = m_rkaf_offset + extraction.part->pos;
+                file->copyFrom(*package, offset, 0, extraction.part->size, extraction.ec);
+            }
+        }
+        if (!extraction.ec) std::filesystem::rename(temp_path, extraction.path, extraction.ec);
+        if (extraction.ec) {
+            std::error_code remove_ec;
+            std::filesystem::remove(temp_path, remove_ec);
+        }
+    });
+
+    size_t extracted{};
+    for (const auto& extraction : extractions) {
+        if (extraction.ec) {
+            spdlog::error("Unable to extract {}: {}", extraction.path, extraction.ec.message());
+            ec = make_rkcfg_update_image_error(RKUpdateImageErrorCode::UnableToExtract);
+            continue;
+        }
+        spdlog::info("Extracted {} to {}.", field(extraction.part->name), extraction.path);
+        extracted++;
+    }
+    return extracted;
+}
+
+std::optional<RKCfgFile>
+RKCfgFile::fromUpdateImage(const std::string& path, const std::string& extract_dir, std::error_code& ec) {
+    RKErrorLocation location;
+    return fromUpdateImage(path, extract_dir, ec, location);
+}
+
+std::optional<RKCfgFile> RKCfgFile::fromUpdateImage(
+    const std::string& path,
+    const std::string& extract_dir,
+    std::error_code&   ec,
+    RKErrorLocation&   location
+) {
+    util::profile::ScopedTimer timer(util::profile::Phase::FromUpdateImage);
+    auto                       image = RKUpdateImage::open(path, ec);
+    if (!image) return {};
+    // Part names are views into the mapping, which outlives the conversion.
+    std::vector<RKMtdPart> parts;
+    {
+        util::profile::ScopedTimer phase(util::profile::Phase::ParameterParse);
+        if (!RKParameterParser::parse(image->getParameter(), nullptr, parts, ec, location)) return {};
+    }
+    util::profile::ScopedTimer phase(util::profile::Phase::ItemBuild);
+    return fromMtdParts(
+        parts,
+        [&](size_t idx) -> std::string {
+            std::string_view name;
+            if (idx == loader_index) name = "Loader";
+            else if (idx == parameter_index) name = "parameter";
+            else name = parts[idx - mtd_parts_index].name;
+            auto part = image->findPart(name);
+            if (!part) return {};
+            std::string file(field(part->file));
+            if (file.empty()) file = std::string(field(part->name)) + ".img";
+            if (extract_dir.empty()) return file;
+            std::replace(file.begin(), file.end(), '\\', '/');
+            return (std::filesystem::path(extract_dir) / std::filesystem::path(file).filename()).generic_string();
+        },
+        ec
+    );
+}
+
+} // namespace rockchip
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "RKPreDefines.h"
+
+#include "util/MappedFile.h"
+#include "util/ThreadPool.h"
+
+// From: afptool and rkImageMaker (rkbin)
+//     * RKAF: partition table followed by the partition images, then the RK CRC-32 of all of it
+//     * RKFW: RKFW header, loader, RKAF package, then the MD5 of all of it as 32 hex characters
+
+#pragma pack(push, 1)
+
+namespace rockchip {
+
+struct RKFWHeader {
+    char     magic[4] = {'R', 'K', 'F', 'W'};
+    uint16_t head_len = RK_FW_HEADER_SIZE;
+    uint32_t version;
+    uint32_t code;
+    uint16_t year;
+    uint8_t  month;
+    uint8_t  day;
+    uint8_t  hour;
+    uint8_t  minute;
+    uint8_t  second;
+    uint32_t chip;
+    uint32_t loader_offset;
+    uint32_t loader_length;
+    uint32_t image_offset;
+    uint32_t image_length;
+    uint32_t unknown_1;
+    uint32_t unknown_2;
+    uint32_t system_fstype;
+    uint32_t backup_endpos;
+    char     reserved[0x2D];
+    // external
+    static const size_t RK_FW_HEADER_SIZE;
+    // auto zero-initializer
+    RKFWHeader()
+        : version{}, code{}, year{}, month{}, day{}, hour{}, minute{}, second{}, chip{}, loader_offset{},
+          loader_length{}, image_offset{}, image_length{}, unknown_1{}, unknown_2{}, system_fstype{},
+          backup_endpos{}, reserved{} {}
+};
+
+static_assert(sizeof(RKFWHeader) == 0x66);
+
+static_assert(offsetof(RKFWHeader, version) == 6);
+static_assert(offsetof(RKFWHeader, chip) == 21);
+static_assert(offsetof(RKFWHeader, loader_offset) == 25);
+static_assert(offsetof(RKFWHeader, image_length) == 37);
+
+struct RKAFPart {
+    char     name[32];
+    char     file[60];
+    uint32_t nand_size; // sectors, 0 for the partition growing to the end of the device
+    uint32_t pos;       // offset in the RKAF package
+    uint32_t nand_addr; // sectors, 0xFFFFFFFF for the bootloader
+    uint32_t padded_size;
+    uint32_t size;
+    // auto zero-initializer
+    RKAFPart() : name{}, file{}, nand_size{}, pos{}, nand_addr{}, padded_size{}, size{} {}
+};
+
+static_assert(sizeof(RKAFPart) == 112);
+
+struct RKAFHeader {
+    char     magic[4] = {'R', 'K', 'A', 'F'};
+    uint32_t length; // of the package, the trailing CRC excluded
+    char     model[34];
+    char     id[30];
+    char     manufacturer[56];
+    uint32_t unknown;
+    uint32_t version;
+    uint32_t num_parts;
+    RKAFPart parts[16];
+    char     reserved[116];
+    // external
+    static const size_t   RK_AF_HEADER_SIZE;
+    static const size_t   RK_AF_MAX_PARTS;
+    static const uint32_t RK_AF_ALIGNMENT;
+    // auto zero-initializer
+    RKAFHeader() : length{}, model{}, id{}, manufacturer{}, unknown{}, version{}, num_parts{}, parts{}, reserved{} {}
+};
+
+static_assert(sizeof(RKAFHeader) == 2048);
+
+static_assert(offsetof(RKAFHeader, model) == 8);
+static_assert(offsetof(RKAFHeader, version) == 132);
+static_assert(offsetof(RKAFHeader, parts) == 140);
+
+inline const size_t RKFWHeader::RK_FW_HEADER_SIZE = sizeof(RKFWHeader);
+
+inline const size_t   RKAFHeader::RK_AF_HEADER_SIZE = sizeof(RKAFHeader);
+inline const size_t   RKAFHeader::RK_AF_MAX_PARTS   = sizeof(RKAFHeader::parts) / sizeof(RKAFPart);
+inline const uint32_t RKAFHeader::RK_AF_ALIGNMENT   = 2048;
+
+} // namespace rockchip
+
+#pragma pack(pop)
+
+namespace rockchip {
+
+// Update images, the packages flashed by RKDevTool's "Upgrade Firmware" tab: built from cfg files, or mapped to
+// read their partition table and entries in place.
+class RKUpdateImage {
+public:
+    // Maps an RKFW or RKAF package and checks that its partition table and parameter entry fit in the file. The
+    // checksums are not verified, which would read the whole package.
+    // TODO: Replace with: std::expected
+    static std::optional<RKUpdateImage> open(const std::string& path, std::error_code& ec);
+
+    struct PackOptions {
+        // Wraps the RKAF package into an RKFW one for this chip (rkImageMaker's chip code), which requires a
+        // selected Loader item.
+        std::optional<uint32_t> chip;
+    };
+
+    // Packs the selected items with an image into output: the parameter item (required) as the "parameter"
+    // partition, the Loader item as "bootloader", the others under their own name. Model, id, manufacturer and
+    // firmware version come from the parameter file, partition sizes from its mtdparts. The images are copied by
+    // the kernel where possible while their checksums are computed on the pool from their mapping, chunk by chunk,
+    // so that every image is read once. The output is removed on failure.
+    static void pack(
+        const std::string&         cfg_path,
+        std::span<const RKCfgItem> items,
+        const std::string&         output,
+        const PackOptions&         options,
+        util::ThreadPool&          pool,
+        std::error_code&           ec
+    );
+
+    RKAFHeader const& getHeader() const;
+
+    // Entry of a cfg item by name, ignoring case, the Loader item being the "bootloader" entry.
+    const RKAFPart* findPart(std::string_view item_name) const;
+
+    // Contents of an entry, the parameter one unwrapped.
+    std::span<const std::byte> getContents(const RKAFPart& part) const;
+
+    std::string_view getParameter() const;
+
+    // Extracts the images of the selected items of a cfg made by RKCfgFile::fromUpdateImage, resolved against the
+    // directory of cfg_path. Lazy: images already there with the size of their entry, and not older than the
+    // package, are kept. Entries are copied by the kernel where possible, several at a time on the pool, into a
+    // temporary file renamed over the image. Returns the number of images written.
+    size_t extract(
+        const std::string&         cfg_path,
+        std::span<const RKCfgItem> items,
+        util::ThreadPool&          pool,
+        std::error_code&           ec
+    ) const;
+
+private:
+    std::string      m_path;
+    util::MappedFile m_mapping;
+    uint64_t         m_rkaf_offset{};
+    // Point into the mapping, which does not move with the object.
+    const RKAFHeader* m_header{};
+    std::string_view  m_parameter;
+};
+
+} // namespace rockchip
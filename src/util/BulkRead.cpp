@@ -0,0 +1,380 @@
+#include "BulkRead.h"
+#include "File.h"
+#include "Profile.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef __linux__
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+
+namespace {
+
+void read_files_blocking(std::span<const std::string> paths, ThreadPool& pool, const ReadCallback& done) {
+    pool.parallelFor(paths.size(), [&](size_t idx) {
+        std::error_code        ec;
+        std::vector<std::byte> data;
+        if (auto file = File::open(paths[idx], File::ReadOnly, ec)) {
+            auto size = std::filesystem::file_size(paths[idx], ec);
+            if (!ec) {
+                data.resize(size);
+                data.resize(file->read(0, data, ec));
+            }
+        }
+        if (ec) data.clear();
+        done(idx, std::move(data), ec);
+    });
+}
+
+#ifdef __linux__
+
+// Files in flight, and submission queue entries: up to three requests per file (the close of the previous file of
+// its slot, and the open and statx of the next one).
+constexpr unsigned window_size = 128;
+constexpr unsigned ring_size   = 4 * window_size;
+
+// user_data of a request: the slot, shifted, and the operation.
+enum Operation : uint8_t { Open, Stat, Read, Close, Cancel };
+
+constexpr uint8_t opcodes[] = {
+    IORING_OP_OPENAT,
+    IORING_OP_STATX,
+    IORING_OP_READ,
+    IORING_OP_CLOSE,
+    IORING_OP_ASYNC_CANCEL,
+};
+
+constexpr uint64_t tag(size_t slot, Operation op) { return (uint64_t(slot) << 8) | op; }
+
+// The subset of liburing needed here, on the raw system calls (no SQPOLL, no registered files or buffers).
+class Ring {
+public:
+    explicit Ring(unsigned entries) {
+        io_uring_params params{};
+        m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0) return;
+        if (!map(params) || !probe()) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    ~Ring() {
+        if (m_sqes) ::munmap(m_sqes, m_sqes_size);
+        if (m_cq_ring && m_cq_ring != m_sq_ring) ::munmap(m_cq_ring, m_cq_size);
+        if (m_sq_ring) ::munmap(m_sq_ring, m_sq_size);
+        if (m_fd >= 0) ::close(m_fd);
+    }
+
+    Ring(const Ring&)            = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    explicit operator bool() const { return m_fd >= 0; }
+
+    // Next free submission entry, zeroed. Submits the pending ones first if the queue is full.
+    io_uring_sqe* next() {
+        auto tail = *m_sq_tail;
+        while (tail - std::atomic_ref(*m_sq_head).load(std::memory_order_acquire) >= m_sq_entries) {
+            if (submit(0) < 0) return nullptr;
+        }
+        auto  index       = tail & *m_sq_mask;
+        auto* sqe         = &m_sqes[index];
+        *sqe              = {};
+        m_sq_array[index] = index;
+        std::atomic_ref(*m_sq_tail).store(tail + 1, std::memory_order_release);
+        m_pending++;
+        return sqe;
+    }
+
+    // Submits the pending entries and waits for min_complete completions. Returns a negated errno on failure.
+    int submit(unsigned min_complete) {
+        while (true) {
+            profile::count(profile::Counter::FsCalls);
+            auto submitted = ::syscall(
+                __NR_io_uring_enter,
+                m_fd,
+                m_pending,
+                min_complete,
+                min_complete ? IORING_ENTER_GETEVENTS : 0,
+                nullptr,
+                0
+            );
+            if (submitted >= 0) {
+                m_pending -= static_cast<unsigned>(submitted);
+                return 0;
+            }
+            if (errno != EINTR) return -errno;
+        }
+    }
+
+    // Calls handle(user_data, res) for every available completion.
+    template <class Handle>
+    void reap(Handle&& handle) {
+        auto head = *m_cq_head;
+        auto tail = std::atomic_ref(*m_cq_tail).load(std::memory_order_acquire);
+        for (; head != tail; head++) {
+            const auto& cqe = m_cqes[head & *m_cq_mask];
+            auto        res = cqe.res;
+            auto        tag = cqe.user_data;
+            // Released before handling, which may queue requests completing into this very slot.
+            std::atomic_ref(*m_cq_head).store(head + 1, std::memory_order_release);
+            handle(tag, res);
+        }
+    }
+
+private:
+    bool map(const io_uring_params& params) {
+        m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        // Both rings share one mapping since 5.4.
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+        m_sq_ring = mmap_ring(m_sq_size, IORING_OFF_SQ_RING);
+        if (!m_sq_ring) return false;
+        m_cq_ring = single ? m_sq_ring : mmap_ring(m_cq_size, IORING_OFF_CQ_RING);
+        if (!m_cq_ring) return false;
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes      = static_cast<io_uring_sqe*>(mmap_ring(m_sqes_size, IORING_OFF_SQES));
+        if (!m_sqes) return false;
+
+        auto* sq     = static_cast<char*>(m_sq_ring);
+        auto* cq     = static_cast<char*>(m_cq_ring);
+        m_sq_head    = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        m_sq_tail    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sq_mask    = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sq_array   = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        m_cq_head    = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cq_tail    = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cq_mask    = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes       = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        m_sq_entries = params.sq_entries;
+        return true;
+    }
+
+    void* mmap_ring(size_t size, off_t offset) {
+        auto* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    // Every opcode used here dates from 5.6, as does the probe: older kernels fail it.
+    bool probe() {
+        constexpr unsigned op_count = 256;
+        auto               size     = sizeof(io_uring_probe) + op_count * sizeof(io_uring_probe_op);
+        std::unique_ptr<io_uring_probe, decltype(&std::free)> probe(
+            static_cast<io_uring_probe*>(std::calloc(1, size)),
+            &std::free
+        );
+        if (!probe || ::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe.get(), op_count) < 0)
+            return false;
+        for (auto op : opcodes) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+        }
+        return true;
+    }
+
+    int m_fd{-1};
+
+    void*  m_sq_ring{};
+    void*  m_cq_ring{};
+    size_t m_sq_size{};
+    size_t m_cq_size{};
+
+    io_uring_sqe* m_sqes{};
+    size_t        m_sqes_size{};
+
+    unsigned*     m_sq_head{};
+    unsigned*     m_sq_tail{};
+    unsigned*     m_sq_mask{};
+    unsigned*     m_sq_array{};
+    unsigned      m_sq_entries{};
+    unsigned      m_pending{}; // queued, not submitted yet
+    unsigned*     m_cq_head{};
+    unsigned*     m_cq_tail{};
+    unsigned*     m_cq_mask{};
+    io_uring_cqe* m_cqes{};
+};
+
+// A file being read: open and statx go together, then the reads, then a close that nobody waits for.
+struct Slot {
+    size_t                 index{};
+    bool                   busy{};
+    int                    fd{-1};
+    int                    waiting{}; // open and statx not completed yet
+    int                    error{};
+    struct statx           stat{};
+    std::vector<std::byte> data;
+    size_t                 read{};
+};
+
+// Should the ring fail midway, the files not reported yet are read on the pool.
+void read_files_uring(Ring& ring, std::span<const std::string> paths, ThreadPool& pool, const ReadCallback& done) {
+    std::vector<Slot> slots(std::min<size_t>(window_size, paths.size()));
+    size_t            next{};
+    size_t            active{};
+    size_t            in_flight{}; // requests queued, their completion not reaped yet
+    bool              failed{};
+
+    auto queue = [&](Operation op, size_t slot, auto&& prepare) {
+        auto* sqe = ring.next();
+        if (!sqe) {
+            failed = true;
+            return;
+        }
+        prepare(*sqe);
+        sqe->opcode    = opcodes[op];
+        sqe->user_data = tag(slot, op);
+        in_flight++;
+    };
+    auto start = [&](size_t slot) {
+        auto& file   = slots[slot];
+        file         = {};
+        file.index   = next++;
+        file.busy    = true;
+        file.waiting = 2;
+        active++;
+        const char* path = paths[file.index].c_str();
+        queue(Open, slot, [&](io_uring_sqe& sqe) {
+            sqe.fd         = AT_FDCWD;
+            sqe.addr       = reinterpret_cast<uint64_t>(path);
+            sqe.open_flags = O_RDONLY | O_CLOEXEC;
+        });
+        queue(Stat, slot, [&](io_uring_sqe& sqe) {
+            sqe.fd          = AT_FDCWD;
+            sqe.addr        = reinterpret_cast<uint64_t>(path);
+            sqe.len         = STATX_SIZE;
+            sqe.off         = reinterpret_cast<uint64_t>(&file.stat);
+            sqe.statx_flags = AT_STATX_SYNC_AS_STAT;
+        });
+    };
+    auto read = [&](size_t slot) {
+        auto& file = slots[slot];
+        queue(Read, slot, [&](io_uring_sqe& sqe) {
+            sqe.fd   = file.fd;
+            sqe.addr = reinterpret_cast<uint64_t>(file.data.data() + file.read);
+            sqe.len  = static_cast<uint32_t>(std::min<size_t>(file.data.size() - file.read, 1 << 30));
+            sqe.off  = file.read;
+        });
+    };
+    auto finish = [&](size_t slot) {
+        auto& file = slots[slot];
+        if (file.fd >= 0) queue(Close, slot, [&](io_uring_sqe& sqe) { sqe.fd = file.fd; });
+        std::error_code ec;
+        if (file.error) {
+            ec        = {file.error, std::system_category()};
+            file.read = 0;
+        }
+        file.data.resize(file.read);
+        profile::count(profile::Counter::BytesRead, file.read);
+        file.busy = false;
+        active--;
+        done(file.index, std::move(file.data), ec);
+        if (next < paths.size()) start(slot);
+    };
+
+    for (size_t slot = 0; slot < slots.size(); slot++) start(slot);
+    while (active && !failed) {
+        if (ring.submit(1) < 0) {
+            failed = true;
+            break;
+        }
+        ring.reap([&](uint64_t user_data, int res) {
+            auto  slot = static_cast<size_t>(user_data >> 8);
+            auto  op   = static_cast<Operation>(user_data & 0xff);
+            auto& file = slots[slot];
+            in_flight--;
+            switch (op) {
+            case Close:
+            case Cancel:
+                return;
+            case Open:
+            case Stat:
+                if (res < 0 && !file.error) file.error = -res;
+                if (op == Open && res >= 0) file.fd = res;
+                if (--file.waiting) return;
+                if (file.error || file.stat.stx_size == 0) return finish(slot);
+                file.data.resize(file.stat.stx_size);
+                return read(slot);
+            case Read:
+                if (res == -EINTR || res == -EAGAIN) return read(slot);
+                if (res < 0) file.error = -res;
+                // Shorter than stat said if it shrank meanwhile.
+                if (res <= 0) return finish(slot);
+                file.read += res;
+                if (file.read < file.data.size()) return read(slot);
+                return finish(slot);
+            }
+        });
+    }
+    if (!failed) return;
+
+    std::vector<size_t> left;
+    for (const auto& file : slots) {
+        if (file.busy) left.push_back(file.index);
+    }
+
+    // The kernel may still write into the statx results and buffers of the slots: cancel what is in flight and wait
+    // for every completion before the slots and their descriptors go away.
+    for (size_t slot = 0; slot < slots.size(); slot++) {
+        if (!slots[slot].busy) continue;
+        for (auto op : {Open, Stat, Read}) queue(Cancel, slot, [&](io_uring_sqe& sqe) { sqe.addr = tag(slot, op); });
+    }
+    bool drained = true;
+    while (in_flight) {
+        if (ring.submit(1) < 0) {
+            drained = false;
+            break;
+        }
+        ring.reap([&](uint64_t user_data, int res) {
+            auto slot = static_cast<size_t>(user_data >> 8);
+            auto op   = static_cast<Operation>(user_data & 0xff);
+            in_flight--;
+            if (op == Open && res >= 0) slots[slot].fd = res;
+        });
+    }
+    if (drained) {
+        for (const auto& file : slots) {
+            if (file.busy && file.fd >= 0) ::close(file.fd);
+        }
+    } else {
+        // Nothing tells when the requests left are done, so their memory (and descriptors) are never released.
+        new std::vector<Slot>(std::move(slots));
+    }
+
+    for (; next < paths.size(); next++) left.push_back(next);
+    std::vector<std::string> left_paths;
+    for (auto idx : left) left_paths.push_back(paths[idx]);
+    read_files_blocking(left_paths, pool, [&](size_t idx, std::vector<std::byte>&& data, const std::error_code& ec) {
+        done(left[idx], std::move(data), ec);
+    });
+}
+
+#endif
+
+} // namespace
+
+void read_files(std::span<const std::string> paths, ThreadPool& pool, const ReadCallback& done) {
+    if (paths.empty()) return;
+#ifdef __linux__
+    Ring ring(ring_size);
+    if (ring) {
+        read_files_uring(ring, paths, pool, done);
+        return;
+    }
+#endif
+    read_files_blocking(paths, pool, done);
+}
+
+} // namespace util
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace util {
+
+// index in paths, contents of the file, std::system_category() error (contents empty) on failure.
+using ReadCallback = std::function<void(size_t index, std::vector<std::byte>&& data, const std::error_code& ec)>;
+
+// Reads many small files completely, with a few hundred in flight. On Linux, the open, statx, read and close
+// requests go through io_uring, batched into one system call per round trip, and done is called on the calling
+// thread as files complete. Without io_uring (other systems, kernels older than 5.6, or io_uring disabled by a
+// sysctl or seccomp), the files are read with blocking calls on the workers of pool, which call done concurrently.
+void read_files(std::span<const std::string> paths, ThreadPool& pool, const ReadCallback& done);
+
+} // namespace util
@@ -0,0 +1,244 @@
+#include "File.h"
+#include "Profile.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
+namespace util {
+
+namespace {
+
+constexpr size_t copy_buffer_size = 8 << 20;
+
+} // namespace
+
+File::~File() { close(); }
+
+void File::copyFrom(const File& source, uint64_t source_offset, uint64_t offset, uint64_t length, std::error_code& ec) {
+#ifdef __linux__
+    // Both fall back to the buffer if the kernel can not copy between these two files (EXDEV, EINVAL, ENOSYS...).
+    while (length) {
+        loff_t from   = static_cast<loff_t>(source_offset);
+        loff_t to     = static_cast<loff_t>(offset);
+        auto   copied = ::copy_file_range(source.m_fd, &from, m_fd, &to, length, 0);
+        profile::count(profile::Counter::FsCalls);
+        if (copied < 0 && errno == EINTR) continue;
+        if (copied <= 0) break;
+        profile::count(profile::Counter::BytesWritten, copied);
+        source_offset += copied;
+        offset        += copied;
+        length        -= copied;
+    }
+    // sendfile writes at the file position of the destination.
+    if (length && ::lseek(m_fd, static_cast<off_t>(offset), SEEK_SET) >= 0) {
+        while (length) {
+            off_t from = static_cast<off_t>(source_offset);
+            auto  sent = ::sendfile(m_fd, source.m_fd, &from, std::min<uint64_t>(length, 1 << 30));
+            profile::count(profile::Counter::FsCalls);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) break;
+            profile::count(profile::Counter::BytesWritten, sent);
+            source_offset += sent;
+            offset        += sent;
+            length        -= sent;
+        }
+    }
+#endif
+    if (!length) return;
+    std::vector<std::byte> buffer(std::min<uint64_t>(length, copy_buffer_size));
+    while (length) {
+        auto chunk = std::span(buffer).first(std::min<uint64_t>(length, buffer.size()));
+        auto read  = source.read(source_offset, chunk, ec);
+        if (ec) return;
+        if (read < chunk.size()) {
+            ec = std::make_error_code(std::errc::io_error);
+            return;
+        }
+        write(offset, chunk, ec);
+        if (ec) return;
+        source_offset += read;
+        offset        += read;
+        length        -= read;
+    }
+}
+
+#ifdef _WIN32
+
+File::File(File&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+File& File::operator=(File&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_handle = std::exchange(other.m_handle, nullptr);
+    }
+    return *this;
+}
+
+std::optional<File> File::open(const std::string& path, Mode mode, std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    auto handle = CreateFileW(
+        std::filesystem::path(path).c_str(),
+        mode == ReadOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ,
+        nullptr,
+        mode == Create ? CREATE_ALWAYS : OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (handle == INVALID_HANDLE_VALUE) {
+        ec = {(int)GetLastError(), std::system_category()};
+        return {};
+    }
+    File result;
+    result.m_handle = handle;
+    return result;
+}
+
+void File::write(uint64_t offset, std::span<const std::byte> data, std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    profile::count(profile::Counter::BytesWritten, data.size());
+    while (!data.empty()) {
+        OVERLAPPED overlapped{};
+        overlapped.Offset     = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written{};
+        auto  chunk = static_cast<DWORD>(std::min<size_t>(data.size(), 1 << 30));
+        if (!WriteFile(m_handle, data.data(), chunk, &written, &overlapped)) {
+            ec = {(int)GetLastError(), std::system_category()};
+            return;
+        }
+        data    = data.subspan(written);
+        offset += written;
+    }
+}
+
+size_t File::read(uint64_t offset, std::span<std::byte> data, std::error_code& ec) const {
+    size_t total{};
+    while (total < data.size()) {
+        profile::count(profile::Counter::FsCalls);
+        OVERLAPPED overlapped{};
+        overlapped.Offset     = static_cast<DWORD>(offset + total);
+        overlapped.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+        DWORD read{};
+        auto  chunk = static_cast<DWORD>(std::min<size_t>(data.size() - total, 1 << 30));
+        if (!ReadFile(m_handle, data.data() + total, chunk, &read, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) break;
+            ec = {(int)GetLastError(), std::system_category()};
+            break;
+        }
+        if (!read) break;
+        total += read;
+    }
+    profile::count(profile::Counter::BytesRead, total);
+    return total;
+}
+
+void File::truncate(uint64_t size, std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(m_handle, position, nullptr, FILE_BEGIN) || !SetEndOfFile(m_handle))
+        ec = {(int)GetLastError(), std::system_category()};
+}
+
+void File::sync(std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    if (!FlushFileBuffers(m_handle)) ec = {(int)GetLastError(), std::system_category()};
+}
+
+void File::close() {
+    if (m_handle) CloseHandle(m_handle);
+    m_handle = nullptr;
+}
+
+#else
+
+File::File(File&& other) noexcept : m_fd(std::exchange(other.m_fd, -1)) {}
+
+File& File::operator=(File&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_fd = std::exchange(other.m_fd, -1);
+    }
+    return *this;
+}
+
+std::optional<File> File::open(const std::string& path, Mode mode, std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    int flags = (mode == ReadOnly ? O_RDONLY : O_RDWR) | O_CLOEXEC;
+    if (mode == Create) flags |= O_CREAT | O_TRUNC;
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        ec = {errno, std::system_category()};
+        return {};
+    }
+    File result;
+    result.m_fd = fd;
+    return result;
+}
+
+void File::write(uint64_t offset, std::span<const std::byte> data, std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    profile::count(profile::Counter::BytesWritten, data.size());
+    while (!data.empty()) {
+        auto written = ::pwrite(m_fd, data.data(), data.size(), static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ec = {errno, std::system_category()};
+            return;
+        }
+        data    = data.subspan(written);
+        offset += written;
+    }
+}
+
+size_t File::read(uint64_t offset, std::span<std::byte> data, std::error_code& ec) const {
+    size_t total{};
+    while (total < data.size()) {
+        profile::count(profile::Counter::FsCalls);
+        auto read = ::pread(m_fd, data.data() + total, data.size() - total, static_cast<off_t>(offset + total));
+        if (read < 0 && errno == EINTR) continue;
+        if (read < 0) {
+            ec = {errno, std::system_category()};
+            break;
+        }
+        if (!read) break;
+        total += read;
+    }
+    profile::count(profile::Counter::BytesRead, total);
+    return total;
+}
+
+void File::truncate(uint64_t size, std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0) ec = {errno, std::system_category()};
+}
+
+void File::sync(std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    if (::fsync(m_fd) != 0) ec = {errno, std::system_category()};
+}
+
+void File::close() {
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+}
+
+#endif
+
+} // namespace util
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+
+namespace util {
+
+// File handle for positioned reads and writes, closed on destruction.
+class File {
+public:
+    enum Mode {
+        Existing, // open an existing file for reading and writing
+        Create,   // create the file, or truncate it if it exists
+        ReadOnly, // open an existing file for reading
+    };
+
+    File() = default;
+    ~File();
+
+    File(File&& other) noexcept;
+    File& operator=(File&& other) noexcept;
+
+    File(const File&)            = delete;
+    File& operator=(const File&) = delete;
+
+    // ec is set to a std::system_category() error on failure, as for every other method.
+    static std::optional<File> open(const std::string& path, Mode mode, std::error_code& ec);
+
+    // Writes all of data at offset, without moving any file position.
+    void write(uint64_t offset, std::span<const std::byte> data, std::error_code& ec);
+
+    // Reads up to data.size() bytes at offset, returns how many were read (less only at the end of the file).
+    size_t read(uint64_t offset, std::span<std::byte> data, std::error_code& ec) const;
+
+    // Copies length bytes of source from source_offset to offset in this file. On Linux the data is copied by the
+    // kernel (copy_file_range, which may share the blocks on filesystems supporting it, then sendfile), otherwise
+    // or if neither works between the two files, through a large buffer. Reading past the end of source is an
+    // error.
+    void copyFrom(const File& source, uint64_t source_offset, uint64_t offset, uint64_t length, std::error_code& ec);
+
+    void truncate(uint64_t size, std::error_code& ec);
+
+    // Flushes the data to the disk.
+    void sync(std::error_code& ec);
+
+    void close();
+
+private:
+#ifdef _WIN32
+    void* m_handle{};
+#else
+    int m_fd{-1};
+#endif
+};
+
+} // namespace util
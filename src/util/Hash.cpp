@@ -0,0 +1,287 @@
+#include "Hash.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace util {
+
+namespace {
+
+constexpr uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr uint32_t crc_polynomial = 0xedb88320; // 0x04C11DB7 reflected
+
+// Slicing-by-8: tables[k][b] is the CRC of byte b followed by k zero bytes.
+constexpr auto crc_tables = [] {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; bit++) crc = crc & 1 ? (crc >> 1) ^ crc_polynomial : crc >> 1;
+        tables[0][byte] = crc;
+    }
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        for (int k = 1; k < 8; k++) {
+            auto previous   = tables[k - 1][byte];
+            tables[k][byte] = (previous >> 8) ^ tables[0][previous & 0xff];
+        }
+    }
+    return tables;
+}();
+
+constexpr auto rk_crc_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte << 24;
+        for (int bit = 0; bit < 8; bit++) crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c10db7 : crc << 1;
+        table[byte] = crc;
+    }
+    return table;
+}();
+
+constexpr uint32_t md5_constants[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+constexpr int md5_shifts[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+std::string to_hex(std::span<const uint8_t> digest) {
+    constexpr char digits[] = "0123456789abcdef";
+
+    std::string result;
+    result.reserve(digest.size() * 2);
+    for (auto byte : digest) {
+        result += digits[byte >> 4];
+        result += digits[byte & 0xf];
+    }
+    return result;
+}
+
+// a * b modulo the polynomial, both in the reflected bit order.
+uint32_t crc_multiply(uint32_t a, uint32_t b) {
+    uint32_t product{};
+    for (uint32_t mask = 1u << 31; mask; mask >>= 1) {
+        if (a & mask) product ^= b;
+        b = b & 1 ? (b >> 1) ^ crc_polynomial : b >> 1;
+    }
+    return product;
+}
+
+// x^(8 * bytes) modulo the polynomial, by squaring: x^(2^k) is looked up for every bit set in the bit count.
+uint32_t crc_shift(uint64_t bytes) {
+    static const auto powers = [] {
+        std::array<uint32_t, 64> result{};
+        uint32_t                 power = 1u << 30; // x^1
+        for (auto& entry : result) {
+            entry = power;
+            power = crc_multiply(power, power);
+        }
+        return result;
+    }();
+    uint32_t result = 1u << 31; // x^0
+    for (int k = 3; bytes; bytes >>= 1, k++) {
+        if (bytes & 1) result = crc_multiply(powers[k], result);
+    }
+    return result;
+}
+
+uint32_t load_be32(const uint8_t* data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+} // namespace
+
+void Crc32::update(std::span<const std::byte> data) {
+    auto     input = reinterpret_cast<const uint8_t*>(data.data());
+    auto     size  = data.size();
+    uint32_t crc   = ~m_value;
+    for (; size >= 8; input += 8, size -= 8) {
+        uint32_t low  = crc ^ (input[0] | input[1] << 8 | input[2] << 16 | (uint32_t)input[3] << 24);
+        uint32_t high = input[4] | input[5] << 8 | input[6] << 16 | (uint32_t)input[7] << 24;
+        crc = crc_tables[7][low & 0xff] ^ crc_tables[6][(low >> 8) & 0xff] ^ crc_tables[5][(low >> 16) & 0xff] ^
+              crc_tables[4][low >> 24] ^ crc_tables[3][high & 0xff] ^ crc_tables[2][(high >> 8) & 0xff] ^
+              crc_tables[1][(high >> 16) & 0xff] ^ crc_tables[0][high >> 24];
+    }
+    for (; size; input++, size--) crc = (crc >> 8) ^ crc_tables[0][(crc ^ *input) & 0xff];
+    m_value = ~crc;
+}
+
+uint32_t Crc32::combine(uint32_t first, uint32_t second, uint64_t second_length) {
+    return crc_multiply(crc_shift(second_length), first) ^ second;
+}
+
+void RkCrc32::update(std::span<const std::byte> data) {
+    auto crc = m_value;
+    for (auto byte : data) crc = (crc << 8) ^ rk_crc_table[(crc >> 24) ^ static_cast<uint8_t>(byte)];
+    m_value = crc;
+}
+
+Md5::Md5() : m_state{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476} {}
+
+void Md5::transform(const uint8_t* block) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++)
+        m[i] = block[i * 4] | block[i * 4 + 1] << 8 | block[i * 4 + 2] << 16 | (uint32_t)block[i * 4 + 3] << 24;
+    auto [a, b, c, d] = m_state;
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int      g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+        f = f + a + md5_constants[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b = b + std::rotl(f, md5_shifts[i / 16 * 4 + i % 4]);
+    }
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+}
+
+void Md5::update(std::span<const std::byte> data) {
+    auto input  = reinterpret_cast<const uint8_t*>(data.data());
+    auto size   = data.size();
+    m_length   += size;
+    if (m_buffered) {
+        auto count = std::min(size, m_buffer.size() - m_buffered);
+        std::memcpy(m_buffer.data() + m_buffered, input, count);
+        m_buffered += count;
+        input      += count;
+        size       -= count;
+        if (m_buffered < m_buffer.size()) return;
+        transform(m_buffer.data());
+        m_buffered = 0;
+    }
+    for (; size >= 64; input += 64, size -= 64) transform(input);
+    std::memcpy(m_buffer.data(), input, size);
+    m_buffered = size;
+}
+
+Md5::Digest Md5::finish() {
+    uint64_t bit_length = m_length * 8;
+    uint8_t  padding[72]{0x80};
+    auto     padding_size = (m_buffered < 56 ? 56 : 120) - m_buffered;
+    for (int i = 0; i < 8; i++) padding[padding_size + i] = static_cast<uint8_t>(bit_length >> (i * 8));
+    update(std::as_bytes(std::span(padding, padding_size + 8)));
+
+    Digest digest;
+    for (int i = 0; i < 4; i++) {
+        for (int k = 0; k < 4; k++) digest[i * 4 + k] = static_cast<uint8_t>(m_state[i] >> (k * 8));
+    }
+    return digest;
+}
+
+std::string Md5::toHex(const Digest& digest) { return to_hex(digest); }
+
+Sha256::Sha256()
+: m_state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {}
+
+void Sha256::transform(const uint8_t* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) w[i] = load_be32(block + i * 4);
+    for (int i = 16; i < 64; i++) {
+        auto s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i]    = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    auto [a, b, c, d, e, f, g, h] = m_state;
+    for (int i = 0; i < 64; i++) {
+        auto s1    = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+        auto ch    = (e & f) ^ (~e & g);
+        auto temp1 = h + s1 + ch + round_constants[i] + w[i];
+        auto s0    = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+        auto maj   = (a & b) ^ (a & c) ^ (b & c);
+        auto temp2 = s0 + maj;
+        h          = g;
+        g          = f;
+        f          = e;
+        e          = d + temp1;
+        d          = c;
+        c          = b;
+        b          = a;
+        a          = temp1 + temp2;
+    }
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+void Sha256::update(std::span<const std::byte> data) {
+    auto input  = reinterpret_cast<const uint8_t*>(data.data());
+    auto size   = data.size();
+    m_length   += size;
+    if (m_buffered) {
+        auto count = std::min(size, m_buffer.size() - m_buffered);
+        std::memcpy(m_buffer.data() + m_buffered, input, count);
+        m_buffered += count;
+        input      += count;
+        size       -= count;
+        if (m_buffered < m_buffer.size()) return;
+        transform(m_buffer.data());
+        m_buffered = 0;
+    }
+    for (; size >= 64; input += 64, size -= 64) transform(input);
+    std::memcpy(m_buffer.data(), input, size);
+    m_buffered = size;
+}
+
+void Sha256::update(uint64_t value) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) bytes[i] = static_cast<uint8_t>(value >> (i * 8));
+    update(std::as_bytes(std::span(bytes)));
+}
+
+Sha256::Digest Sha256::finish() {
+    uint64_t bit_length = m_length * 8;
+    uint8_t  padding[72]{0x80};
+    auto     padding_size = (m_buffered < 56 ? 56 : 120) - m_buffered;
+    for (int i = 0; i < 8; i++) padding[padding_size + i] = static_cast<uint8_t>(bit_length >> (56 - i * 8));
+    update(std::as_bytes(std::span(padding, padding_size + 8)));
+
+    Digest digest;
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4]     = static_cast<uint8_t>(m_state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(m_state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(m_state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(m_state[i]);
+    }
+    return digest;
+}
+
+std::string Sha256::toHex(const Digest& digest) { return to_hex(digest); }
+
+} // namespace util
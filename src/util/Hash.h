@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+// CRC-32 as used by zip and gzip (reflected, polynomial 0x04C11DB7), fed incrementally.
+class Crc32 {
+public:
+    void update(std::span<const std::byte> data);
+
+    uint32_t value() const { return m_value; }
+
+    // CRC of the concatenation of two blocks, from their CRCs and the length of the second one, so that the
+    // blocks of a file can be hashed in parallel.
+    static uint32_t combine(uint32_t first, uint32_t second, uint64_t second_length);
+
+private:
+    uint32_t m_value{};
+};
+
+// CRC-32 of Rockchip's firmware tools: polynomial 0x04C10DB7, most significant bit first, no inversion.
+class RkCrc32 {
+public:
+    void update(std::span<const std::byte> data);
+
+    uint32_t value() const { return m_value; }
+
+private:
+    uint32_t m_value{};
+};
+
+// MD5 (RFC 1321), fed incrementally. Only used where a file format requires it.
+class Md5 {
+public:
+    using Digest = std::array<uint8_t, 16>;
+
+    Md5();
+
+    void update(std::span<const std::byte> data);
+
+    // The hasher must not be updated afterwards.
+    Digest finish();
+
+    static std::string toHex(const Digest& digest);
+
+private:
+    void transform(const uint8_t* block);
+
+    std::array<uint32_t, 4> m_state;
+    std::array<uint8_t, 64> m_buffer{};
+    size_t                  m_buffered{};
+    uint64_t                m_length{};
+};
+
+// SHA-256 (FIPS 180-4), fed incrementally.
+class Sha256 {
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    void update(std::span<const std::byte> data);
+    void update(std::string_view data) { update(std::as_bytes(std::span(data.data(), data.size()))); }
+
+    // Integers are hashed as 8 little-endian bytes, so that keys do not depend on the platform.
+    void update(uint64_t value);
+
+    // The hasher must not be updated afterwards.
+    Digest finish();
+
+    static std::string toHex(const Digest& digest);
+
+private:
+    void transform(const uint8_t* block);
+
+    std::array<uint32_t, 8> m_state;
+    std::array<uint8_t, 64> m_buffer{};
+    size_t                  m_buffered{};
+    uint64_t                m_length{};
+};
+
+} // namespace util
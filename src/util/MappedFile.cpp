@@ -0,0 +1,139 @@
+#include "MappedFile.h"
+#include "Profile.h"
+
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+
+MappedFile::~MappedFile() { reset(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+: m_data(std::exchange(other.m_data, nullptr)),
+  m_size(std::exchange(other.m_size, 0))
+#ifdef _WIN32
+  ,
+  m_mapping(std::exchange(other.m_mapping, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        reset();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+std::optional<MappedFile> MappedFile::open(const std::string& path, std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    auto handle = CreateFileW(
+        std::filesystem::path(path).c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr
+    );
+    if (handle == INVALID_HANDLE_VALUE) {
+        ec = {(int)GetLastError(), std::system_category()};
+        return {};
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(handle, &file_size)) {
+        ec = {(int)GetLastError(), std::system_category()};
+        CloseHandle(handle);
+        return {};
+    }
+    MappedFile result;
+    if (file_size.QuadPart == 0) {
+        CloseHandle(handle);
+        return result;
+    }
+    auto mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(handle);
+    if (!mapping) {
+        ec = {(int)GetLastError(), std::system_category()};
+        return {};
+    }
+    auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        ec = {(int)GetLastError(), std::system_category()};
+        CloseHandle(mapping);
+        return {};
+    }
+    result.m_data    = static_cast<const std::byte*>(view);
+    result.m_size    = (size_t)file_size.QuadPart;
+    result.m_mapping = mapping;
+    profile::count(profile::Counter::BytesRead, result.m_size);
+    return result;
+}
+
+void MappedFile::reset() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    m_data    = nullptr;
+    m_size    = 0;
+    m_mapping = nullptr;
+}
+
+#else
+
+std::optional<MappedFile> MappedFile::open(const std::string& path, std::error_code& ec) {
+    profile::count(profile::Counter::FsCalls);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ec = {errno, std::system_category()};
+        return {};
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        ec = {errno, std::system_category()};
+        ::close(fd);
+        return {};
+    }
+    MappedFile result;
+    if (st.st_size == 0) {
+        ::close(fd);
+        return result;
+    }
+    auto addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        ec = {errno, std::system_category()};
+        return {};
+    }
+    result.m_data = static_cast<const std::byte*>(addr);
+    result.m_size = (size_t)st.st_size;
+    profile::count(profile::Counter::BytesRead, result.m_size);
+    return result;
+}
+
+void MappedFile::reset() {
+    if (m_data) munmap(const_cast<std::byte*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
+
+} // namespace util
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+
+namespace util {
+
+// Read-only mapping of a whole file, unmapped on destruction.
+// Empty files are represented by an empty span (nothing is mapped).
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // ec is set to a std::system_category() error on failure.
+    static std::optional<MappedFile> open(const std::string& path, std::error_code& ec);
+
+    const std::byte* data() const { return m_data; }
+    size_t           size() const { return m_size; }
+
+    std::span<const std::byte> bytes() const { return {m_data, m_size}; }
+
+private:
+    void reset();
+
+    const std::byte* m_data{};
+    size_t           m_size{};
+#ifdef _WIN32
+    void* m_mapping{};
+#endif
+};
+
+} // namespace util
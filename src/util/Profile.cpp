@@ -0,0 +1,194 @@
+#include "Profile.h"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include <spdlog/fmt/fmt.h>
+
+namespace util::profile {
+
+namespace detail {
+
+std::atomic<bool> enabled;
+
+} // namespace detail
+
+namespace {
+
+// Only written by its thread, the atomics let snapshot() read them concurrently.
+struct Slots {
+    std::array<std::atomic<uint64_t>, phase_count>   calls{};
+    std::array<std::atomic<uint64_t>, phase_count>   nanoseconds{};
+    std::array<std::atomic<uint64_t>, counter_count> counters{};
+};
+
+void bump(std::atomic<uint64_t>& slot, uint64_t value) {
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void accumulate(Snapshot& total, const Slots& slots) {
+    for (size_t i = 0; i < phase_count; i++) {
+        total.calls[i]       += slots.calls[i].load(std::memory_order_relaxed);
+        total.nanoseconds[i] += slots.nanoseconds[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < counter_count; i++) total.counters[i] += slots.counters[i].load(std::memory_order_relaxed);
+}
+
+class Registry {
+public:
+    void attach(const Slots* slots) {
+        std::lock_guard lock(m_mutex);
+        m_threads.push_back(slots);
+    }
+
+    // Keeps the counts of an exiting thread.
+    void detach(const Slots* slots) {
+        std::lock_guard lock(m_mutex);
+        accumulate(m_exited, *slots);
+        m_threads.erase(std::find(m_threads.begin(), m_threads.end(), slots));
+    }
+
+    Snapshot sum() {
+        std::lock_guard lock(m_mutex);
+        auto            total = m_exited;
+        for (auto slots : m_threads) accumulate(total, *slots);
+        return total;
+    }
+
+private:
+    std::mutex                m_mutex;
+    std::vector<const Slots*> m_threads;
+    Snapshot                  m_exited;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+struct ThreadSlots {
+    // registry() is constructed first, so it outlives the thread_local below even on the main thread.
+    ThreadSlots() { registry().attach(&slots); }
+    ~ThreadSlots() { registry().detach(&slots); }
+
+    Slots slots;
+};
+
+Slots& local_slots() {
+    thread_local ThreadSlots local;
+    return local.slots;
+}
+
+} // namespace
+
+namespace detail {
+
+void add(Counter counter, uint64_t value) { bump(local_slots().counters[static_cast<size_t>(counter)], value); }
+
+void record(Phase phase, std::chrono::steady_clock::duration elapsed) {
+    auto& slots = local_slots();
+    auto  index = static_cast<size_t>(phase);
+    bump(slots.calls[index], 1);
+    bump(slots.nanoseconds[index], std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+} // namespace detail
+
+void set_enabled(bool enabled) { detail::enabled.store(enabled, std::memory_order_relaxed); }
+
+Snapshot snapshot() { return registry().sum(); }
+
+std::string_view name(Phase phase) {
+    switch (phase) {
+    case Phase::FromFile:
+        return "from_file";
+    case Phase::FromParameter:
+        return "from_parameter";
+    case Phase::ParameterParse:
+        return "parameter_parse";
+    case Phase::AutoScan:
+        return "auto_scan";
+    case Phase::ItemBuild:
+        return "item_build";
+    case Phase::FromJson:
+        return "from_json";
+    case Phase::RemoveItem:
+        return "remove_item";
+    case Phase::ToJson:
+        return "to_json";
+    case Phase::Save:
+        return "save";
+    case Phase::PackUpdate:
+        return "pack_update";
+    case Phase::FromUpdateImage:
+        return "from_update_image";
+    case Phase::Extract:
+        return "extract";
+    default:
+        return {};
+    }
+}
+
+std::string_view name(Counter counter) {
+    switch (counter) {
+    case Counter::BytesRead:
+        return "bytes_read";
+    case Counter::BytesWritten:
+        return "bytes_written";
+    case Counter::FsCalls:
+        return "fs_calls";
+    case Counter::Transcodes:
+        return "transcodes";
+    default:
+        return {};
+    }
+}
+
+std::string to_table(const Snapshot& snapshot) {
+    std::string result = fmt::format("{:<18} {:>10} {:>14} {:>12}\n", "phase", "calls", "total (ms)", "mean (us)");
+    for (size_t i = 0; i < phase_count; i++) {
+        if (!snapshot.calls[i]) continue;
+        fmt::format_to(
+            std::back_inserter(result),
+            "{:<18} {:>10} {:>14.3f} {:>12.3f}\n",
+            name(static_cast<Phase>(i)),
+            snapshot.calls[i],
+            snapshot.nanoseconds[i] / 1e6,
+            snapshot.nanoseconds[i] / 1e3 / snapshot.calls[i]
+        );
+    }
+    fmt::format_to(std::back_inserter(result), "\n{:<18} {:>10}\n", "counter", "value");
+    for (size_t i = 0; i < counter_count; i++) {
+        auto counter = static_cast<Counter>(i);
+        fmt::format_to(std::back_inserter(result), "{:<18} {:>10}\n", name(counter), snapshot.counters[i]);
+    }
+    return result;
+}
+
+std::string to_ndjson(const Snapshot& snapshot) {
+    // Names are plain identifiers, nothing needs escaping.
+    std::string result;
+    for (size_t i = 0; i < phase_count; i++) {
+        if (!snapshot.calls[i]) continue;
+        fmt::format_to(
+            std::back_inserter(result),
+            "{{\"phase\":\"{}\",\"calls\":{},\"total_ns\":{}}}\n",
+            name(static_cast<Phase>(i)),
+            snapshot.calls[i],
+            snapshot.nanoseconds[i]
+        );
+    }
+    for (size_t i = 0; i < counter_count; i++) {
+        fmt::format_to(
+            std::back_inserter(result),
+            "{{\"counter\":\"{}\",\"value\":{}}}\n",
+            name(static_cast<Counter>(i)),
+            snapshot.counters[i]
+        );
+    }
+    return result;
+}
+
+} // namespace util::profile
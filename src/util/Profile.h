@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Phase timers and counters behind '--profile'. Disabled by default, then every probe costs a relaxed load and a
+// branch. Once enabled, each thread records into its own slots, which are summed up by snapshot(), so that batch
+// jobs running on a thread pool do not contend on shared counters.
+namespace util::profile {
+
+enum class Phase : size_t {
+    FromFile,      // RKCfgView::open (and so RKCfgFile::fromFile)
+    FromParameter, // the whole conversion, ParameterParse, AutoScan and ItemBuild included
+    ParameterParse,
+    AutoScan,
+    ItemBuild,
+    FromJson,
+    RemoveItem,
+    ToJson,
+    Save,
+    PackUpdate,
+    FromUpdateImage,
+    Extract,
+    Count
+};
+
+enum class Counter : size_t { BytesRead, BytesWritten, FsCalls, Transcodes, Count };
+
+inline constexpr size_t phase_count   = static_cast<size_t>(Phase::Count);
+inline constexpr size_t counter_count = static_cast<size_t>(Counter::Count);
+
+namespace detail {
+
+extern std::atomic<bool> enabled;
+
+void add(Counter counter, uint64_t value);
+void record(Phase phase, std::chrono::steady_clock::duration elapsed);
+
+} // namespace detail
+
+void set_enabled(bool enabled);
+
+inline bool is_enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+inline void count(Counter counter, uint64_t value = 1) {
+    if (is_enabled()) detail::add(counter, value);
+}
+
+// Adds the time until destruction to a phase (if profiling was enabled on construction).
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase) : m_phase(phase), m_active(is_enabled()) {
+        if (m_active) m_begin = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (m_active) detail::record(m_phase, std::chrono::steady_clock::now() - m_begin);
+    }
+
+    ScopedTimer(const ScopedTimer&)            = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Phase                                 m_phase;
+    bool                                  m_active;
+    std::chrono::steady_clock::time_point m_begin;
+};
+
+struct Snapshot {
+    std::array<uint64_t, phase_count>   calls{};
+    std::array<uint64_t, phase_count>   nanoseconds{};
+    std::array<uint64_t, counter_count> counters{};
+};
+
+// Sum of every thread, the exited ones included.
+Snapshot snapshot();
+
+std::string_view name(Phase phase);
+std::string_view name(Counter counter);
+
+// Aligned table of the phases that ran, then the counters.
+std::string to_table(const Snapshot& snapshot);
+
+// One json object per line: {"phase", "calls", "total_ns"} for every phase that ran, then {"counter", "value"}.
+std::string to_ndjson(const Snapshot& snapshot);
+
+} // namespace util::profile
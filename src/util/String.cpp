@@ -1,22 +1,30 @@
 #include "String.h"
 
-#include <unicode/unistr.h>
+#include "Unicode.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 
 namespace util::string {
 
-std::string from_char16(const char16_t* str) {
-    icu::UnicodeString unicode(str);
-    std::string        result;
-    return unicode.toUTF8String(result);
+std::string from_char16(const char16_t* str, size_t max_len) {
+    auto        length = unicode::utf16_length(str, max_len);
+    std::string result(unicode::utf8_capacity(length), '\0');
+    result.resize(unicode::utf16_to_utf8(str, length, result.data()));
+    return result;
 }
 
-bool to_char16(const std::string& str, char16_t* des, size_t len) {
-    // icu::UnicodeString uses UTF-16 to store strings by default.
+std::string_view from_char16(const char16_t* str, size_t max_len, std::span<char> buffer) {
+    auto length = unicode::utf16_length(str, std::min(max_len, buffer.size() / 3));
+    return {buffer.data(), unicode::utf16_to_utf8(str, length, buffer.data())};
+}
 
-    auto unicode = icu::UnicodeString::fromUTF8(str);
-    auto length  = unicode.length();
-    if ((size_t)length > len - 1) return false;
-    unicode.extract(0, length, reinterpret_cast<UChar*>(des));
+bool to_char16(std::string_view str, char16_t* des, size_t len) {
+    // A UTF-16 string never has more code units than its UTF-8 form has bytes, so only long inputs can overflow.
+    if (str.size() > len - 1 && unicode::utf16_length_of_utf8(str.data(), str.size()) > len - 1) return false;
+    auto length = unicode::utf8_to_utf16(str.data(), str.size(), des, len - 1);
+    des[length] = 0;
     return true;
 }
 
@@ -33,6 +41,40 @@ std::optional<uint32_t> to_uint32(const std::string& str) {
     return value;
 }
 
+std::optional<uint64_t> to_size(std::string_view str) {
+    uint64_t value{};
+    auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc() || end == str.data()) return {};
+    std::string_view suffix(end, str.data() + str.size() - end);
+    if (suffix.ends_with('B') || suffix.ends_with('b')) suffix.remove_suffix(1);
+    int shift{};
+    if (suffix.size() > 1) return {};
+    if (!suffix.empty()) {
+        switch (suffix[0]) {
+        case 'k':
+        case 'K':
+            shift = 10;
+            break;
+        case 'm':
+        case 'M':
+            shift = 20;
+            break;
+        case 'g':
+        case 'G':
+            shift = 30;
+            break;
+        case 't':
+        case 'T':
+            shift = 40;
+            break;
+        default:
+            return {};
+        }
+    }
+    if (value > (UINT64_MAX >> shift)) return {};
+    return value << shift;
+}
+
 void remove_prefix(std::string& str, const std::string& prefix) {
     if (str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0) {
         str.erase(0, prefix.size());
@@ -45,4 +87,31 @@ void remove_suffix(std::string& str, const std::string& suffix) {
     }
 }
 
+bool match_wildcard(std::string_view pattern, std::string_view str) {
+    size_t pattern_idx{}, str_idx{};
+    size_t star_idx = std::string_view::npos, match_idx{};
+    while (str_idx < str.size()) {
+        if (pattern_idx < pattern.size() && (pattern[pattern_idx] == '?' || pattern[pattern_idx] == str[str_idx])) {
+            pattern_idx++;
+            str_idx++;
+        } else if (pattern_idx < pattern.size() && pattern[pattern_idx] == '*') {
+            star_idx  = pattern_idx++;
+            match_idx = str_idx;
+        } else if (star_idx != std::string_view::npos) {
+            pattern_idx = star_idx + 1;
+            str_idx     = ++match_idx;
+        } else {
+            return false;
+        }
+    }
+    while (pattern_idx < pattern.size() && pattern[pattern_idx] == '*') pattern_idx++;
+    return pattern_idx == pattern.size();
+}
+
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
 } // namespace util::string
\ No newline at end of file
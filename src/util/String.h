@@ -2,19 +2,36 @@
 
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 
 namespace util::string {
 
-std::string from_char16(const char16_t* str);
-bool        to_char16(const std::string& str, char16_t* des, size_t len);
+// UTF-16 fields are read up to the first NUL or max_len code units, whichever comes first. max_len must not exceed the
+// field, whole blocks of code units are loaded at a time.
+std::string      from_char16(const char16_t* str, size_t max_len);
+std::string_view from_char16(const char16_t* str, size_t max_len, std::span<char> buffer);
+
+// Fails (leaving des untouched) if str needs more than len - 1 code units, otherwise des is NUL-terminated.
+bool to_char16(std::string_view str, char16_t* des, size_t len);
 
 // TODO: Replace with: std::expected
 std::optional<uint32_t> to_uint32(const std::string& str);
 
+// Byte count with an optional binary suffix: "4096", "512K", "64M", "2G".
+// TODO: Replace with: std::expected
+std::optional<uint64_t> to_size(std::string_view str);
+
 void remove_prefix(std::string& str, const std::string& prefix);
 
 void remove_suffix(std::string& str, const std::string& suffix);
 
+// Shell-style wildcard match, supports '*' and '?'.
+bool match_wildcard(std::string_view pattern, std::string_view str);
+
+// ASCII case-insensitive comparison.
+bool equals_ignore_case(std::string_view a, std::string_view b);
+
 
-} // namespace util::string
\ No newline at end of file
+} // namespace util::string
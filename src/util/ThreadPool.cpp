@@ -0,0 +1,131 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace util {
+
+namespace {
+
+// Identifies the pool and worker the current thread belongs to, so that nested submits stay local.
+thread_local const void* current_pool{};
+thread_local size_t      current_index{};
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    m_queues.reserve(threads);
+    for (size_t idx = 0; idx < threads; idx++) m_queues.emplace_back(std::make_unique<Queue>());
+    m_threads.reserve(threads);
+    for (size_t idx = 0; idx < threads; idx++) m_threads.emplace_back(&ThreadPool::run, this, idx);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_available.notify_all();
+    for (auto& thread : m_threads) thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    auto index = current_pool == this ? current_index : m_next++ % m_queues.size();
+    {
+        // Counted before it can be taken: a worker stealing and finishing it first would otherwise bring m_pending
+        // to 0 (and m_queued below it) while its parent still runs.
+        std::lock_guard lock(m_mutex);
+        m_queued++;
+        m_pending++;
+        std::lock_guard queue_lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.emplace_back(std::move(task));
+    }
+    m_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock lock(m_mutex);
+    m_finished.wait(lock, [this] { return m_pending == 0; });
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    // Shared with the tasks, which may still be unlocking it after the caller has returned.
+    struct Latch {
+        std::mutex              mutex;
+        std::condition_variable done;
+        size_t                  remaining;
+    };
+    auto latch       = std::make_shared<Latch>();
+    latch->remaining = count;
+    for (size_t idx = 0; idx < count; idx++) {
+        submit([latch, &body, idx] {
+            body(idx);
+            std::lock_guard lock(latch->mutex);
+            if (--latch->remaining == 0) latch->done.notify_all();
+        });
+    }
+    auto index = current_pool == this ? current_index : 0;
+    while (true) {
+        {
+            std::lock_guard lock(latch->mutex);
+            if (latch->remaining == 0) return;
+        }
+        if (auto task = take(index)) {
+            execute(task);
+            continue;
+        }
+        // Everything left is running on other workers.
+        std::unique_lock lock(latch->mutex);
+        latch->done.wait(lock, [&] { return latch->remaining == 0; });
+        return;
+    }
+}
+
+void ThreadPool::execute(std::function<void()>& task) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_queued--;
+    }
+    task();
+    std::lock_guard lock(m_mutex);
+    if (--m_pending == 0) m_finished.notify_all();
+}
+
+std::function<void()> ThreadPool::take(size_t index) {
+    std::function<void()> task;
+    {
+        auto&           own = *m_queues[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return task;
+        }
+    }
+    for (size_t offset = 1; offset < m_queues.size(); offset++) {
+        auto&           victim = *m_queues[(index + offset) % m_queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return task;
+        }
+    }
+    return task;
+}
+
+void ThreadPool::run(size_t index) {
+    current_pool  = this;
+    current_index = index;
+    while (true) {
+        if (auto task = take(index)) {
+            execute(task);
+            continue;
+        }
+        std::unique_lock lock(m_mutex);
+        m_available.wait(lock, [this] { return m_stop || m_queued > 0; });
+        if (m_stop && m_queued == 0) return;
+    }
+}
+
+} // namespace util
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own tasks from the back and steals from the
+// front of the other workers' deques when it runs dry. Tasks submitted from a worker go to that worker's deque.
+class ThreadPool {
+public:
+    // 0 means one worker per hardware thread.
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Tasks must not throw.
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished.
+    void wait();
+
+    // Runs body(0) ... body(count - 1) on the pool and returns once they have all finished. The calling thread
+    // runs queued tasks while it waits, so unlike wait() this can be called from within a task.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    size_t size() const { return m_threads.size(); }
+
+private:
+    struct Queue {
+        std::mutex                        mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t index);
+
+    std::function<void()> take(size_t index);
+
+    void execute(std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread>            m_threads;
+    std::atomic<size_t>                 m_next{};
+
+    std::mutex              m_mutex;
+    std::condition_variable m_available;
+    std::condition_variable m_finished;
+    size_t                  m_queued{};
+    size_t                  m_pending{};
+    bool                    m_stop{};
+};
+
+} // namespace util
@@ -0,0 +1,260 @@
+#include "Unicode.h"
+#include "Profile.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define UTIL_UNICODE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define UTIL_TARGET_AVX2
+#else
+#define UTIL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace util::unicode {
+
+namespace {
+
+constexpr char32_t replacement_character = 0xFFFD;
+
+// --- Scalar ---
+
+size_t length_scalar(const char16_t* str, size_t max_len) {
+    size_t idx = 0;
+    while (idx < max_len && str[idx] != 0) idx++;
+    return idx;
+}
+
+// The ASCII kernels convert whole blocks from the start of the input until a block contains a non-ASCII unit,
+// and return how many units were converted. The scalar variants leave everything to the per-code-point loop.
+#ifndef UTIL_UNICODE_X86
+size_t ascii_to_utf8_scalar(const char16_t*, size_t, char*) { return 0; }
+size_t ascii_to_utf16_scalar(const char*, size_t, char16_t*) { return 0; }
+#endif
+
+size_t encode_utf8(char32_t cp, char* dst) {
+    if (cp < 0x80) {
+        dst[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        dst[0] = static_cast<char>(0xC0 | (cp >> 6));
+        dst[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        dst[0] = static_cast<char>(0xE0 | (cp >> 12));
+        dst[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        dst[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    dst[0] = static_cast<char>(0xF0 | (cp >> 18));
+    dst[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    dst[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    dst[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Decodes one code point at src[idx] and advances idx. Ill-formed sequences are replaced per maximal subpart.
+char32_t decode_utf8(const unsigned char* src, size_t len, size_t& idx) {
+    auto lead = src[idx++];
+    if (lead < 0x80) return lead;
+    if (lead < 0xC2 || lead > 0xF4) return replacement_character;
+    size_t        trailing = lead < 0xE0 ? 1 : lead < 0xF0 ? 2 : 3;
+    char32_t      cp       = lead & (0x3F >> trailing);
+    unsigned char lower    = lead == 0xE0 ? 0xA0 : lead == 0xF0 ? 0x90 : 0x80;
+    unsigned char upper    = lead == 0xED ? 0x9F : lead == 0xF4 ? 0x8F : 0xBF;
+    for (size_t count = 0; count < trailing; count++) {
+        if (idx >= len || src[idx] < lower || src[idx] > upper) return replacement_character;
+        cp    = (cp << 6) | (src[idx++] & 0x3F);
+        lower = 0x80;
+        upper = 0xBF;
+    }
+    return cp;
+}
+
+// --- x86 ---
+
+#ifdef UTIL_UNICODE_X86
+
+size_t length_sse2(const char16_t* str, size_t max_len) {
+    size_t idx  = 0;
+    auto   zero = _mm_setzero_si128();
+    for (; idx + 8 <= max_len; idx += 8) {
+        auto mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(str + idx)), zero));
+        if (mask) return idx + std::countr_zero(mask) / 2;
+    }
+    return idx + length_scalar(str + idx, max_len - idx);
+}
+
+size_t ascii_to_utf8_sse2(const char16_t* src, size_t len, char* dst) {
+    size_t idx       = 0;
+    auto   non_ascii = _mm_set1_epi16((short)0xFF80);
+    for (; idx + 16 <= len; idx += 16) {
+        auto lo = _mm_loadu_si128((const __m128i*)(src + idx));
+        auto hi = _mm_loadu_si128((const __m128i*)(src + idx + 8));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(lo, hi), non_ascii), _mm_setzero_si128()))
+            != 0xFFFF)
+            break;
+        _mm_storeu_si128((__m128i*)(dst + idx), _mm_packus_epi16(lo, hi));
+    }
+    return idx;
+}
+
+size_t ascii_to_utf16_sse2(const char* src, size_t len, char16_t* dst) {
+    size_t idx  = 0;
+    auto   zero = _mm_setzero_si128();
+    for (; idx + 16 <= len; idx += 16) {
+        auto bytes = _mm_loadu_si128((const __m128i*)(src + idx));
+        if (_mm_movemask_epi8(bytes)) break;
+        _mm_storeu_si128((__m128i*)(dst + idx), _mm_unpacklo_epi8(bytes, zero));
+        _mm_storeu_si128((__m128i*)(dst + idx + 8), _mm_unpackhi_epi8(bytes, zero));
+    }
+    return idx;
+}
+
+UTIL_TARGET_AVX2 size_t length_avx2(const char16_t* str, size_t max_len) {
+    size_t idx  = 0;
+    auto   zero = _mm256_setzero_si256();
+    for (; idx + 16 <= max_len; idx += 16) {
+        auto mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(str + idx)), zero)
+        );
+        if (mask) return idx + std::countr_zero(mask) / 2;
+    }
+    return idx + length_sse2(str + idx, max_len - idx);
+}
+
+UTIL_TARGET_AVX2 size_t ascii_to_utf8_avx2(const char16_t* src, size_t len, char* dst) {
+    size_t idx       = 0;
+    auto   non_ascii = _mm256_set1_epi16((short)0xFF80);
+    for (; idx + 32 <= len; idx += 32) {
+        auto lo = _mm256_loadu_si256((const __m256i*)(src + idx));
+        auto hi = _mm256_loadu_si256((const __m256i*)(src + idx + 16));
+        if (!_mm256_testz_si256(_mm256_or_si256(lo, hi), non_ascii)) break;
+        // packus works per 128-bit lane, restore the order of the four 64-bit quarters.
+        auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + idx), packed);
+    }
+    return idx + ascii_to_utf8_sse2(src + idx, len - idx, dst + idx);
+}
+
+UTIL_TARGET_AVX2 size_t ascii_to_utf16_avx2(const char* src, size_t len, char16_t* dst) {
+    size_t idx = 0;
+    for (; idx + 32 <= len; idx += 32) {
+        auto bytes = _mm256_loadu_si256((const __m256i*)(src + idx));
+        if (_mm256_movemask_epi8(bytes)) break;
+        _mm256_storeu_si256((__m256i*)(dst + idx), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+        _mm256_storeu_si256((__m256i*)(dst + idx + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+    }
+    return idx + ascii_to_utf16_sse2(src + idx, len - idx, dst + idx);
+}
+
+bool cpu_has_avx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx     = info[2] & (1 << 28);
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+struct Kernels {
+    size_t (*length)(const char16_t*, size_t);
+    size_t (*ascii_to_utf8)(const char16_t*, size_t, char*);
+    size_t (*ascii_to_utf16)(const char*, size_t, char16_t*);
+};
+
+const Kernels& kernels() {
+    static const Kernels selected = [] {
+#ifdef UTIL_UNICODE_X86
+        if (cpu_has_avx2()) return Kernels{length_avx2, ascii_to_utf8_avx2, ascii_to_utf16_avx2};
+        return Kernels{length_sse2, ascii_to_utf8_sse2, ascii_to_utf16_sse2};
+#else
+        return Kernels{length_scalar, ascii_to_utf8_scalar, ascii_to_utf16_scalar};
+#endif
+    }();
+    return selected;
+}
+
+// Number of units handled by the scalar loop before trying the vector kernel again.
+constexpr size_t scalar_run = 16;
+
+} // namespace
+
+size_t utf16_length(const char16_t* str, size_t max_len) { return kernels().length(str, max_len); }
+
+size_t utf16_to_utf8(const char16_t* src, size_t len, char* dst) {
+    profile::count(profile::Counter::Transcodes);
+    auto&  kernel = kernels();
+    size_t idx    = 0;
+    size_t out    = 0;
+    while (idx < len) {
+        auto ascii  = kernel.ascii_to_utf8(src + idx, len - idx, dst + out);
+        idx        += ascii;
+        out        += ascii;
+        for (auto end = std::min(len, idx + scalar_run); idx < end;) {
+            char32_t cp = src[idx++];
+            if (cp >= 0xD800 && cp <= 0xDFFF) {
+                if (cp <= 0xDBFF && idx < len && src[idx] >= 0xDC00 && src[idx] <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (src[idx++] - 0xDC00);
+                } else {
+                    cp = replacement_character;
+                }
+            }
+            out += encode_utf8(cp, dst + out);
+        }
+    }
+    return out;
+}
+
+size_t utf8_to_utf16(const char* src, size_t len, char16_t* dst, size_t capacity) {
+    profile::count(profile::Counter::Transcodes);
+    auto&  kernel = kernels();
+    auto   bytes  = reinterpret_cast<const unsigned char*>(src);
+    size_t idx    = 0;
+    size_t out    = 0;
+    while (idx < len) {
+        // Every ASCII byte produces exactly one unit, so the kernel can not overrun once limited to capacity.
+        auto ascii  = kernel.ascii_to_utf16(src + idx, std::min(len - idx, capacity - out), dst + out);
+        idx        += ascii;
+        out        += ascii;
+        for (size_t count = 0; idx < len && count < scalar_run; count++) {
+            auto cp = decode_utf8(bytes, len, idx);
+            if (cp >= 0x10000) {
+                if (capacity - out < 2) return npos;
+                dst[out++] = static_cast<char16_t>(0xD800 + ((cp - 0x10000) >> 10));
+                dst[out++] = static_cast<char16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+            } else {
+                if (capacity - out < 1) return npos;
+                dst[out++] = static_cast<char16_t>(cp);
+            }
+        }
+    }
+    return out;
+}
+
+size_t utf16_length_of_utf8(const char* src, size_t len) {
+    auto   bytes  = reinterpret_cast<const unsigned char*>(src);
+    size_t idx    = 0;
+    size_t result = 0;
+    while (idx < len) result += decode_utf8(bytes, len, idx) >= 0x10000 ? 2 : 1;
+    return result;
+}
+
+} // namespace util::unicode
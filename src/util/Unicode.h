@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+// UTF-16 <-> UTF-8 transcoding without allocations. Runs of ASCII are converted with SSE2/AVX2 kernels (selected
+// at runtime on x86), everything else goes through the scalar path. Ill-formed input is replaced with U+FFFD.
+
+namespace util::unicode {
+
+inline constexpr size_t npos = static_cast<size_t>(-1);
+
+// Number of UTF-8 bytes that is always enough for len UTF-16 code units.
+constexpr size_t utf8_capacity(size_t len) { return len * 3; }
+
+// Length of str up to (not including) the first NUL, or max_len if there is none.
+size_t utf16_length(const char16_t* str, size_t max_len);
+
+// Converts len code units, dst must hold utf8_capacity(len) bytes. Returns the number of bytes written.
+size_t utf16_to_utf8(const char16_t* src, size_t len, char* dst);
+
+// Converts len bytes. Returns the number of code units written, or npos (with dst partially written) if more
+// than capacity code units would be needed.
+size_t utf8_to_utf16(const char* src, size_t len, char16_t* dst, size_t capacity);
+
+// Number of UTF-16 code units needed for len bytes of UTF-8.
+size_t utf16_length_of_utf8(const char* src, size_t len);
+
+} // namespace util::unicode
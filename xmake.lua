@@ -2,16 +2,80 @@ add_rules('mode.debug', 'mode.release')
 
 add_requires('argparse      3.1')
 add_requires('spdlog        1.14.1')
-add_requires('icu4c         75.1')
 add_requires('nlohmann_json 3.11.3')
 
+option('bench')
+    set_default(false)
+    set_showmenu(true)
+    set_description('Build the rkcfgbench benchmark suite.')
+option_end()
+
+if has_config('bench') then
+    add_requires('benchmark     1.8.3')
+end
+
+-- Everything but the command line, linked into the tool, the library and the benchmarks.
+target('rkcfgcore')
+    set_kind('static')
+    set_default(false)
+    add_files('src/rockchip/*.cpp', 'src/util/*.cpp')
+    add_includedirs('src', {public = true})
+    set_warnings('all')
+    set_languages('c99', 'c++20')
+    -- Also linked into the shared librkcfg.
+    if not is_plat('windows') then
+        add_cxflags('-fPIC')
+    end
+    add_packages('spdlog', 'nlohmann_json', {public = true})
+    if is_mode('debug') then 
+        add_defines('DEBUG')
+    end
+
+-- librkcfg, C ABI for in-process use. Static by default, 'xmake f -k shared' for a shared library.
+target('rkcfg')
+    set_kind('$(kind)')
+    add_deps('rkcfgcore')
+    add_files('src/capi/*.cpp')
+    add_headerfiles('src/capi/rkcfg.h')
+    set_warnings('all')
+    set_languages('c99', 'c++20')
+    add_defines('RKCFG_BUILD')
+    if is_kind('shared') then
+        add_defines('RKCFG_SHARED', {public = true})
+        set_symbols('hidden')
+    else
+        -- A single librkcfg.a: rkcfgcore, spdlog and fmt are merged in.
+        set_policy('build.merge_archive', true)
+    end
+
 target('rkcfgtool')
     set_kind('binary')
-    add_files('src/**.cpp')
-    add_includedirs('src')
+    add_deps('rkcfgcore')
+    add_files('src/Main.cpp', 'src/cli/*.cpp')
     set_warnings('all')
     set_languages('c99', 'c++20')
-    add_packages('argparse', 'spdlog', 'icu4c', 'nlohmann_json')
+    add_packages('argparse', 'spdlog', 'nlohmann_json')
     if is_mode('debug') then 
         add_defines('DEBUG')
     end
+
+if has_config('bench') then
+    target('rkcfgbench')
+        set_kind('binary')
+        set_default(false)
+        add_deps('rkcfgcore')
+        add_files('bench/Bench.cpp', 'bench/Corpus.cpp')
+        set_warnings('all')
+        set_languages('c99', 'c++20')
+        add_packages('spdlog', 'nlohmann_json', 'benchmark')
+
+    -- Latency client for 'rkcfgtool serve' (POSIX only).
+    target('rkcfgloadgen')
+        set_kind('binary')
+        set_default(false)
+        add_files('bench/LoadGen.cpp', 'src/cli/Protocol.cpp')
+        add_includedirs('src')
+        set_warnings('all')
+        set_languages('c99', 'c++20')
+        add_packages('argparse', 'spdlog', 'nlohmann_json')
+end